@@ -2,6 +2,7 @@
 #include "ruby/encoding.h"
 #include "ruby/intern.h"
 
+#include "natalie_parser/binary_ast.hpp"
 #include "natalie_parser/creator.hpp"
 #include "natalie_parser/node.hpp"
 
@@ -9,34 +10,95 @@ extern VALUE Sexp;
 
 namespace NatalieParser {
 
+// Remembers the Ruby ID for each name in the parser's SymbolTable, so each
+// distinct name goes through rb_intern3() only once per parse.
+class MRISymbolCache {
+public:
+    MRISymbolCache(SharedPtr<SymbolTable> symbols)
+        : m_symbols { symbols } { }
+
+    ID intern(const TM::String &name) {
+        auto symbol_id = m_symbols->find(&name);
+        if (!symbol_id)
+            return rb_intern_string(name);
+        while (m_ids.size() <= symbol_id)
+            m_ids.push(0);
+        if (!m_ids[symbol_id])
+            m_ids[symbol_id] = rb_intern_string(name);
+        return m_ids[symbol_id];
+    }
+
+    static ID rb_intern_string(const TM::String &name) {
+        auto encoding = name.contains_utf8_encoded_multibyte_characters() ? rb_utf8_encoding() : rb_ascii8bit_encoding();
+        return rb_intern3(name.c_str(), name.size(), encoding);
+    }
+
+private:
+    SharedPtr<SymbolTable> m_symbols;
+    TM::Vector<ID> m_ids {};
+};
+
+// What to set on each Sexp besides its contents. Consumers that never look
+// at these can turn them off, leaving each Sexp a bare Array.
+struct MRICreatorOptions {
+    bool locations { true }; // file, line, and column
+    bool comments { true };
+};
+
 class MRICreator : public Creator {
 public:
-    MRICreator(const Node &node)
-        : Creator { node.file().static_cast_as<const String>(), node.line(), node.column() } {
+    MRICreator(const Node &node, MRISymbolCache *symbols = nullptr, MRICreatorOptions options = {})
+        : Creator { node.file().static_cast_as<const String>(), node.line(), node.column() }
+        , m_symbols { symbols }
+        , m_options { options }
+        , m_file_string { options.locations ? get_file_string(*file()) : Qnil } {
         reset_sexp();
     }
 
     MRICreator(const MRICreator &other)
-        : Creator { other.file(), other.line(), other.column() } {
+        : Creator { other.file(), other.line(), other.column() }
+        , m_symbols { other.m_symbols }
+        , m_options { other.m_options }
+        , m_file_string { other.m_file_string } {
         reset_sexp();
     }
 
     virtual ~MRICreator() { }
 
+    // Interns the instance variable names we set on every Sexp. Called
+    // from Init_natalie_parser().
+    static void init_ids() {
+        s_file_id = rb_intern("@file");
+        s_line_id = rb_intern("@line");
+        s_column_id = rb_intern("@column");
+        s_comments_id = rb_intern("@comments");
+    }
+
+    inline static ID s_file_id { 0 };
+    inline static ID s_line_id { 0 };
+    inline static ID s_column_id { 0 };
+    inline static ID s_comments_id { 0 };
+
     virtual void reset_sexp() override {
-        m_sexp = rb_class_new_instance(0, nullptr, Sexp);
-        rb_ivar_set(m_sexp, rb_intern("@file"), get_file_string(*file()));
-        rb_ivar_set(m_sexp, rb_intern("@line"), rb_int_new(line() + 1));
-        rb_ivar_set(m_sexp, rb_intern("@column"), rb_int_new(column() + 1));
+        // Sexp#initialize with no arguments does nothing, so skip calling it
+        // and just allocate the (Array) object.
+        m_sexp = rb_obj_alloc(Sexp);
+        if (!m_options.locations)
+            return;
+        rb_ivar_set(m_sexp, s_file_id, m_file_string);
+        rb_ivar_set(m_sexp, s_line_id, rb_int_new(line() + 1));
+        rb_ivar_set(m_sexp, s_column_id, rb_int_new(column() + 1));
     }
 
     virtual void set_comments(const TM::String &comments) override {
+        if (!m_options.comments)
+            return;
         auto string_obj = rb_utf8_str_new(comments.c_str(), comments.length());
-        rb_ivar_set(m_sexp, rb_intern("@comments"), string_obj);
+        rb_ivar_set(m_sexp, s_comments_id, string_obj);
     }
 
     virtual void set_type(const char *type) override {
-        rb_ary_store(m_sexp, 0, ID2SYM(rb_intern(type)));
+        rb_ary_store(m_sexp, 0, type_symbol(type));
     }
 
     virtual void append(const Node &node) override {
@@ -44,14 +106,14 @@ public:
             rb_ary_push(m_sexp, Qnil);
             return;
         }
-        MRICreator creator { node };
+        MRICreator creator { node, *this };
         creator.set_assignment(assignment());
         node.transform(&creator);
         rb_ary_push(m_sexp, creator.sexp());
     }
 
     virtual void append_array(const ArrayNode &array) override {
-        MRICreator creator { array };
+        MRICreator creator { array, *this };
         creator.set_assignment(assignment());
         array.ArrayNode::transform(&creator);
         rb_ary_push(m_sexp, creator.sexp());
@@ -103,9 +165,8 @@ public:
     }
 
     virtual void append_symbol(TM::String &name) override {
-        auto encoding = name.contains_utf8_encoded_multibyte_characters() ? rb_utf8_encoding() : rb_ascii8bit_encoding();
-        auto symbol = ID2SYM(rb_intern3(name.c_str(), name.size(), encoding));
-        rb_ary_push(m_sexp, symbol);
+        auto id = m_symbols ? m_symbols->intern(name) : MRISymbolCache::rb_intern_string(name);
+        rb_ary_push(m_sexp, ID2SYM(id));
     }
 
     virtual void append_true() override {
@@ -136,8 +197,38 @@ public:
 
     VALUE sexp() const { return m_sexp; }
 
-private:
+protected:
+    friend class MRIBinaryReader;
+
+    // for child nodes, which are nearly always in the same file as their
+    // parent, so we can skip looking up the file name
+    MRICreator(const Node &node, const MRICreator &parent)
+        : Creator { node.file().static_cast_as<const String>(), node.line(), node.column() }
+        , m_symbols { parent.m_symbols }
+        , m_options { parent.m_options }
+        , m_file_string { !m_options.locations || file() == parent.file() ? parent.m_file_string : get_file_string(*file()) } {
+        reset_sexp();
+    }
+
     VALUE m_sexp { Qnil };
+    MRISymbolCache *m_symbols { nullptr };
+    MRICreatorOptions m_options {};
+    VALUE m_file_string { Qnil };
+
+    // Node types are always string literals, so we can look up their
+    // symbols by address instead of interning the name each time. (The
+    // same name may live at more than one address, which just costs an
+    // extra entry.) These symbols are never garbage collected.
+    static VALUE type_symbol(const char *type) {
+        auto symbol = s_type_symbols.get(type);
+        if (!symbol) {
+            symbol = ID2SYM(rb_intern(type));
+            s_type_symbols.put(type, symbol);
+        }
+        return symbol;
+    }
+
+    inline static TM::Hashmap<const char *, VALUE> s_type_symbols { TM::HashType::Pointer, 256 };
 
     static VALUE get_file_string(const String &file) {
         auto file_string = s_file_cache.get(file);
@@ -154,4 +245,139 @@ private:
     // (Otherwise we leak memory if the user parses lots of different files in a long-running process.)
     inline static TM::Hashmap<const String, VALUE> s_file_cache { TM::HashType::TMString };
 };
+
+// What the nodes of one NatalieParser.parse_lazy tree share.
+struct MRILazyContext {
+    MRISymbolCache symbols;
+    MRICreatorOptions options {};
+    Arena::Ref arena {}; // owns the nodes
+};
+
+// Wraps node (not yet converted) in a NatalieParser::LazyNode. Defined
+// with the rest of LazyNode in natalie_parser.cpp.
+VALUE mri_lazy_node_new(SharedPtr<MRILazyContext> context, NodePtr<Node> node, bool is_array, bool assignment);
+
+// Builds the Sexp for one node, like MRICreator, but leaves the child nodes
+// as LazyNodes to be built when they are first looked at. Children handed
+// over by reference instead of by NodePtr may not outlive the call (some
+// nodes build them on the stack), so those are built right away.
+class MRILazyCreator : public MRICreator {
+public:
+    MRILazyCreator(const Node &node, SharedPtr<MRILazyContext> context)
+        : MRICreator { node, &context->symbols, context->options }
+        , m_context { context } { }
+
+    MRILazyCreator(const MRILazyCreator &other)
+        : MRICreator { other }
+        , m_context { other.m_context } { }
+
+    using MRICreator::append;
+    using MRICreator::append_array;
+
+    virtual void append(const NodePtr<Node> node) override {
+        if (node->type() == Node::Type::Nil) {
+            rb_ary_push(m_sexp, Qnil);
+            return;
+        }
+        rb_ary_push(m_sexp, mri_lazy_node_new(m_context, node, false, assignment()));
+    }
+
+    virtual void append_array(const NodePtr<ArrayNode> array) override {
+        rb_ary_push(m_sexp, mri_lazy_node_new(m_context, array.static_cast_as<Node>(), true, assignment()));
+    }
+
+    virtual void append_sexp(std::function<void(Creator *)> fn) override {
+        MRILazyCreator creator { *this };
+        fn(&creator);
+        rb_ary_push(m_sexp, creator.sexp());
+    }
+
+private:
+    SharedPtr<MRILazyContext> m_context;
+};
+
+// Builds the same Sexps MRICreator would have, from a BinaryAst instead of
+// the nodes.
+class MRIBinaryReader {
+public:
+    MRIBinaryReader(const BinaryAst &ast)
+        : m_ast { ast } {
+        if (ast.has_locations() && ast.has_file())
+            m_file_string = MRICreator::get_file_string(ast.file().to_string());
+        for (size_t i = 0; i <= ast.string_count(); i++)
+            m_ids.push(0);
+    }
+
+    VALUE sexp() { return to_ruby(m_ast.root()); }
+
+private:
+    VALUE to_ruby(BinaryAst::Value value) {
+        switch (value.kind()) {
+        case BinaryAst::Kind::Sexp: {
+            VALUE sexp = rb_obj_alloc(Sexp);
+            if (m_ast.has_locations()) {
+                rb_ivar_set(sexp, MRICreator::s_file_id, m_file_string);
+                rb_ivar_set(sexp, MRICreator::s_line_id, rb_int_new(value.line() + 1));
+                rb_ivar_set(sexp, MRICreator::s_column_id, rb_int_new(value.column() + 1));
+            }
+            if (value.has_comments()) {
+                auto comments = value.comments();
+                rb_ivar_set(sexp, MRICreator::s_comments_id, rb_utf8_str_new(comments.data, comments.length));
+            }
+            if (value.has_type())
+                rb_ary_push(sexp, ID2SYM(intern(value.type_number())));
+            value.each_child([&](BinaryAst::Value child) { rb_ary_push(sexp, to_ruby(child)); });
+            return sexp;
+        }
+        case BinaryAst::Kind::Bignum: {
+            auto number = value.string();
+            return rb_Integer(rb_utf8_str_new(number.data, number.length));
+        }
+        case BinaryAst::Kind::Complex:
+            return rb_Complex(INT2FIX(0), to_ruby(value.number()));
+        case BinaryAst::Kind::False:
+            return Qfalse;
+        case BinaryAst::Kind::Fixnum:
+            return rb_int_new(value.fixnum());
+        case BinaryAst::Kind::Float:
+            return rb_float_new(value.float_value());
+        case BinaryAst::Kind::Nil:
+            return Qnil;
+        case BinaryAst::Kind::Range:
+            return rb_range_new(rb_int_new(value.range_first()), rb_int_new(value.range_last()), value.range_excludes_end() ? Qtrue : Qfalse);
+        case BinaryAst::Kind::Rational: {
+            auto number = to_ruby(value.number());
+            if (TYPE(number) == T_FLOAT)
+                return rb_flt_rationalize(number);
+            return rb_Rational(number, INT2FIX(1));
+        }
+        case BinaryAst::Kind::Regexp: {
+            auto pattern = value.string().to_string();
+            auto encoding = pattern.contains_utf8_encoded_multibyte_characters() ? rb_utf8_encoding() : rb_ascii8bit_encoding();
+            return rb_enc_reg_new(pattern.c_str(), pattern.size(), encoding, value.regexp_options());
+        }
+        case BinaryAst::Kind::String: {
+            auto string = value.string().to_string();
+            auto encoding = string.contains_seemingly_valid_utf8_encoded_characters() ? rb_utf8_encoding() : rb_ascii8bit_encoding();
+            return rb_enc_str_new(string.c_str(), string.length(), encoding);
+        }
+        case BinaryAst::Kind::Symbol:
+            return ID2SYM(intern(value.string_number()));
+        case BinaryAst::Kind::True:
+            return Qtrue;
+        }
+        TM_UNREACHABLE();
+    }
+
+    // each string once, like MRISymbolCache
+    ID intern(uint32_t number) {
+        if (!m_ids[number])
+            m_ids[number] = MRISymbolCache::rb_intern_string(m_ast.string(number).to_string());
+        return m_ids[number];
+    }
+
+    const BinaryAst &m_ast;
+    VALUE m_file_string { Qnil };
+    TM::Vector<ID> m_ids {};
+};
 }
@@ -2,14 +2,229 @@
 #include "ruby.h"
 #include "ruby/encoding.h"
 #include "ruby/intern.h"
+#include "ruby/thread.h"
 #include "stdio.h"
 
+#include <atomic>
+#include <exception>
+#include <new>
+
 // this includes MUST come after
 #include "mri_creator.hpp"
+#include "natalie_parser/batch_parser.hpp"
+#include "natalie_parser/creator/binary_creator.hpp"
+#include "natalie_parser/parse_cache.hpp"
 #include "natalie_parser/parser.hpp"
 
 VALUE Parser;
 VALUE Sexp;
+VALUE LazyNode;
+
+// Below this size, handing the GVL off and taking it back costs more than
+// the lex/parse itself.
+static constexpr size_t without_gvl_min_size = 4 * 1024;
+
+enum class WithoutGvlErrorKind {
+    None,
+    SyntaxError,
+    NoMemory,
+    Other,
+};
+
+template <typename Fn>
+struct WithoutGvlCall {
+    Fn &fn;
+    std::atomic<bool> cancel_flag { false };
+    bool cancelled { false };
+    WithoutGvlErrorKind error_kind { WithoutGvlErrorKind::None };
+    TM::String error {};
+};
+
+// Nothing may be thrown through rb_thread_call_without_gvl(), so anything
+// fn throws is caught here and raised by the caller as a Ruby exception.
+template <typename Fn>
+static void *run_without_gvl(void *data) {
+    auto call = static_cast<WithoutGvlCall<Fn> *>(data);
+    try {
+        try {
+            call->fn(&call->cancel_flag);
+        } catch (NatalieParser::Parser::SyntaxError &error) {
+            call->error_kind = WithoutGvlErrorKind::SyntaxError;
+            call->error = error.message();
+        } catch (NatalieParser::Lexer::Cancelled &) {
+            call->cancelled = true;
+        } catch (NatalieParser::BinaryAst::FormatError &error) {
+            call->error_kind = WithoutGvlErrorKind::Other;
+            call->error = error.message();
+        } catch (std::bad_alloc &) {
+            call->error_kind = WithoutGvlErrorKind::NoMemory;
+        } catch (std::exception &error) {
+            call->error_kind = WithoutGvlErrorKind::Other;
+            call->error = error.what();
+        }
+    } catch (std::bad_alloc &) {
+        // copying the message
+        call->error_kind = WithoutGvlErrorKind::NoMemory;
+    }
+    return nullptr;
+}
+
+template <typename Fn>
+static void cancel_without_gvl(void *data) {
+    static_cast<WithoutGvlCall<Fn> *>(data)->cancel_flag.store(true);
+}
+
+static VALUE check_ints(VALUE) {
+    rb_thread_check_ints();
+    return Qnil;
+}
+
+// what call_without_gvl() leaves for its caller to raise
+struct WithoutGvlError {
+    VALUE error_class { Qnil };
+    VALUE message { Qnil };
+    int interrupt { 0 }; // rb_protect() state
+
+    bool is_error() const { return error_class != Qnil || interrupt; }
+    bool is_syntax_error() const { return error_class == rb_eSyntaxError; }
+};
+
+// Runs fn, which lexes and/or parses, with the GVL released so that other
+// Ruby threads keep running. fn gets a flag to hand to Parser or Lexer
+// set_cancel_flag(); it must not touch any Ruby objects, and it must start
+// over from scratch each time it is called.
+//
+// If the thread is interrupted (Thread#raise, Thread#kill, a signal), the
+// parse is cancelled and the interrupt is handled once we have the GVL
+// again. If handling it doesn't raise, the parse is run again.
+//
+// Returns the SyntaxError (or, if something else went wrong, a
+// NoMemoryError or RuntimeError), or the exception from handling an
+// interrupt, instead of raising it. Raising unwinds without running destructors, so
+// the caller keeps its C++ objects in a block and hands the result to
+// raise_without_gvl_error() once that block has closed.
+template <typename Fn>
+static WithoutGvlError call_without_gvl(size_t size, Fn fn) {
+    for (;;) {
+        WithoutGvlError error;
+        bool cancelled = false;
+        {
+            WithoutGvlCall<Fn> call { fn };
+            if (size < without_gvl_min_size)
+                run_without_gvl<Fn>(&call);
+            else
+                rb_thread_call_without_gvl(run_without_gvl<Fn>, &call, cancel_without_gvl<Fn>, &call);
+            switch (call.error_kind) {
+            case WithoutGvlErrorKind::None:
+                break;
+            case WithoutGvlErrorKind::SyntaxError:
+                error.error_class = rb_eSyntaxError;
+                break;
+            case WithoutGvlErrorKind::NoMemory:
+                error.error_class = rb_eNoMemError;
+                call.error = "failed to allocate memory";
+                break;
+            case WithoutGvlErrorKind::Other:
+                error.error_class = rb_eRuntimeError;
+                break;
+            }
+            if (error.error_class != Qnil)
+                error.message = rb_utf8_str_new(call.error.c_str(), call.error.length());
+            cancelled = call.cancelled;
+        }
+        if (!cancelled)
+            return error;
+        rb_protect(check_ints, Qnil, &error.interrupt);
+        if (error.interrupt)
+            return error;
+    }
+}
+
+static void raise_without_gvl_error(const WithoutGvlError &error) {
+    if (error.interrupt)
+        rb_jump_tag(error.interrupt);
+    if (error.error_class != Qnil)
+        rb_exc_raise(rb_exc_new_str(error.error_class, error.message));
+}
+
+// Runs fn, which builds Ruby objects from C++ ones and returns a VALUE,
+// under rb_protect(). Building a Sexp can raise (a RegexpError for a bad
+// regexp literal), which would unwind past the C++ objects without running
+// their destructors, so the caller keeps them in a block and passes state
+// to rb_jump_tag() once that block has closed.
+template <typename Fn>
+static VALUE protect(Fn fn, int *state) {
+    auto call = [](VALUE data) { return (*reinterpret_cast<Fn *>(data))(); };
+    return rb_protect(call, reinterpret_cast<VALUE>(&fn), state);
+}
+
+// A node of a NatalieParser.parse_lazy tree, which isn't converted to a
+// Sexp until something looks inside it, and then only one level deep.
+struct LazyNodeData {
+    TM::SharedPtr<NatalieParser::MRILazyContext> context;
+    NatalieParser::NodePtr<NatalieParser::Node> node; // in context->arena
+    bool is_array { false };
+    bool assignment { false };
+    VALUE sexp { Qnil }; // once converted
+};
+
+static void lazy_node_mark(void *data) {
+    if (data)
+        rb_gc_mark(static_cast<LazyNodeData *>(data)->sexp);
+}
+
+static void lazy_node_free(void *data) {
+    delete static_cast<LazyNodeData *>(data);
+}
+
+static size_t lazy_node_memsize(const void *) {
+    return sizeof(LazyNodeData);
+}
+
+static const rb_data_type_t lazy_node_type = {
+    "NatalieParser::LazyNode",
+    { lazy_node_mark, lazy_node_free, lazy_node_memsize },
+    nullptr,
+    nullptr,
+    RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+VALUE NatalieParser::mri_lazy_node_new(TM::SharedPtr<MRILazyContext> context, NodePtr<Node> node, bool is_array, bool assignment) {
+    VALUE object = TypedData_Wrap_Struct(LazyNode, &lazy_node_type, nullptr);
+    DATA_PTR(object) = new LazyNodeData { context, node, is_array, assignment };
+    return object;
+}
+
+template <typename CreatorT>
+static VALUE lazy_node_build(LazyNodeData *data, CreatorT &creator) {
+    creator.set_assignment(data->assignment);
+    if (data->is_array)
+        data->node.static_cast_as<NatalieParser::ArrayNode>()->ArrayNode::transform(&creator);
+    else
+        data->node->transform(&creator);
+    return creator.sexp();
+}
+
+static LazyNodeData *lazy_node_data(VALUE self) {
+    return static_cast<LazyNodeData *>(rb_check_typeddata(self, &lazy_node_type));
+}
+
+// this node's Sexp, with LazyNodes for children
+static VALUE lazy_node_sexp(VALUE self) {
+    auto data = lazy_node_data(self);
+    if (NIL_P(data->sexp)) {
+        VALUE sexp = Qnil;
+        int state = 0;
+        {
+            NatalieParser::MRILazyCreator creator { *data->node, data->context };
+            sexp = protect([&]() { return lazy_node_build(data, creator); }, &state);
+        }
+        if (state)
+            rb_jump_tag(state);
+        data->sexp = sexp;
+    }
+    return data->sexp;
+}
 
 extern "C" {
 
@@ -27,40 +242,319 @@ VALUE initialize(int argc, VALUE *argv, VALUE self) {
     return self;
 }
 
-VALUE node_to_ruby(const NatalieParser::Node &node) {
-    NatalieParser::MRICreator creator { node };
+VALUE node_to_ruby(const NatalieParser::Node &node, NatalieParser::MRISymbolCache *symbols = nullptr, NatalieParser::MRICreatorOptions options = {}) {
+    NatalieParser::MRICreator creator { node, symbols, options };
     node.transform(&creator);
     return creator.sexp();
 }
 
-VALUE parse_on_instance(VALUE self) {
+// Reads the locations: and comments: keyword arguments (both true by
+// default) into options. Any other keys in kwargs must be given in keys.
+static void get_creator_options(VALUE kwargs, NatalieParser::MRICreatorOptions &options, ID *keys = nullptr, VALUE *values = nullptr, int key_count = 0) {
+    if (NIL_P(kwargs))
+        return;
+    ID all_keys[3];
+    VALUE all_values[3];
+    for (int i = 0; i < key_count; i++)
+        all_keys[i] = keys[i];
+    all_keys[key_count] = rb_intern("locations");
+    all_keys[key_count + 1] = rb_intern("comments");
+    rb_get_kwargs(kwargs, all_keys, 0, key_count + 2, all_values);
+    for (int i = 0; i < key_count; i++)
+        values[i] = all_values[i];
+    if (all_values[key_count] != Qundef)
+        options.locations = RTEST(all_values[key_count]);
+    if (all_values[key_count + 1] != Qundef)
+        options.comments = RTEST(all_values[key_count + 1]);
+}
+
+// Returns the error instead of raising it; see call_without_gvl().
+static WithoutGvlError parse_tree(VALUE self, NatalieParser::MRICreatorOptions options, NatalieParser::Tree &tree, TM::SharedPtr<NatalieParser::SymbolTable> &symbol_table) {
     VALUE code = rb_ivar_get(self, rb_intern("@code"));
     VALUE path = rb_ivar_get(self, rb_intern("@path"));
-    auto code_string = new TM::String { StringValueCStr(code) };
-    auto path_string = new TM::String { StringValueCStr(path) };
-    auto parser = NatalieParser::Parser { code_string, path_string };
-    try {
-        auto tree = parser.tree();
-        VALUE ast = node_to_ruby(*tree);
-        return ast;
-    } catch (NatalieParser::Parser::SyntaxError &error) {
-        rb_raise(rb_eSyntaxError, "%s", error.message());
+    auto code_cstr = StringValueCStr(code);
+    auto path_cstr = StringValueCStr(path);
+    WithoutGvlError error;
+    {
+        TM::SharedPtr<TM::String> code_string = new TM::String { code_cstr };
+        TM::SharedPtr<TM::String> path_string = new TM::String { path_cstr };
+        error = call_without_gvl(code_string->length(), [&](const std::atomic<bool> *cancel_flag) {
+            auto parser = NatalieParser::Parser { code_string, path_string };
+            parser.set_cancel_flag(cancel_flag);
+            parser.set_keep_doc_comments(options.comments);
+            tree = parser.tree();
+            symbol_table = parser.symbols();
+        });
+    }
+    return error;
+}
+
+static VALUE parse_with_options(VALUE self, NatalieParser::MRICreatorOptions options) {
+    WithoutGvlError error;
+    VALUE ast = Qnil;
+    int state = 0;
+    {
+        NatalieParser::Tree tree;
+        TM::SharedPtr<NatalieParser::SymbolTable> symbol_table;
+        error = parse_tree(self, options, tree, symbol_table);
+        if (!error.is_error()) {
+            NatalieParser::MRISymbolCache symbols { symbol_table };
+            ast = protect([&]() { return node_to_ruby(*tree, &symbols, options); }, &state);
+        }
+    }
+    raise_without_gvl_error(error);
+    if (state)
+        rb_jump_tag(state);
+    return ast;
+}
+
+// Like parse_with_options, but goes through the ParseCache in directory, so
+// code that was parsed before is read from the mapped entry instead.
+static VALUE parse_with_cache(VALUE self, NatalieParser::MRICreatorOptions options, VALUE directory) {
+    VALUE code = rb_ivar_get(self, rb_intern("@code"));
+    VALUE path = rb_ivar_get(self, rb_intern("@path"));
+    VALUE version = rb_const_get(Parser, rb_intern("VERSION"));
+    auto code_cstr = StringValueCStr(code);
+    auto path_cstr = StringValueCStr(path);
+    auto directory_cstr = StringValueCStr(directory);
+    auto version_cstr = StringValueCStr(version);
+    uint16_t flags = (options.locations ? NatalieParser::BinaryAst::Locations : 0) | (options.comments ? NatalieParser::BinaryAst::Comments : 0);
+    WithoutGvlError error;
+    VALUE sexp = Qnil;
+    int state = 0;
+    {
+        TM::SharedPtr<TM::String> code_string = new TM::String { code_cstr };
+        TM::SharedPtr<TM::String> path_string = new TM::String { path_cstr };
+        NatalieParser::ParseCache cache { directory_cstr, version_cstr };
+        TM::SharedPtr<NatalieParser::ParseCache::Entry> entry;
+        error = call_without_gvl(code_string->length(), [&](const std::atomic<bool> *cancel_flag) {
+            entry = cache.fetch(code_string, path_string, flags, cancel_flag);
+        });
+        if (!error.is_error()) {
+            NatalieParser::MRIBinaryReader reader { entry->ast() };
+            sexp = protect([&]() { return reader.sexp(); }, &state);
+        }
     }
+    raise_without_gvl_error(error);
+    if (state)
+        rb_jump_tag(state);
+    return sexp;
+}
+
+static VALUE parse_with_kwargs(VALUE self, VALUE kwargs) {
+    NatalieParser::MRICreatorOptions options;
+    ID keys[] = { rb_intern("cache") };
+    VALUE cache = Qundef;
+    get_creator_options(kwargs, options, keys, &cache, 1);
+    if (cache != Qundef && !NIL_P(cache))
+        return parse_with_cache(self, options, cache);
+    return parse_with_options(self, options);
+}
+
+// NatalieParser#parse(locations: true, comments: true, cache: nil)
+//
+// With locations: false, the Sexps don't get a file, line, or column; with
+// comments: false, they don't get doc comments. Leaving out what you don't
+// need makes each Sexp just an Array, which is quicker to build.
+//
+// With cache: a directory, the tree is kept there (see ParseCache), and
+// parsing the same code again reads it back instead.
+VALUE parse_on_instance(int argc, VALUE *argv, VALUE self) {
+    VALUE kwargs;
+    rb_scan_args(argc, argv, "0:", &kwargs);
+    return parse_with_kwargs(self, kwargs);
 }
 
+// NatalieParser.parse(code, path = '(string)', locations: true, comments: true, cache: nil)
 VALUE parse(int argc, VALUE *argv, VALUE self) {
+    VALUE code, path, kwargs;
+    auto count = rb_scan_args(argc, argv, "11:", &code, &path, &kwargs);
+    VALUE args[] = { code, path };
+    VALUE parser = rb_class_new_instance(count, args, Parser);
+    return parse_with_kwargs(parser, kwargs);
+}
+
+// NatalieParser.serialize(code, path = '(string)', locations: true, comments: true)
+//
+// Parses the code into the binary form NatalieParser.deserialize (and
+// NatalieParser::BinaryAst) read back, without building any Ruby objects.
+VALUE serialize(int argc, VALUE *argv, VALUE self) {
+    VALUE code, path, kwargs;
+    rb_scan_args(argc, argv, "11:", &code, &path, &kwargs);
+    NatalieParser::MRICreatorOptions options;
+    get_creator_options(kwargs, options);
+    uint16_t flags = (options.locations ? NatalieParser::BinaryAst::Locations : 0) | (options.comments ? NatalieParser::BinaryAst::Comments : 0);
+    auto code_cstr = StringValueCStr(code);
+    auto path_cstr = NIL_P(path) ? "(string)" : StringValueCStr(path);
+    WithoutGvlError error;
+    VALUE result = Qnil;
+    {
+        TM::SharedPtr<TM::String> code_string = new TM::String { code_cstr };
+        TM::SharedPtr<TM::String> path_string = new TM::String { path_cstr };
+        TM::String binary;
+        error = call_without_gvl(code_string->length(), [&](const std::atomic<bool> *cancel_flag) {
+            auto parser = NatalieParser::Parser { code_string, path_string };
+            parser.set_cancel_flag(cancel_flag);
+            parser.set_keep_doc_comments(options.comments);
+            binary = NatalieParser::BinaryCreator::serialize(*parser.tree(), flags);
+        });
+        if (!error.is_error())
+            result = rb_str_new(binary.c_str(), binary.length());
+    }
+    raise_without_gvl_error(error);
+    return result;
+}
+
+// NatalieParser.deserialize(binary)
+//
+// The Sexp NatalieParser.parse would have given for the code that was
+// serialized. Raises ArgumentError if binary isn't a serialized tree.
+VALUE deserialize(VALUE self, VALUE binary) {
+    StringValue(binary);
+    const char *error = nullptr; // a string literal
+    VALUE sexp = Qnil;
+    int state = 0;
+    {
+        TM::Optional<NatalieParser::BinaryAst> ast;
+        try {
+            ast = NatalieParser::BinaryAst { RSTRING_PTR(binary), static_cast<size_t>(RSTRING_LEN(binary)) };
+        } catch (NatalieParser::BinaryAst::FormatError &e) {
+            error = e.message();
+        }
+        if (!error) {
+            NatalieParser::MRIBinaryReader reader { ast.value() };
+            sexp = protect([&]() { return reader.sexp(); }, &state);
+        }
+    }
+    if (error)
+        rb_raise(rb_eArgError, "%s", error);
+    if (state)
+        rb_jump_tag(state);
+    return sexp;
+}
+
+// NatalieParser.parse_lazy(code, path = '(string)', locations: true, comments: true)
+//
+// Like NatalieParser.parse, but returns a NatalieParser::LazyNode, which
+// only converts the parts of the tree that are looked at.
+VALUE parse_lazy(int argc, VALUE *argv, VALUE self) {
+    VALUE code, path, kwargs;
+    auto count = rb_scan_args(argc, argv, "11:", &code, &path, &kwargs);
+    VALUE args[] = { code, path };
+    VALUE parser = rb_class_new_instance(count, args, Parser);
+    NatalieParser::MRICreatorOptions options;
+    get_creator_options(kwargs, options);
+    WithoutGvlError error;
+    TM::SharedPtr<NatalieParser::MRILazyContext> context;
+    NatalieParser::NodePtr<NatalieParser::Node> root;
+    {
+        NatalieParser::Tree tree;
+        TM::SharedPtr<NatalieParser::SymbolTable> symbol_table;
+        error = parse_tree(parser, options, tree, symbol_table);
+        if (!error.is_error()) {
+            context = new NatalieParser::MRILazyContext { NatalieParser::MRISymbolCache { symbol_table }, options, tree.arena() };
+            root = tree.root();
+        }
+    }
+    raise_without_gvl_error(error);
+    return NatalieParser::mri_lazy_node_new(context, root, false, false);
+}
+
+VALUE lazy_node_sexp_type(VALUE self) {
+    return rb_ary_entry(lazy_node_sexp(self), 0);
+}
+
+VALUE lazy_node_aref(int argc, VALUE *argv, VALUE self) {
+    return rb_ary_aref(argc, argv, lazy_node_sexp(self));
+}
+
+VALUE lazy_node_size(VALUE self) {
+    return LONG2NUM(RARRAY_LEN(lazy_node_sexp(self)));
+}
+
+VALUE lazy_node_each(VALUE self) {
+    RETURN_ENUMERATOR(self, 0, nullptr);
+    VALUE sexp = lazy_node_sexp(self);
+    for (long i = 0; i < RARRAY_LEN(sexp); i++)
+        rb_yield(RARRAY_AREF(sexp, i));
+    return self;
+}
+
+// This node's Sexp, whose children are still LazyNodes. Having this also
+// lets a Sexp with LazyNodes in it compare equal to a fully built one.
+VALUE lazy_node_to_ary(VALUE self) {
+    return lazy_node_sexp(self);
+}
+
+VALUE lazy_node_file(VALUE self) {
+    return rb_ivar_get(lazy_node_sexp(self), NatalieParser::MRICreator::s_file_id);
+}
+
+VALUE lazy_node_line(VALUE self) {
+    return rb_ivar_get(lazy_node_sexp(self), NatalieParser::MRICreator::s_line_id);
+}
+
+VALUE lazy_node_column(VALUE self) {
+    return rb_ivar_get(lazy_node_sexp(self), NatalieParser::MRICreator::s_column_id);
+}
+
+VALUE lazy_node_comments(VALUE self) {
+    return rb_ivar_get(lazy_node_sexp(self), NatalieParser::MRICreator::s_comments_id);
+}
+
+// the whole Sexp for this node, the same as NatalieParser.parse would give
+VALUE lazy_node_to_sexp(VALUE self) {
+    auto data = lazy_node_data(self);
+    NatalieParser::MRICreator creator { *data->node, &data->context->symbols, data->context->options };
+    return lazy_node_build(data, creator);
+}
+
+VALUE lazy_node_equal(VALUE self, VALUE other) {
+    if (rb_typeddata_is_kind_of(other, &lazy_node_type))
+        other = lazy_node_to_sexp(other);
+    return rb_equal(lazy_node_to_sexp(self), other);
+}
+
+VALUE lazy_node_inspect(VALUE self) {
+    return rb_inspect(lazy_node_to_sexp(self));
+}
+
+static WithoutGvlError check_without_gvl(VALUE self) {
+    VALUE code = rb_ivar_get(self, rb_intern("@code"));
+    VALUE path = rb_ivar_get(self, rb_intern("@path"));
+    auto code_cstr = StringValueCStr(code);
+    auto path_cstr = StringValueCStr(path);
+    TM::SharedPtr<TM::String> code_string = new TM::String { code_cstr };
+    TM::SharedPtr<TM::String> path_string = new TM::String { path_cstr };
+    return call_without_gvl(code_string->length(), [&](const std::atomic<bool> *cancel_flag) {
+        auto parser = NatalieParser::Parser { code_string, path_string };
+        parser.set_cancel_flag(cancel_flag);
+        parser.check();
+    });
+}
+
+VALUE check_on_instance(VALUE self) {
+    raise_without_gvl_error(check_without_gvl(self));
+    return Qtrue;
+}
+
+VALUE check(int argc, VALUE *argv, VALUE self) {
     VALUE parser = rb_class_new_instance(argc, argv, Parser);
-    return parse_on_instance(parser);
+    return check_on_instance(parser);
 }
 
+VALUE is_valid(int argc, VALUE *argv, VALUE self) {
+    VALUE parser = rb_class_new_instance(argc, argv, Parser);
+    auto error = check_without_gvl(parser);
+    if (!error.is_syntax_error())
+        raise_without_gvl_error(error);
+    return error.is_syntax_error() ? Qfalse : Qtrue;
+}
+
+// token must be valid; see tokens_on_instance()
 VALUE token_to_ruby(NatalieParser::Token token, bool include_location_info) {
     if (token.is_eof())
         return Qnil;
-    try {
-        token.validate();
-    } catch (NatalieParser::Parser::SyntaxError &error) {
-        rb_raise(rb_eSyntaxError, "%s", error.message());
-    }
     const char *type = token.type_value();
     if (!type) abort(); // FIXME: assert no workie?
     auto hash = rb_hash_new();
@@ -113,16 +607,42 @@ VALUE token_to_ruby(NatalieParser::Token token, bool include_location_info) {
 VALUE tokens_on_instance(VALUE self, VALUE include_location_info = Qfalse) {
     VALUE code = rb_ivar_get(self, rb_intern("@code"));
     VALUE path = rb_ivar_get(self, rb_intern("@path"));
-    auto code_string = new TM::String { StringValueCStr(code) };
-    auto path_string = new TM::String { StringValueCStr(path) };
-    auto lexer = NatalieParser::Lexer { code_string, path_string };
-    auto array = rb_ary_new();
-    auto the_tokens = lexer.tokens();
-    for (auto token : *the_tokens) {
-        auto token_value = token_to_ruby(token, RTEST(include_location_info));
-        if (token_value != Qnil && token_value != Qfalse)
-            rb_ary_push(array, token_value);
+    auto code_cstr = StringValueCStr(code);
+    auto path_cstr = StringValueCStr(path);
+    WithoutGvlError error;
+    VALUE array = Qnil;
+    int state = 0;
+    {
+        TM::SharedPtr<TM::Vector<NatalieParser::Token>> the_tokens;
+        NatalieParser::Source::Ref source;
+        TM::SharedPtr<TM::String> code_string = new TM::String { code_cstr };
+        TM::SharedPtr<TM::String> path_string = new TM::String { path_cstr };
+        error = call_without_gvl(code_string->length(), [&](const std::atomic<bool> *cancel_flag) {
+            auto lexer = NatalieParser::Lexer { code_string, path_string };
+            lexer.set_cancel_flag(cancel_flag);
+            the_tokens = lexer.tokens();
+            source = lexer.source();
+            // throws a SyntaxError for the first invalid token
+            for (auto token : *the_tokens) {
+                if (!token.is_eof())
+                    token.validate();
+            }
+        });
+        auto to_ruby = [&]() {
+            auto tokens = rb_ary_new();
+            for (auto token : *the_tokens) {
+                auto token_value = token_to_ruby(token, RTEST(include_location_info));
+                if (token_value != Qnil && token_value != Qfalse)
+                    rb_ary_push(tokens, token_value);
+            }
+            return tokens;
+        };
+        if (!error.is_error())
+            array = protect(to_ruby, &state);
     }
+    raise_without_gvl_error(error);
+    if (state)
+        rb_jump_tag(state);
     return array;
 }
 
@@ -132,14 +652,165 @@ VALUE tokens(int argc, VALUE *argv, VALUE self) {
     return tokens_on_instance(parser, include_location_info);
 }
 
+struct ParseFilesState {
+    ~ParseFilesState() {
+        delete batch;
+    }
+
+    TM::Vector<TM::String> paths {};
+    size_t thread_count { 0 };
+    NatalieParser::MRICreatorOptions options {};
+    NatalieParser::BatchParser *batch { nullptr };
+    NatalieParser::BatchParser::Result result {};
+    bool has_result { false };
+    VALUE results { Qnil };
+};
+
+static void *next_file_without_gvl(void *data) {
+    auto state = static_cast<ParseFilesState *>(data);
+    state->has_result = state->batch->next(state->result);
+    return nullptr;
+}
+
+static void cancel_batch(void *data) {
+    static_cast<ParseFilesState *>(data)->batch->cancel();
+}
+
+static VALUE batch_result_to_ruby(NatalieParser::BatchParser::Result &result, NatalieParser::MRICreatorOptions options) {
+    switch (result.status) {
+    case NatalieParser::BatchParser::Result::Status::Ok: {
+        NatalieParser::MRISymbolCache symbols { result.symbols };
+        return node_to_ruby(*result.tree, &symbols, options);
+    }
+    case NatalieParser::BatchParser::Result::Status::ReadError:
+        return rb_syserr_new_str(result.error_number, rb_utf8_str_new(result.path.c_str(), result.path.length()));
+    case NatalieParser::BatchParser::Result::Status::SyntaxError:
+        return rb_exc_new_str(rb_eSyntaxError, rb_utf8_str_new(result.error_message.c_str(), result.error_message.length()));
+    }
+    return Qnil;
+}
+
+static VALUE parse_files_body(VALUE data) {
+    auto state = reinterpret_cast<ParseFilesState *>(data);
+    size_t converted;
+    while ((converted = RARRAY_LEN(state->results)) < state->paths.size()) {
+        // start (or, after an interrupt that didn't raise, start over) with
+        // the files we don't have yet
+        TM::Vector<TM::String> remaining {};
+        for (size_t i = converted; i < state->paths.size(); i++)
+            remaining.push(state->paths[i]);
+        delete state->batch;
+        state->batch = nullptr;
+        state->batch = new NatalieParser::BatchParser { remaining, state->thread_count };
+
+        // the workers parse in the background; only the conversion to
+        // Sexp happens here, while holding the GVL
+        for (;;) {
+            rb_thread_call_without_gvl(next_file_without_gvl, state, cancel_batch, state);
+            if (!state->has_result)
+                break;
+            // a file whose Sexp can't be built (a bad regexp literal) gets
+            // the exception, like one that can't be parsed
+            int raised = 0;
+            auto result = protect([&]() { return batch_result_to_ruby(state->result, state->options); }, &raised);
+            if (raised) {
+                result = rb_errinfo();
+                if (!RB_TYPE_P(result, T_OBJECT) || !rb_obj_is_kind_of(result, rb_eStandardError))
+                    rb_jump_tag(raised);
+                rb_set_errinfo(Qnil);
+            }
+            rb_ary_push(state->results, result);
+            state->result = {};
+        }
+        if ((size_t)RARRAY_LEN(state->results) < state->paths.size())
+            rb_thread_check_ints();
+    }
+    return state->results;
+}
+
+static VALUE parse_files_ensure(VALUE data) {
+    delete reinterpret_cast<ParseFilesState *>(data);
+    return Qnil;
+}
+
+// NatalieParser.parse_files(paths, threads: nil, locations: true, comments: true)
+//
+// Reads and parses the files on a pool of native threads. Returns an Array
+// in the same order as paths, holding the Sexp for each file, or the
+// exception (SyntaxError, SystemCallError, or one raised while building
+// the Sexp, such as RegexpError) for files that couldn't be parsed, read,
+// or converted. threads defaults to one per core. locations: and
+// comments: are the same as for NatalieParser#parse.
+VALUE parse_files(int argc, VALUE *argv, VALUE self) {
+    VALUE paths, options;
+    rb_scan_args(argc, argv, "1:", &paths, &options);
+    size_t thread_count = 0;
+    NatalieParser::MRICreatorOptions creator_options;
+    if (!NIL_P(options)) {
+        ID keys[] = { rb_intern("threads") };
+        VALUE values[1];
+        get_creator_options(options, creator_options, keys, values, 1);
+        if (values[0] != Qundef && !NIL_P(values[0])) {
+            int threads = NUM2INT(values[0]);
+            if (threads < 1)
+                rb_raise(rb_eArgError, "threads must be at least 1 (given %d)", threads);
+            thread_count = threads;
+        }
+    }
+    paths = rb_Array(paths);
+    VALUE path_strings = rb_ary_new_capa(RARRAY_LEN(paths));
+    for (long i = 0; i < RARRAY_LEN(paths); i++)
+        rb_ary_push(path_strings, rb_get_path(RARRAY_AREF(paths, i)));
+
+    auto state = new ParseFilesState {};
+    for (long i = 0; i < RARRAY_LEN(path_strings); i++) {
+        VALUE path = RARRAY_AREF(path_strings, i);
+        state->paths.push(TM::String { RSTRING_PTR(path), (size_t)RSTRING_LEN(path) });
+    }
+    state->thread_count = thread_count;
+    state->options = creator_options;
+    // state is malloc'd, where the GC can't see it, so results has to stay
+    // on the stack too until we're done adding to it
+    VALUE results = rb_ary_new_capa(RARRAY_LEN(path_strings));
+    state->results = results;
+    rb_ensure(parse_files_body, reinterpret_cast<VALUE>(state), parse_files_ensure, reinterpret_cast<VALUE>(state));
+    RB_GC_GUARD(results);
+    return results;
+}
+
 void Init_natalie_parser() {
     int error;
     Sexp = rb_const_get(rb_cObject, rb_intern("Sexp"));
+    NatalieParser::MRICreator::init_ids();
     Parser = rb_define_class("NatalieParser", rb_cObject);
     rb_define_method(Parser, "initialize", initialize, -1);
-    rb_define_method(Parser, "parse", parse_on_instance, 0);
+    rb_define_method(Parser, "parse", parse_on_instance, -1);
+    rb_define_method(Parser, "check", check_on_instance, 0);
     rb_define_method(Parser, "tokens", tokens_on_instance, 1);
     rb_define_singleton_method(Parser, "parse", parse, -1);
+    rb_define_singleton_method(Parser, "check", check, -1);
+    rb_define_singleton_method(Parser, "valid?", is_valid, -1);
     rb_define_singleton_method(Parser, "tokens", tokens, -1);
+    rb_define_singleton_method(Parser, "parse_files", parse_files, -1);
+    rb_define_singleton_method(Parser, "parse_lazy", parse_lazy, -1);
+    rb_define_singleton_method(Parser, "serialize", serialize, -1);
+    rb_define_singleton_method(Parser, "deserialize", deserialize, 1);
+
+    LazyNode = rb_define_class_under(Parser, "LazyNode", rb_cObject);
+    rb_undef_alloc_func(LazyNode);
+    rb_include_module(LazyNode, rb_mEnumerable);
+    rb_define_method(LazyNode, "sexp_type", lazy_node_sexp_type, 0);
+    rb_define_method(LazyNode, "[]", lazy_node_aref, -1);
+    rb_define_method(LazyNode, "size", lazy_node_size, 0);
+    rb_define_method(LazyNode, "length", lazy_node_size, 0);
+    rb_define_method(LazyNode, "each", lazy_node_each, 0);
+    rb_define_method(LazyNode, "to_ary", lazy_node_to_ary, 0);
+    rb_define_method(LazyNode, "file", lazy_node_file, 0);
+    rb_define_method(LazyNode, "line", lazy_node_line, 0);
+    rb_define_method(LazyNode, "column", lazy_node_column, 0);
+    rb_define_method(LazyNode, "comments", lazy_node_comments, 0);
+    rb_define_method(LazyNode, "to_sexp", lazy_node_to_sexp, 0);
+    rb_define_method(LazyNode, "==", lazy_node_equal, 1);
+    rb_define_method(LazyNode, "inspect", lazy_node_inspect, 0);
 }
 }
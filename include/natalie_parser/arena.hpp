@@ -0,0 +1,324 @@
+#pragma once
+
+#include <atomic>
+#include <initializer_list>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "natalie_parser/source.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+// A bump allocator that owns everything one parse builds. While an Arena is
+// current on this thread (see Arena::Scope), nodes and their child vectors
+// (see ArenaVector) are carved out of large chunks instead of going to
+// malloc one at a time. Nodes point to each other with plain pointers (see
+// NodePtr), so there are no reference counts to maintain while parsing or
+// to walk while tearing down: when the last reference to the Arena goes
+// away, it runs the node destructors in one pass over its chunks (they
+// only release what a node holds outside the arena, such as its strings)
+// and then frees the chunks.
+//
+// An Arena also keeps alive the Source its nodes' tokens point into, and
+// any other arenas its nodes point into (see IncrementalParser).
+class Arena {
+public:
+    // run on an allocation when its Arena goes away
+    using Finalizer = void (*)(void *);
+
+    Arena() { }
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // A counted reference to an Arena, which is freed along with everything
+    // allocated in it when the last one goes away.
+    class Ref {
+    public:
+        Ref() { }
+
+        Ref(Arena *arena)
+            : m_arena { arena } {
+            if (m_arena)
+                m_arena->m_ref_count++;
+        }
+
+        Ref(const Ref &other)
+            : Ref { other.m_arena } { }
+
+        Ref(Ref &&other)
+            : m_arena { other.m_arena } {
+            other.m_arena = nullptr;
+        }
+
+        ~Ref() { release(); }
+
+        Ref &operator=(const Ref &other) {
+            if (other.m_arena)
+                other.m_arena->m_ref_count++;
+            release();
+            m_arena = other.m_arena;
+            return *this;
+        }
+
+        Ref &operator=(Ref &&other) {
+            if (this == &other)
+                return *this;
+            release();
+            m_arena = other.m_arena;
+            other.m_arena = nullptr;
+            return *this;
+        }
+
+        Arena *operator->() const {
+            assert(m_arena);
+            return m_arena;
+        }
+
+        Arena &operator*() const {
+            assert(m_arena);
+            return *m_arena;
+        }
+
+        Arena *ptr() const { return m_arena; }
+
+        operator bool() const { return !!m_arena; }
+
+    private:
+        void release() {
+            if (m_arena && --m_arena->m_ref_count == 0)
+                delete m_arena;
+            m_arena = nullptr;
+        }
+
+        Arena *m_arena { nullptr };
+    };
+
+    class Scope {
+    public:
+        Scope(Arena &arena)
+            : m_previous { s_current } {
+            s_current = &arena;
+        }
+
+        ~Scope() {
+            s_current = m_previous;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Arena *m_previous;
+    };
+
+    static Arena *current() { return s_current; }
+
+    // Allocates size bytes in the current Arena, which must exist.
+    // finalize, if given, gets the allocation when the Arena goes away.
+    static void *allocate(size_t size, Finalizer finalize = nullptr);
+
+    // Takes the finalizer back from an allocation whose object was never
+    // finished (its constructor threw).
+    static void abandon(void *ptr);
+
+    void keep(Source::Ref source) { m_sources.push(source); }
+    void keep(Ref arena) { m_arenas.push(arena); }
+
+    // how many times arenas have gone to malloc, for benchmarks that count
+    // heap allocations
+    static size_t malloc_count() { return s_malloc_count.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk;
+
+    void *allocate_in_chunk(size_t size, Finalizer finalize);
+    void *allocate_in_own_chunk(size_t size, Finalizer finalize);
+    static Chunk *new_chunk(size_t capacity);
+
+    Chunk *m_chunks { nullptr }; // the one being allocated from first
+    unsigned int m_ref_count { 0 };
+    Vector<Source::Ref> m_sources {};
+    Vector<Ref> m_arenas {};
+
+    static inline thread_local Arena *s_current { nullptr };
+    static inline std::atomic<size_t> s_malloc_count { 0 };
+};
+
+// A Vector of plain values (such as NodePtrs) for the children of a node.
+// Its storage comes from the Arena that is current when it grows, and is
+// freed with that Arena; outside of an Arena (a node built on the stack
+// during a transform), it comes from the heap and is freed with the vector.
+template <typename T>
+class ArenaVector {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+public:
+    ArenaVector() { }
+
+    ArenaVector(std::initializer_list<T> list) {
+        grow_at_least(list.size());
+        for (auto &item : list)
+            push(item);
+    }
+
+    ArenaVector(const ArenaVector &other) {
+        grow_at_least(other.m_size);
+        copy_from(other);
+    }
+
+    ArenaVector(ArenaVector &&other)
+        : m_data { other.m_data }
+        , m_size { other.m_size }
+        , m_capacity { other.m_capacity }
+        , m_heap { other.m_heap } {
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_capacity = 0;
+        other.m_heap = false;
+    }
+
+    ArenaVector &operator=(const ArenaVector &other) {
+        if (this == &other)
+            return *this;
+        grow_at_least(other.m_size);
+        copy_from(other);
+        return *this;
+    }
+
+    ArenaVector &operator=(ArenaVector &&other) {
+        if (this == &other)
+            return *this;
+        destroy();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        m_heap = other.m_heap;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_capacity = 0;
+        other.m_heap = false;
+        return *this;
+    }
+
+    ~ArenaVector() { destroy(); }
+
+    T &operator[](size_t index) const {
+        assert(index < m_size);
+        return m_data[index];
+    }
+
+    T &at(size_t index) const {
+        assert(index < m_size);
+        return m_data[index];
+    }
+
+    T &first() const {
+        assert(m_size > 0);
+        return m_data[0];
+    }
+
+    T &last() const {
+        assert(m_size > 0);
+        return m_data[m_size - 1];
+    }
+
+    void push(T value) {
+        grow_at_least(m_size + 1);
+        m_data[m_size++] = value;
+    }
+
+    void push_front(T value) { insert(0, value); }
+
+    void insert(size_t index, T value) {
+        assert(index <= m_size);
+        grow_at_least(m_size + 1);
+        memmove(m_data + index + 1, m_data + index, (m_size - index) * sizeof(T));
+        m_data[index] = value;
+        m_size++;
+    }
+
+    T pop() {
+        assert(m_size > 0);
+        return m_data[--m_size];
+    }
+
+    T pop_front() {
+        assert(m_size > 0);
+        T value = m_data[0];
+        remove(0);
+        return value;
+    }
+
+    void remove(size_t index) {
+        assert(index < m_size);
+        memmove(m_data + index, m_data + index + 1, (m_size - index - 1) * sizeof(T));
+        m_size--;
+    }
+
+    void set_size(size_t new_size) {
+        grow_at_least(new_size);
+        for (size_t i = m_size; i < new_size; i++)
+            m_data[i] = T {};
+        m_size = static_cast<uint32_t>(new_size);
+    }
+
+    void clear() { m_size = 0; }
+
+    bool is_empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    T *data() const { return m_data; }
+
+    void grow_at_least(size_t min_capacity) {
+        if (m_capacity >= min_capacity)
+            return;
+        size_t new_capacity = m_capacity ? m_capacity * 2 : 4;
+        if (new_capacity < min_capacity)
+            new_capacity = min_capacity;
+        assert(new_capacity <= UINT32_MAX);
+        auto heap = !Arena::current();
+        T *new_data;
+        if (heap)
+            new_data = static_cast<T *>(::operator new(sizeof(T) * new_capacity));
+        else
+            new_data = static_cast<T *>(Arena::allocate(sizeof(T) * new_capacity));
+        if (m_size)
+            memcpy(new_data, m_data, m_size * sizeof(T));
+        destroy();
+        m_data = new_data;
+        m_capacity = static_cast<uint32_t>(new_capacity);
+        m_heap = heap;
+    }
+
+    T *begin() const { return m_data; }
+    T *end() const { return m_data + m_size; }
+
+private:
+    void copy_from(const ArenaVector &other) {
+        if (other.m_size)
+            memcpy(m_data, other.m_data, other.m_size * sizeof(T));
+        m_size = other.m_size;
+    }
+
+    // leaves m_size alone, for grow_at_least()
+    void destroy() {
+        if (m_heap)
+            ::operator delete(m_data);
+        m_data = nullptr;
+        m_capacity = 0;
+        m_heap = false;
+    }
+
+    T *m_data { nullptr };
+    uint32_t m_size { 0 };
+    uint32_t m_capacity { 0 };
+    bool m_heap { false };
+};
+
+}
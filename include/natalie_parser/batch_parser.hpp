@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "natalie_parser/node.hpp"
+#include "natalie_parser/symbol_table.hpp"
+#include "natalie_parser/tree.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// Reads and parses many files at once on a pool of threads.
+//
+// Each worker claims the next unparsed file, then reads, lexes, and parses
+// it with its own Parser, so nothing but the queue is shared. Results are
+// handed back on the calling thread in the same order the paths were given,
+// which lets the caller turn each tree into something else (e.g. a Ruby
+// Sexp) while the workers carry on with later files. Workers stay at most
+// a fixed number of files ahead of the caller, so finished trees don't pile
+// up in memory when the caller is the slow part.
+//
+//     BatchParser batch { paths, 8 };
+//     BatchParser::Result result;
+//     while (batch.next(result)) { ... }
+class BatchParser {
+public:
+    struct Result {
+        enum class Status {
+            Ok,
+            ReadError,
+            SyntaxError,
+        };
+
+        String path {};
+        Status status { Status::Ok };
+        Tree tree {};
+        SharedPtr<SymbolTable> symbols {};
+        int error_number { 0 }; // errno, for ReadError
+        String error_message {}; // for SyntaxError
+    };
+
+    // A thread_count of 0 means one per core.
+    BatchParser(Vector<String> paths, size_t thread_count = 0);
+
+    // Cancels whatever is left and waits for the workers to stop.
+    ~BatchParser();
+
+    BatchParser(const BatchParser &) = delete;
+    BatchParser &operator=(const BatchParser &) = delete;
+
+    // Blocks until the next file (in the order given) is done and stores
+    // its result. Returns false once every result has been handed out, or
+    // if the batch was cancelled.
+    bool next(Result &result);
+
+    // Stops the workers as soon as possible, including any parse that is
+    // in progress, and wakes up next(). Safe to call from any thread.
+    void cancel();
+
+    bool is_cancelled() const { return m_cancelled.load(); }
+    size_t thread_count() const { return m_threads.size(); }
+
+    // Parses everything and returns the results in the order given.
+    static Vector<Result> parse_files(Vector<String> paths, size_t thread_count = 0);
+
+private:
+    struct Slot {
+        Result result {};
+        bool ready { false };
+    };
+
+    void work();
+    void parse_file(Result &result);
+
+    Vector<String> m_paths;
+    Vector<Slot> m_slots;
+    size_t m_max_ahead { 0 };
+
+    std::mutex m_mutex {};
+    std::condition_variable m_work_available {};
+    std::condition_variable m_result_ready {};
+    size_t m_next_claim { 0 };
+    size_t m_next_result { 0 };
+    std::atomic<bool> m_cancelled { false };
+
+    std::vector<std::thread> m_threads {};
+};
+
+}
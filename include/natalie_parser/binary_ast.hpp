@@ -0,0 +1,199 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// Reads the binary form of a tree written by BinaryCreator, in place: it
+// only ever points into the buffer it was given, which must outlive it.
+//
+// The format (all integers little-endian; "varint" is unsigned LEB128 and
+// "zigzag" a signed number zigzag-encoded into a varint):
+//
+//     header      "NPAB", u16 version, u16 flags, u32 file (string number),
+//                 u32 offset of the string table, u32 total size
+//     root value
+//     string table u32 count, u32 offset of each string plus one for the
+//                 end, all relative to the first string's first byte, then
+//                 the strings themselves, back to back
+//
+// A "string number" is a string's index in the table plus one, with 0
+// meaning none. Each value starts with its Kind byte:
+//
+//     Sexp        varint type (string number); varint line and column if
+//                 flags has Locations; varint comments (string number) if
+//                 flags has Comments; varint size of the children in
+//                 bytes; then the children
+//     Fixnum      zigzag
+//     Float       u64 (the bits of the double)
+//     Bignum, String, Symbol
+//                 varint string number
+//     Regexp      varint string number, varint options
+//     Range       u8 1 if it excludes the end, zigzag first, zigzag last
+//     Complex, Rational
+//                 the number they wrap
+//     False, Nil, True
+//                 nothing
+//
+// Lines and columns are 0-based, as in the Node. Nothing in the format
+// depends on where the buffer is, so it can be written to disk or shared
+// between processes as is. Readers reject any other version.
+class BinaryAst {
+public:
+    static constexpr uint16_t Version = 1;
+    static constexpr size_t HeaderSize = 20;
+
+    enum Flags : uint16_t {
+        Locations = 1,
+        Comments = 2,
+    };
+
+    enum class Kind : uint8_t {
+        Sexp = 1,
+        Bignum,
+        Complex,
+        False,
+        Fixnum,
+        Float,
+        Nil,
+        Range,
+        Rational,
+        Regexp,
+        String,
+        Symbol,
+        True,
+    };
+
+    class FormatError {
+    public:
+        FormatError(const char *message)
+            : m_message { message } { }
+
+        const char *message() const { return m_message; }
+
+    private:
+        const char *m_message;
+    };
+
+    // some bytes in the buffer
+    struct Slice {
+        const char *data { nullptr };
+        size_t length { 0 };
+
+        bool is_empty() const { return length == 0; }
+        TM::String to_string() const { return TM::String { data, length }; }
+        bool operator==(const char *other) const { return length == strlen(other) && memcmp(data, other, length) == 0; }
+    };
+
+    class Value {
+    public:
+        Value(const BinaryAst &ast, size_t offset)
+            : m_ast { &ast }
+            , m_offset { offset } { }
+
+        Kind kind() const { return static_cast<Kind>(m_ast->m_data[m_offset]); }
+        bool is_sexp() const { return kind() == Kind::Sexp; }
+
+        // for Sexp
+        bool has_type() const { return type_number() > 0; }
+        Slice type() const { return m_ast->string(type_number()); }
+        uint32_t type_number() const;
+        size_t line() const;
+        size_t column() const;
+        bool has_comments() const { return comments_number() > 0; }
+        Slice comments() const { return m_ast->string(comments_number()); }
+        uint32_t comments_number() const;
+        size_t size() const;
+
+        template <typename F>
+        void each_child(F fn) const {
+            auto header = m_ast->sexp_header(m_offset);
+            for (auto offset = header.children; offset < header.end; offset = m_ast->skip(offset))
+                fn(Value { *m_ast, offset });
+        }
+
+        // for Fixnum and Range
+        long long fixnum() const;
+        long long range_first() const { return fixnum(); }
+        long long range_last() const;
+        bool range_excludes_end() const;
+
+        double float_value() const;
+
+        // for Bignum, Regexp, String, and Symbol
+        Slice string() const { return m_ast->string(string_number()); }
+        uint32_t string_number() const;
+
+        int regexp_options() const;
+
+        // for Complex and Rational
+        Value number() const { return Value { *m_ast, m_offset + 1 }; }
+
+        // same output as DebugCreator
+        TM::String to_string() const;
+
+        size_t offset() const { return m_offset; }
+
+    private:
+        const BinaryAst *m_ast;
+        size_t m_offset;
+    };
+
+    // Checks the header and every value, so nothing read afterwards can
+    // point outside the buffer. Throws FormatError.
+    BinaryAst(const char *data, size_t size);
+
+    BinaryAst(const TM::String &data)
+        : BinaryAst { data.c_str(), data.length() } { }
+
+    Value root() const { return Value { *this, HeaderSize }; }
+
+    uint16_t flags() const { return m_flags; }
+    bool has_locations() const { return m_flags & Locations; }
+    bool has_comments() const { return m_flags & Comments; }
+
+    bool has_file() const { return m_file > 0; }
+    Slice file() const { return string(m_file); }
+
+    size_t string_count() const { return m_string_count; }
+
+    // by string number (index + 1); number 0 gives an empty Slice
+    Slice string(uint32_t number) const;
+
+    // total size, as given in the header, which may be less than the size
+    // of the buffer
+    size_t size() const { return m_size; }
+
+    // the total size given in a header, or 0 if these bytes don't start
+    // with one this version can read
+    static size_t size_from_header(const char *data, size_t size);
+
+private:
+    struct SexpHeader {
+        uint32_t type;
+        size_t line;
+        size_t column;
+        uint32_t comments;
+        size_t children;
+        size_t end;
+    };
+
+    SexpHeader sexp_header(size_t offset) const;
+    size_t skip(size_t offset) const;
+    void validate() const;
+
+    const unsigned char *m_data;
+    size_t m_size;
+    uint16_t m_flags { 0 };
+    uint32_t m_file { 0 };
+    size_t m_strings_offset { 0 };
+    uint32_t m_string_count { 0 };
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "natalie_parser/node_ptr.hpp"
 #include "tm/shared_ptr.hpp"
 #include "tm/string.hpp"
 #include "tm/vector.hpp"
@@ -21,10 +22,13 @@ public:
         , m_column { column } { }
 
     virtual void set_comments(const TM::String &comments) = 0;
+
+    // type (here and in wrap()) is always a string literal, so creators
+    // may cache things by its address.
     virtual void set_type(const char *type) = 0;
-    virtual void append(const TM::SharedPtr<Node> node) { append(*node); }
+    virtual void append(const NodePtr<Node> node) { append(*node); }
     virtual void append(const Node &node) = 0;
-    virtual void append_array(const TM::SharedPtr<ArrayNode> array) { append_array(*array); }
+    virtual void append_array(const NodePtr<ArrayNode> array) { append_array(*array); }
     virtual void append_array(const ArrayNode &array) = 0;
     virtual void append_false() = 0;
     virtual void append_bignum(TM::String &number) = 0;
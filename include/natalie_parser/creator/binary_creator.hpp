@@ -0,0 +1,69 @@
+#pragma once
+
+#include "natalie_parser/binary_ast.hpp"
+#include "natalie_parser/creator.hpp"
+#include "natalie_parser/node.hpp"
+#include "natalie_parser/symbol_table.hpp"
+
+namespace NatalieParser {
+
+// Writes a tree in the binary form described in binary_ast.hpp. As with
+// the other creators, each nested node gets its own BinaryCreator, but they
+// all write to the same buffer: a Sexp's children go straight into it, and
+// its header is slotted in front of them once they are all written.
+class BinaryCreator : public Creator {
+public:
+    // the whole tree, ready for BinaryAst to read
+    static String serialize(const Node &tree, uint16_t flags = BinaryAst::Locations | BinaryAst::Comments);
+
+    virtual ~BinaryCreator() { }
+
+    virtual void reset_sexp() override;
+    virtual void set_comments(const TM::String &comments) override;
+    virtual void set_type(const char *type) override;
+    virtual void append(const Node &node) override;
+    virtual void append_array(const ArrayNode &array) override;
+    virtual void append_false() override;
+    virtual void append_bignum(TM::String &number) override;
+    virtual void append_fixnum(long long number) override;
+    virtual void append_float(double number) override;
+    virtual void append_nil() override;
+    virtual void append_range(long long first, long long last, bool exclude_end) override;
+    virtual void append_regexp(TM::String &pattern, int options) override;
+    virtual void append_sexp(std::function<void(Creator *)> fn) override;
+    virtual void append_string(TM::String &string) override;
+    virtual void append_symbol(TM::String &name) override;
+    virtual void append_true() override;
+    virtual void make_complex_number() override;
+    virtual void make_rational_number() override;
+    virtual void wrap(const char *type) override;
+
+private:
+    struct Output {
+        uint16_t flags;
+        String buffer {};
+
+        // Strings are numbered in the order they are first written, so
+        // only the ones the tree uses end up in the table.
+        SymbolTable strings {};
+        Vector<uint32_t> numbers {};
+        Vector<SymbolTable::Id> order {};
+
+        uint32_t string_number(const char *string, size_t length);
+    };
+
+    BinaryCreator(Output &output, size_t line, size_t column);
+
+    void start_child();
+    void finish();
+
+    Output &m_output;
+    size_t m_start;
+    size_t m_last_child { 0 };
+    uint32_t m_type { 0 };
+    uint32_t m_comments { 0 };
+    size_t m_sexp_line;
+    size_t m_sexp_column;
+};
+
+}
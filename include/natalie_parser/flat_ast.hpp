@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "natalie_parser/node.hpp"
+#include "natalie_parser/symbol_table.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// A flat copy of the tree in the same shape the Creators see it (the
+// s-expression form), stored as one contiguous array of fixed-size records
+// linked by index. Records are laid out in roughly pre-order, so walking the
+// tree front to back is mostly a linear scan. Variable-sized data (names,
+// strings, numbers) lives in side arrays.
+class FlatAst {
+public:
+    using Index = uint32_t;
+    static constexpr Index None = UINT32_MAX;
+
+    enum class Kind : uint8_t {
+        Sexp,
+        Bignum,
+        Complex,
+        False,
+        Fixnum,
+        Float,
+        Nil,
+        Range,
+        Rational,
+        Regexp,
+        String,
+        Symbol,
+        True,
+    };
+
+    struct Record {
+        Kind kind;
+        uint16_t flags; // Regexp: options; Range: 1 if it excludes the end
+        uint32_t value; // see FlatAst::symbol(), string(), fixnum(), and float_value()
+        uint32_t line;
+        uint32_t column;
+        Index first_child;
+        Index next_sibling;
+    };
+
+    FlatAst(const Node &tree, SharedPtr<SymbolTable> symbols = new SymbolTable);
+
+    Index root() const { return 0; }
+    size_t size() const { return m_records.size(); }
+    const Record &operator[](Index index) const { return m_records[index]; }
+
+    // for Sexp (the type, or nullptr if it has none) and Symbol records
+    const String *symbol(const Record &record) const;
+
+    // for String, Bignum, and Regexp records
+    const String &string(const Record &record) const { return m_strings[record.value]; }
+
+    long long fixnum(const Record &record) const { return m_fixnums[record.value]; }
+    double float_value(const Record &record) const { return m_floats[record.value]; }
+
+    // doc comments attached to class, module, and def sexps
+    const String *comments(Index index) const;
+
+    template <typename F>
+    void each_child(Index index, F fn) const {
+        for (auto child = m_records[index].first_child; child != None; child = m_records[child].next_sibling)
+            fn(child);
+    }
+
+    // same output as DebugCreator
+    String to_string(Index index = 0) const;
+
+private:
+    friend class FlatCreator;
+
+    struct Comment {
+        Index record;
+        String text;
+    };
+
+    Index add_record(Kind kind, uint32_t value, size_t line, size_t column);
+    void set_comments(Index index, const String &comments);
+    void move_comments(Index from, Index to);
+    size_t find_comment(Index index) const;
+
+    SharedPtr<SymbolTable> m_symbols;
+    Vector<Record> m_records {};
+    Vector<String> m_strings {};
+    Vector<long long> m_fixnums {};
+    Vector<double> m_floats {};
+    Vector<Comment> m_comments {}; // sorted by record
+};
+
+}
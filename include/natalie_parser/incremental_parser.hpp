@@ -0,0 +1,74 @@
+#pragma once
+
+#include "natalie_parser/line_index.hpp"
+#include "natalie_parser/parser.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// Keeps the parse of a buffer up to date as it is edited, for editors.
+//
+// After an edit, parsing restarts at the last top-level expression that
+// begins a line before the edit (so the lexer starts from a clean state:
+// no open literal, no pending heredoc) and stops as soon as it is back in
+// step with the previous parse: at an expression that begins a line after
+// the edit, at the same place as before, with the same top-level locals
+// assigned. The expressions before the restart point and after that point
+// are reused as they are.
+//
+// Nodes only know their line and column, not their byte offset, so
+// expressions after the edit can only be reused if the edit did not add or
+// remove lines. Otherwise everything after the restart point is parsed
+// again.
+class IncrementalParser {
+public:
+    // Parses the whole buffer. Throws Parser::SyntaxError.
+    IncrementalParser(SharedPtr<String> code, SharedPtr<String> file);
+
+    // Replaces removed_length bytes at offset with inserted and updates the
+    // tree. Throws Parser::SyntaxError, after which the code is still
+    // updated but tree() is not. The next edit then parses everything that
+    // changed since the last edit that succeeded.
+    Tree edit(size_t offset, size_t removed_length, const String &inserted);
+
+    // the same tree Parser::tree() would give for code()
+    Tree tree() const { return m_tree; }
+
+    SharedPtr<String> code() const { return m_code; }
+
+    // how many top-level expressions the last edit parsed again
+    size_t reparsed_count() const { return m_reparsed_count; }
+
+private:
+    void parse_all();
+    void reparse_damage();
+    void build_tree();
+    bool is_restart_point(size_t offset) const;
+    size_t find_statement(size_t offset) const;
+
+    // how many parses (and versions of the code) the statements may come from
+    static constexpr size_t MAX_ARENAS = 8;
+
+    SharedPtr<String> m_code;
+    SharedPtr<String> m_file;
+    SharedPtr<LineIndex> m_line_index;
+    Vector<Parser::Statement> m_statements {};
+    Tree m_tree {};
+    size_t m_reparsed_count { 0 };
+
+    // m_statements and m_tree come from the last successful parse, when
+    // the code had m_base_line_count lines. If edits since then failed to
+    // parse, the code differs from that in [m_damage_start, m_damage_old_end),
+    // which is now [m_damage_start, m_damage_new_end).
+    size_t m_base_line_count { 0 };
+    bool m_damaged { false };
+    size_t m_damage_start { 0 };
+    size_t m_damage_old_end { 0 };
+    size_t m_damage_new_end { 0 };
+};
+
+}
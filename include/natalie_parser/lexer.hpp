@@ -1,5 +1,11 @@
 #pragma once
 
+#include <atomic>
+
+#include "natalie_parser/lexer/lexer_pool.hpp"
+#include "natalie_parser/lexer/lexer_state.hpp"
+#include "natalie_parser/line_index.hpp"
+#include "natalie_parser/symbol_table.hpp"
 #include "natalie_parser/token.hpp"
 #include "tm/shared_ptr.hpp"
 #include "tm/vector.hpp"
@@ -8,34 +14,92 @@ namespace NatalieParser {
 
 class Lexer {
 public:
-    Lexer(SharedPtr<String> input, SharedPtr<String> file)
-        : m_input { input }
+    Lexer(SharedPtr<String> input, SharedPtr<String> file, SharedPtr<SymbolTable> symbols = new SymbolTable)
+        : m_source { new Source { input, file, symbols } }
+        , m_input { input }
         , m_file { file }
+        , m_symbols { symbols }
+        , m_line_index { m_source->line_index() }
         , m_size { input->length() } { }
 
     Lexer(const Lexer &other, char start_char, char stop_char)
-        : m_input { other.m_input }
+        : m_source { other.m_source }
+        , m_input { other.m_input }
         , m_file { other.m_file }
+        , m_symbols { other.m_symbols }
+        , m_line_index { other.m_line_index }
         , m_size { other.m_size }
         , m_index { other.m_index }
-        , m_cursor_line { other.m_cursor_line }
-        , m_cursor_column { other.m_cursor_column }
-        , m_token_line { other.m_token_line }
-        , m_token_column { other.m_token_column }
+        , m_first_line { other.m_first_line }
+        , m_token_index { other.m_token_index }
+        , m_keep_doc_comments { other.m_keep_doc_comments }
         , m_stop_char { stop_char }
         , m_start_char { start_char } { }
 
+    // Resumes lexing input where the lexer that saved state left off.
+    // input may be an edited copy of that lexer's input, as long as nothing
+    // before state.lexed_end() has changed. (That is past state.index if
+    // a heredoc body was read ahead.)
+    Lexer(SharedPtr<String> input, SharedPtr<String> file, const LexerState &state, SharedPtr<SymbolTable> symbols = new SymbolTable)
+        : Lexer { input, file, symbols } {
+        restore(state);
+    }
+
+    // Name tokens point into source(); hold on to it for as long as the
+    // tokens are used after the Lexer is gone.
     SharedPtr<Vector<Token>> tokens();
     Token next_token();
 
+    // Returns the tokens the parser sees: comments are dropped, doc comments
+    // are attached to the following class/module/def, and newlines that
+    // don't end an expression are collapsed.
+    Token next_significant_token();
+
+    // Thrown by next_significant_token() (and so by tokens() and the
+    // Parser) once the flag given to set_cancel_flag() becomes true. This
+    // lets another thread stop a long-running lex or parse.
+    class Cancelled { };
+
+    void set_cancel_flag(const std::atomic<bool> *flag) { m_cancel_flag = flag; }
+
+    // When false, comments that would be attached to the following
+    // class/module/def as documentation are dropped like any other comment,
+    // without copying their text.
+    void set_keep_doc_comments(bool keep) { m_keep_doc_comments = keep; }
+
+    // A snapshot of where the lexer is, including any nested lexers, to
+    // hand back to restore() (or the constructor above) later.
+    LexerState state() const;
+    void restore(const LexerState &state);
+
     virtual ~Lexer() {
-        delete m_nested_lexer;
+        release_nested_lexer();
     }
 
     SharedPtr<String> file() const { return m_file; }
+    SharedPtr<SymbolTable> symbols() const { return m_symbols; }
 
-    size_t cursor_line() const { return m_cursor_line; }
-    void set_cursor_line(size_t cursor_line) { m_cursor_line = cursor_line; }
+    // Name tokens point into this; see Source::Ref.
+    Source::Ref source() const { return m_source; }
+
+    SharedPtr<LineIndex> line_index() const { return m_line_index; }
+
+    // The lexer only keeps track of a byte offset; these work out the line
+    // and column of that offset.
+    size_t cursor_line() const { return m_first_line + m_line_index->line(m_index); }
+    size_t cursor_column() const { return m_line_index->column(m_index); }
+
+    // Starts lexing at index instead of the beginning of the input, as if
+    // the line before it had just ended. index must be the start of a line
+    // that is not inside a literal or a heredoc body.
+    void seek(size_t index) {
+        m_index = index;
+        m_last_token = Token { Token::Type::Newline, m_source.ptr(), index, false };
+    }
+
+    // the line number of the start of the input, for heredoc bodies, which
+    // are lexed separately from the rest of the file
+    void set_first_line(size_t line) { m_first_line = line; }
 
     void set_nested_lexer(Lexer *lexer) { m_nested_lexer = lexer; }
     void set_start_char(char c) { m_start_char = c; }
@@ -43,7 +107,49 @@ public:
 
     virtual bool alters_parent_cursor_position() { return true; }
 
+    static constexpr LexerKind pool_kind = LexerKind::Plain;
+    virtual LexerKind kind() const { return pool_kind; }
+
 protected:
+    // Lexes input, a separate string such as a heredoc body, for the same
+    // Source as parent.
+    Lexer(const Lexer &parent, SharedPtr<String> input)
+        : m_source { parent.m_source }
+        , m_input { input }
+        , m_file { parent.m_file }
+        , m_symbols { parent.m_symbols }
+        , m_line_index { new LineIndex { *input } }
+        , m_size { input->length() } { }
+
+    // Starts lexing a nested literal with a T, taking a finished one from
+    // the pool and resetting it if we can. The arguments are the same as
+    // for T's constructor.
+    template <typename T, typename... Args>
+    void start_nested_lexer(Args &&...args) {
+        if (!m_pool)
+            m_pool = new LexerPool;
+        auto lexer = static_cast<T *>(m_pool->acquire(T::pool_kind));
+        if (lexer)
+            lexer->reset(std::forward<Args>(args)...);
+        else
+            lexer = new T { std::forward<Args>(args)... };
+        lexer->m_pool = m_pool;
+        m_nested_lexer = lexer;
+    }
+
+    void release_nested_lexer();
+
+    // Subclasses with state of their own save and restore it here too.
+    virtual void save_state(LexerState &state, const Lexer *parent) const;
+    virtual void restore_state(const LexerState &state);
+
+    // These put a pooled lexer in the same state as the matching
+    // constructor, but keep the buffers it already has.
+    void reset(const Lexer &other);
+    void reset(const Lexer &other, char start_char, char stop_char);
+    void reset(const Lexer &parent, SharedPtr<String> input);
+    void clear_state();
+
     char current_char() {
         if (m_index >= m_size)
             return 0;
@@ -52,9 +158,10 @@ protected:
     }
 
     bool match(size_t bytes, const char *compare);
-    void advance();
-    void advance(size_t bytes);
-    void rewind(size_t bytes = 1);
+    Token::Type match_keyword();
+    void advance() { m_index++; }
+    void advance(size_t bytes) { m_index += bytes; }
+    void rewind(size_t bytes = 1) { m_index -= bytes; }
 
     char next() {
         advance();
@@ -70,13 +177,31 @@ protected:
     virtual bool skip_whitespace();
     virtual Token build_next_token();
     Token consume_symbol();
-    SharedPtr<String> consume_word();
+    SharedPtr<String> slice_input(size_t start) const;
+    Token name_token(Token::Type type, size_t start, size_t length);
+    Token name_token(Token::Type type, size_t start);
+
+    // a token starting at index, or where the current one did
+    Token make_token_at(size_t index, Token::Type type) const;
+    Token make_token_at(size_t index, Token::Type type, Source::TokenValue value) const;
+    Token make_token_at(size_t index, Token::Type type, SharedPtr<String> literal) const;
+    Token make_token_at(size_t index, Token::Type type, const char *literal) const;
+    Token make_token_at(size_t index, Token::Type type, char literal) const;
+    Token make_token_at(size_t index, Token::Type type, long long fixnum) const;
+    Token make_token_at(size_t index, Token::Type type, double dbl) const;
+
+    template <typename... Args>
+    Token make_token(Token::Type type, Args... args) const {
+        return make_token_at(m_token_index, type, args...);
+    }
+    void consume_word();
     Token consume_word(Token::Type type);
     Token consume_bare_name_or_constant(Token::Type type);
     Token consume_global_variable();
     Token consume_heredoc();
     Token consume_numeric();
-    Token consume_numeric_as_float(SharedPtr<String>);
+    Token consume_integer(int base, const char *bignum_prefix);
+    Token consume_numeric_as_float(size_t start_index);
     Token consume_nth_ref();
     long long consume_hex_number(int max_length = 0, bool allow_underscore = false);
     long long consume_octal_number(int max_length = 0, bool allow_underscore = false);
@@ -98,29 +223,29 @@ protected:
     void utf32_codepoint_to_utf8(String &buf, long long codepoint);
     std::pair<bool, Token::Type> consume_escaped_byte(String &buf);
 
-    Token chars_to_fixnum_or_bignum_token(SharedPtr<String> chars, int base, int offset);
-
     bool token_is_first_on_line() const;
 
-    bool char_can_be_string_or_regexp_delimiter(char c) const {
-        return (c >= '!' && c <= '/') || c == ':' || c == ';' || c == '=' || c == '?' || c == '@' || c == '\\' || c == '~' || c == '|' || (c >= '^' && c <= '`');
-    }
+    // false while lexing a heredoc body, which is a copy
+    bool reads_source() const { return m_input == m_source->code(); }
+
+    Source::Ref m_source;
+
+    // tokens restored from a LexerState may come from another Source
+    Source::Ref m_state_source {};
 
     SharedPtr<String> m_input;
     SharedPtr<String> m_file;
+    SharedPtr<SymbolTable> m_symbols;
+    SharedPtr<LineIndex> m_line_index;
     size_t m_size { 0 };
     size_t m_index { 0 };
+    size_t m_first_line { 0 };
 
     // where we should jump after each heredoc
     Vector<size_t> m_heredoc_stack {};
 
-    // current character position
-    size_t m_cursor_line { 0 };
-    size_t m_cursor_column { 0 };
-
     // start of current token
-    size_t m_token_line { 0 };
-    size_t m_token_column { 0 };
+    size_t m_token_index { 0 };
 
     // if the current token is preceded by whitespace
     bool m_whitespace_precedes { false };
@@ -132,6 +257,9 @@ protected:
     bool m_open_ternary { false };
 
     Lexer *m_nested_lexer { nullptr };
+    SharedPtr<LexerPool> m_pool {};
+    const std::atomic<bool> *m_cancel_flag { nullptr };
+    bool m_keep_doc_comments { true };
 
     char m_stop_char { 0 };
 
@@ -140,6 +268,12 @@ protected:
     char m_start_char { 0 };
     int m_pair_depth { 0 };
 
+    // state for next_significant_token()
+    bool m_skip_next_newline { false };
+    Token m_last_doc_token {};
+    Vector<Token> m_pending_tokens {};
+    size_t m_pending_index { 0 };
+
     size_t m_remaining_method_names { 0 };
     bool m_allow_assignment_method { false };
     Token::Type m_method_name_separator { Token::Type::Invalid };
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace NatalieParser {
+
+// Character classes the lexers care about, looked up in a 256-entry table
+// instead of going through the (locale-aware) ctype functions or chains of
+// comparisons for every byte. Bytes >= 128 are treated as part of a name,
+// since that is how UTF-8 identifiers get through.
+namespace CharClass {
+    enum : uint16_t {
+        NameStart = 1 << 0, // a-z, _, and >= 128 (start of a local variable or method name)
+        Identifier = 1 << 1, // NameStart plus A-Z and 0-9
+        MessageSuffix = 1 << 2, // ? and !
+        Alpha = 1 << 3, // isalpha()
+        Alnum = 1 << 4, // isalnum()
+        DecimalDigit = 1 << 5,
+        HexDigit = 1 << 6,
+        Space = 1 << 7, // isspace()
+        Delimiter = 1 << 8, // can start a %-literal, e.g. %q(...)
+        RegexpOption = 1 << 9, // i, m, x, o, u, e, s, n
+    };
+}
+
+struct CharClassTable {
+    uint16_t classes[256];
+};
+
+constexpr CharClassTable build_char_class_table() {
+    CharClassTable table {};
+    for (int i = 0; i < 256; i++) {
+        char c = static_cast<char>(i);
+        bool lower = c >= 'a' && c <= 'z';
+        bool upper = c >= 'A' && c <= 'Z';
+        bool digit = c >= '0' && c <= '9';
+        bool high = i >= 128;
+        uint16_t bits = 0;
+        if (lower || c == '_' || high)
+            bits |= CharClass::NameStart;
+        if (lower || upper || digit || c == '_' || high)
+            bits |= CharClass::Identifier;
+        if (c == '?' || c == '!')
+            bits |= CharClass::MessageSuffix;
+        if (lower || upper)
+            bits |= CharClass::Alpha;
+        if (lower || upper || digit)
+            bits |= CharClass::Alnum;
+        if (digit)
+            bits |= CharClass::DecimalDigit;
+        if (digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+            bits |= CharClass::HexDigit;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r')
+            bits |= CharClass::Space;
+        if ((c >= '!' && c <= '/') || c == ':' || c == ';' || c == '=' || c == '?' || c == '@' || c == '\\' || c == '~' || c == '|' || (c >= '^' && c <= '`'))
+            bits |= CharClass::Delimiter;
+        if (c == 'i' || c == 'm' || c == 'x' || c == 'o' || c == 'u' || c == 'e' || c == 's' || c == 'n')
+            bits |= CharClass::RegexpOption;
+        table.classes[i] = bits;
+    }
+    return table;
+}
+
+inline constexpr CharClassTable char_class_table = build_char_class_table();
+
+constexpr bool char_is(char c, uint16_t classes) {
+    return char_class_table.classes[static_cast<unsigned char>(c)] & classes;
+}
+
+constexpr bool is_name_start_char(char c) { return char_is(c, CharClass::NameStart); }
+constexpr bool is_identifier_char(char c) { return char_is(c, CharClass::Identifier); }
+constexpr bool is_message_suffix(char c) { return char_is(c, CharClass::MessageSuffix); }
+constexpr bool is_identifier_char_or_message_suffix(char c) { return char_is(c, CharClass::Identifier | CharClass::MessageSuffix); }
+constexpr bool is_alpha_char(char c) { return char_is(c, CharClass::Alpha); }
+constexpr bool is_alnum_char(char c) { return char_is(c, CharClass::Alnum); }
+constexpr bool is_decimal_digit(char c) { return char_is(c, CharClass::DecimalDigit); }
+constexpr bool is_hex_digit(char c) { return char_is(c, CharClass::HexDigit); }
+constexpr bool is_space_char(char c) { return char_is(c, CharClass::Space); }
+constexpr bool is_regexp_option(char c) { return char_is(c, CharClass::RegexpOption); }
+
+static_assert(is_name_start_char('a') && is_name_start_char('_') && !is_name_start_char('A') && !is_name_start_char(0));
+static_assert(is_identifier_char('Z') && is_identifier_char('9') && is_identifier_char(static_cast<char>(0xe2)) && !is_identifier_char('-'));
+static_assert(is_space_char('\v') && !is_space_char(0) && is_hex_digit('F') && !is_hex_digit('g'));
+
+}
@@ -19,19 +19,56 @@ public:
 
     // used for lexing a Heredoc
     InterpolatedStringLexer(Lexer &parent_lexer, Token string_token, Token::Type end_type)
-        : Lexer { string_token.literal_string(), parent_lexer.file() }
+        : Lexer { parent_lexer, string_token.literal_string() }
         , m_end_type { end_type }
         , m_alters_parent_cursor_position { false } {
-        set_cursor_line(parent_lexer.cursor_line() + 1); // the line after the heredoc delimiter
+        set_first_line(parent_lexer.cursor_line() + 1); // the line after the heredoc delimiter
         set_nested_lexer(nullptr);
         set_stop_char(0);
     }
 
     virtual bool alters_parent_cursor_position() override { return m_alters_parent_cursor_position; }
 
+    static constexpr LexerKind pool_kind = LexerKind::InterpolatedString;
+    virtual LexerKind kind() const override { return pool_kind; }
+
 private:
+    friend class Lexer;
+
+    void reset(Lexer &parent_lexer, char start_char, char stop_char, Token::Type end_type) {
+        Lexer::reset(parent_lexer);
+        set_start_char(start_char == stop_char ? 0 : start_char);
+        set_stop_char(stop_char);
+        m_state = State::InProgress;
+        m_end_type = end_type;
+        m_alters_parent_cursor_position = true;
+    }
+
+    void reset(Lexer &parent_lexer, Token string_token, Token::Type end_type) {
+        Lexer::reset(parent_lexer, string_token.literal_string());
+        set_first_line(parent_lexer.cursor_line() + 1);
+        m_state = State::InProgress;
+        m_end_type = end_type;
+        m_alters_parent_cursor_position = false;
+    }
+
+    virtual void save_state(LexerState &state, const Lexer *parent) const override {
+        Lexer::save_state(state, parent);
+        state.literal_state = static_cast<int>(m_state);
+        state.end_type = m_end_type;
+        state.alters_parent_cursor_position = m_alters_parent_cursor_position;
+    }
+
+    virtual void restore_state(const LexerState &state) override {
+        Lexer::restore_state(state);
+        m_state = static_cast<State>(state.literal_state);
+        m_end_type = state.end_type;
+        m_alters_parent_cursor_position = state.alters_parent_cursor_position;
+    }
+
     virtual Token build_next_token() override;
     Token consume_string();
+    void consume_plain_run(String &buf);
     Token start_evaluation();
     Token stop_evaluation();
     Token finish();
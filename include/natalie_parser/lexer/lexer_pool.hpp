@@ -0,0 +1,45 @@
+#pragma once
+
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+class Lexer;
+
+enum class LexerKind {
+    Plain,
+    InterpolatedString,
+    Regexp,
+    WordArray,
+};
+
+// Nested lexers (for interpolation, regexps and word arrays) that have
+// finished their literal, kept around to lex the next one. Nested literals
+// always finish in the reverse order they started, so after the first few
+// of each kind, entering and leaving one is a pop and a push here instead
+// of a heap allocation and a copy of the parent lexer's buffers.
+class LexerPool {
+public:
+    LexerPool() { }
+    ~LexerPool();
+
+    LexerPool(const LexerPool &) = delete;
+    LexerPool &operator=(const LexerPool &) = delete;
+
+    // a finished lexer of the given kind, or nullptr if there is none
+    Lexer *acquire(LexerKind kind) {
+        auto &lexers = m_free[static_cast<size_t>(kind)];
+        if (lexers.is_empty())
+            return nullptr;
+        return lexers.pop();
+    }
+
+    void release(Lexer *lexer);
+
+private:
+    Vector<Lexer *> m_free[4] {};
+};
+
+}
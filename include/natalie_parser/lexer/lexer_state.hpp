@@ -0,0 +1,86 @@
+#pragma once
+
+#include "natalie_parser/lexer/lexer_pool.hpp"
+#include "natalie_parser/token.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// Everything a Lexer needs to carry on lexing from where it was, as
+// returned by Lexer::state(). Pass it to the Lexer constructor (or to
+// Lexer::restore()) to pick up again at the same place, for example from
+// a checkpoint taken every few hundred lines instead of from the start.
+//
+// Copies share the state of any nested lexers (we're in the middle of a
+// string, regexp or word array), which never changes once it is saved.
+struct LexerState {
+    LexerKind kind { LexerKind::Plain };
+
+    // keeps the name tokens below valid
+    Source::Ref source {};
+
+    // byte offset to continue from
+    size_t index { 0 };
+
+    // Heredoc bodies are lexed from a copy of the body; other nested lexers
+    // read their parent's input, and leave this null.
+    SharedPtr<String> input {};
+    size_t first_line { 0 };
+
+    size_t token_index { 0 };
+    Vector<size_t> heredoc_stack {};
+    bool whitespace_precedes { false };
+    Token last_token {};
+    bool open_ternary { false };
+    char stop_char { 0 };
+    char start_char { 0 };
+    int pair_depth { 0 };
+
+    bool skip_next_newline { false };
+    Token last_doc_token {};
+    Vector<Token> pending_tokens {};
+    size_t pending_index { 0 };
+
+    size_t remaining_method_names { 0 };
+    bool allow_assignment_method { false };
+    Token::Type method_name_separator { Token::Type::Invalid };
+    Token last_method_name {};
+
+    // for InterpolatedStringLexer, RegexpLexer and WordArrayLexer
+    int literal_state { 0 };
+    Token::Type end_type { Token::Type::Invalid };
+    bool alters_parent_cursor_position { true };
+    bool interpolated { false };
+    char array_start_char { 0 };
+    int array_pair_depth { 0 };
+    SharedPtr<String> buffer {};
+
+    SharedPtr<LexerState> nested {};
+
+    // How much of the input the lexer has already read. This is usually
+    // index, but once a heredoc has started, its body (which comes after
+    // the rest of the line) has been read too, and a nested lexer may be
+    // further along than its parent. A lexer resumed from this state may be
+    // given an edited copy of the input, as long as nothing before this
+    // offset changed.
+    size_t lexed_end() const {
+        size_t end = index;
+        for (auto heredoc_end : heredoc_stack) {
+            if (heredoc_end > end)
+                end = heredoc_end;
+        }
+        // a heredoc body's lexer reads its own copy of the body
+        if (nested && !nested->input) {
+            auto nested_end = nested->lexed_end();
+            if (nested_end > end)
+                end = nested_end;
+        }
+        return end;
+    }
+};
+
+}
@@ -16,7 +16,32 @@ public:
         set_stop_char(stop_char);
     }
 
+    static constexpr LexerKind pool_kind = LexerKind::Regexp;
+    virtual LexerKind kind() const override { return pool_kind; }
+
 private:
+    friend class Lexer;
+
+    void reset(Lexer &parent_lexer, char start_char, char stop_char) {
+        Lexer::reset(parent_lexer);
+        set_start_char(start_char == stop_char ? 0 : start_char);
+        set_stop_char(stop_char);
+        m_state = State::InProgress;
+        m_options = SharedPtr<String> {};
+    }
+
+    virtual void save_state(LexerState &state, const Lexer *parent) const override {
+        Lexer::save_state(state, parent);
+        state.literal_state = static_cast<int>(m_state);
+        state.buffer = m_options;
+    }
+
+    virtual void restore_state(const LexerState &state) override {
+        Lexer::restore_state(state);
+        m_state = static_cast<State>(state.literal_state);
+        m_options = state.buffer;
+    }
+
     virtual Token build_next_token() override;
     Token consume_regexp();
     String *consume_options();
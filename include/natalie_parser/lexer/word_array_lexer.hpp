@@ -17,7 +17,40 @@ public:
         set_stop_char(stop_char);
     }
 
+    static constexpr LexerKind pool_kind = LexerKind::WordArray;
+    virtual LexerKind kind() const override { return pool_kind; }
+
 private:
+    friend class Lexer;
+
+    void reset(Lexer &parent_lexer, char start_char, char stop_char, bool interpolated) {
+        Lexer::reset(parent_lexer);
+        set_stop_char(stop_char);
+        m_state = State::InProgress;
+        m_interpolated = interpolated;
+        m_start_char = start_char;
+        m_pair_depth = 0;
+        m_buffer = SharedPtr<String> {};
+    }
+
+    virtual void save_state(LexerState &state, const Lexer *parent) const override {
+        Lexer::save_state(state, parent);
+        state.literal_state = static_cast<int>(m_state);
+        state.interpolated = m_interpolated;
+        state.array_start_char = m_start_char;
+        state.array_pair_depth = m_pair_depth;
+        state.buffer = m_buffer;
+    }
+
+    virtual void restore_state(const LexerState &state) override {
+        Lexer::restore_state(state);
+        m_state = static_cast<State>(state.literal_state);
+        m_interpolated = state.interpolated;
+        m_start_char = state.array_start_char;
+        m_pair_depth = state.array_pair_depth;
+        m_buffer = state.buffer;
+    }
+
     virtual Token build_next_token() override;
     Token consume_array();
 
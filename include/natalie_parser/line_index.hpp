@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// The byte offset where each line of a source string starts, so the lexer
+// can keep track of just a byte offset and turn it into a line and column
+// only when a token needs one.
+class LineIndex {
+public:
+    LineIndex(const String &source);
+
+    size_t line_count() const { return m_line_starts.size(); }
+
+    // zero-based line number of the byte at offset
+    size_t line(size_t offset) const;
+
+    // zero-based column of the byte at offset
+    size_t column(size_t offset) const {
+        return offset - m_line_starts[line(offset)];
+    }
+
+    size_t line_start(size_t line) const { return m_line_starts[line]; }
+
+    // offset of the newline ending the line (or the end of the source)
+    size_t line_end(size_t line) const {
+        return line + 1 < m_line_starts.size() ? m_line_starts[line + 1] - 1 : m_source_size;
+    }
+
+private:
+    Vector<size_t> m_line_starts {};
+    size_t m_source_size { 0 };
+
+    // Offsets are nearly always looked up in increasing order, so we start
+    // by checking the line of the last lookup and the one after it. Tokens
+    // look up their line here (see Token::line()), possibly from several
+    // threads, so this is only a hint.
+    mutable std::atomic<size_t> m_last_line { 0 };
+};
+
+}
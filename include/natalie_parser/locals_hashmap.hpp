@@ -0,0 +1,76 @@
+#pragma once
+
+#include "natalie_parser/symbol_table.hpp"
+#include "natalie_parser/token.hpp"
+#include "tm/hashmap.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// The local variable names visible in a scope. Names are stored as their
+// interned String from the SymbolTable, so lookups hash a pointer rather
+// than the characters of the name.
+//
+// Blocks get a child scope that points at its parent: lookups walk up the
+// chain, but new locals are only recorded in the child, so entering a block
+// doesn't copy anything.
+class LocalsHashmap {
+public:
+    LocalsHashmap(SharedPtr<SymbolTable> symbols)
+        : m_symbols { symbols } { }
+
+    explicit LocalsHashmap(const LocalsHashmap *parent)
+        : m_symbols { parent->m_symbols }
+        , m_parent { parent } { }
+
+    LocalsHashmap(const LocalsHashmap &) = delete;
+    LocalsHashmap &operator=(const LocalsHashmap &) = delete;
+
+    bool get(const Token &token) const {
+        if (token.is_span()) {
+            auto id = m_symbols->lookup(token.span(), token.span_length());
+            return id && get(id);
+        }
+        return get(*token.literal_string());
+    }
+
+    bool get(SymbolTable::Id id) const {
+        auto name = m_symbols->string(id).ptr();
+        for (auto scope = this; scope; scope = scope->m_parent) {
+            if (scope->m_names.get(name))
+                return true;
+        }
+        return false;
+    }
+
+    bool get(const String &name) const {
+        auto id = m_symbols->lookup(name);
+        return id && get(id);
+    }
+
+    void set(const String &name) {
+        auto string = m_symbols->string(m_symbols->intern(name));
+        if (m_new_names && !m_names.get(string.ptr()))
+            m_new_names->push(string);
+        m_names.set(string.ptr());
+    }
+
+    void set(const char *name) {
+        set(String(name));
+    }
+
+    // From now on, push each name that is new to this scope onto names.
+    void record_new_names(Vector<SharedPtr<String>> *names) { m_new_names = names; }
+
+private:
+    SharedPtr<SymbolTable> m_symbols;
+    const LocalsHashmap *m_parent { nullptr };
+    Hashmap<const String *> m_names {};
+    Vector<SharedPtr<String>> *m_new_names { nullptr };
+};
+
+}
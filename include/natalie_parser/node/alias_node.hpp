@@ -13,7 +13,7 @@ using namespace TM;
 
 class AliasNode : public Node {
 public:
-    AliasNode(const Token &token, SharedPtr<SymbolNode> new_name, SharedPtr<SymbolNode> existing_name)
+    AliasNode(const Token &token, NodePtr<SymbolNode> new_name, NodePtr<SymbolNode> existing_name)
         : Node { token }
         , m_new_name { new_name }
         , m_existing_name { existing_name } {
@@ -23,13 +23,13 @@ public:
 
     virtual Type type() const override { return Type::Alias; }
 
-    const SharedPtr<SymbolNode> new_name() const { return m_new_name; }
-    const SharedPtr<SymbolNode> existing_name() const { return m_existing_name; }
+    const NodePtr<SymbolNode> new_name() const { return m_new_name; }
+    const NodePtr<SymbolNode> existing_name() const { return m_existing_name; }
 
     virtual void transform(Creator *creator) const override;
 
 private:
-    SharedPtr<SymbolNode> m_new_name {};
-    SharedPtr<SymbolNode> m_existing_name {};
+    NodePtr<SymbolNode> m_new_name {};
+    NodePtr<SymbolNode> m_existing_name {};
 };
 }
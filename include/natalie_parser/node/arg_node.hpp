@@ -1,5 +1,6 @@
 #pragma once
 
+#include "natalie_parser/locals_hashmap.hpp"
 #include "natalie_parser/node/node.hpp"
 #include "natalie_parser/node/node_with_args.hpp"
 #include "tm/hashmap.hpp"
@@ -49,12 +50,12 @@ public:
     bool block_arg() const { return m_block_arg; }
     void set_block_arg(bool block_arg) { m_block_arg = block_arg; }
 
-    const SharedPtr<Node> value() const { return m_value; }
+    const NodePtr<Node> value() const { return m_value; }
 
-    void set_value(SharedPtr<Node> value) { m_value = value; }
+    void set_value(NodePtr<Node> value) { m_value = value; }
 
-    void add_to_locals(TM::Hashmap<TM::String> &locals) {
-        locals.set(m_name->c_str());
+    void add_to_locals(LocalsHashmap &locals) {
+        locals.set(*m_name);
     }
 
     virtual void transform(Creator *creator) const override {
@@ -69,6 +70,6 @@ protected:
     bool m_block_arg { false };
     bool m_splat { false };
     bool m_kwsplat { false };
-    SharedPtr<Node> m_value {};
+    NodePtr<Node> m_value {};
 };
 }
@@ -17,7 +17,7 @@ public:
     ArrayPatternNode(const Token &token)
         : ArrayNode { token } { }
 
-    ArrayPatternNode(const Token &token, SharedPtr<Node> node)
+    ArrayPatternNode(const Token &token, NodePtr<Node> node)
         : ArrayNode { token } {
         m_nodes.push(node);
     }
@@ -12,7 +12,7 @@ using namespace TM;
 
 class AssignmentNode : public Node {
 public:
-    AssignmentNode(const Token &token, SharedPtr<Node> identifier, SharedPtr<Node> value)
+    AssignmentNode(const Token &token, NodePtr<Node> identifier, NodePtr<Node> value)
         : Node { token }
         , m_identifier { identifier }
         , m_value { value } {
@@ -22,13 +22,13 @@ public:
 
     virtual Type type() const override { return Type::Assignment; }
 
-    const SharedPtr<Node> identifier() const { return m_identifier; }
-    const SharedPtr<Node> value() const { return m_value; }
+    const NodePtr<Node> identifier() const { return m_identifier; }
+    const NodePtr<Node> value() const { return m_value; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<Node> m_identifier {};
-    SharedPtr<Node> m_value {};
+    NodePtr<Node> m_identifier {};
+    NodePtr<Node> m_value {};
 };
 }
@@ -14,7 +14,7 @@ using namespace TM;
 
 class BeginNode : public Node {
 public:
-    BeginNode(const Token &token, SharedPtr<BlockNode> body)
+    BeginNode(const Token &token, NodePtr<BlockNode> body)
         : Node { token }
         , m_body { body } {
         assert(m_body);
@@ -26,27 +26,27 @@ public:
         return !has_rescue_nodes() && !has_else_body() && !has_ensure_body();
     }
 
-    void add_rescue_node(SharedPtr<BeginRescueNode> node) { m_rescue_nodes.push(node); }
+    void add_rescue_node(NodePtr<BeginRescueNode> node) { m_rescue_nodes.push(node); }
     bool has_rescue_nodes() const { return !m_rescue_nodes.is_empty(); }
 
     bool has_else_body() const { return m_else_body ? true : false; }
     bool has_ensure_body() const { return m_ensure_body ? true : false; }
 
-    void set_else_body(SharedPtr<BlockNode> else_body) { m_else_body = else_body; }
-    void set_ensure_body(SharedPtr<BlockNode> ensure_body) { m_ensure_body = ensure_body; }
+    void set_else_body(NodePtr<BlockNode> else_body) { m_else_body = else_body; }
+    void set_ensure_body(NodePtr<BlockNode> ensure_body) { m_ensure_body = ensure_body; }
 
-    const SharedPtr<BlockNode> body() const { return m_body; }
-    const SharedPtr<BlockNode> else_body() const { return m_else_body; }
-    const SharedPtr<BlockNode> ensure_body() const { return m_ensure_body; }
+    const NodePtr<BlockNode> body() const { return m_body; }
+    const NodePtr<BlockNode> else_body() const { return m_else_body; }
+    const NodePtr<BlockNode> ensure_body() const { return m_ensure_body; }
 
-    const Vector<SharedPtr<BeginRescueNode>> &rescue_nodes() const { return m_rescue_nodes; }
+    const ArenaVector<NodePtr<BeginRescueNode>> &rescue_nodes() const { return m_rescue_nodes; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<BlockNode> m_body {};
-    SharedPtr<BlockNode> m_else_body {};
-    SharedPtr<BlockNode> m_ensure_body {};
-    Vector<SharedPtr<BeginRescueNode>> m_rescue_nodes {};
+    NodePtr<BlockNode> m_body {};
+    NodePtr<BlockNode> m_else_body {};
+    NodePtr<BlockNode> m_ensure_body {};
+    ArenaVector<NodePtr<BeginRescueNode>> m_rescue_nodes {};
 };
 }
@@ -18,29 +18,30 @@ public:
 
     virtual Type type() const override { return Type::BeginRescue; }
 
-    void add_exception_node(SharedPtr<Node> node) {
+    void add_exception_node(NodePtr<Node> node) {
         m_exceptions.push(node);
     }
 
-    void set_exception_name(SharedPtr<Node> name) {
-        m_name = name;
-    }
+    void set_exception_name(NodePtr<Node> name);
 
-    void set_body(SharedPtr<BlockNode> body) { m_body = body; }
+    void set_body(NodePtr<BlockNode> body) { m_body = body; }
 
-    SharedPtr<Node> name_to_assignment() const;
+    // name = $!, built along with the name, since transform() can't
+    // allocate nodes
+    NodePtr<Node> name_to_assignment() const { return m_name_assignment; }
 
     bool has_name() const { return m_name; }
 
-    const SharedPtr<Node> name() const { return m_name; }
-    const Vector<SharedPtr<Node>> &exceptions() const { return m_exceptions; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> name() const { return m_name; }
+    const ArenaVector<NodePtr<Node>> &exceptions() const { return m_exceptions; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<Node> m_name {};
-    Vector<SharedPtr<Node>> m_exceptions {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_name {};
+    NodePtr<Node> m_name_assignment {};
+    ArenaVector<NodePtr<Node>> m_exceptions {};
+    NodePtr<BlockNode> m_body {};
 };
 }
@@ -14,27 +14,27 @@ public:
     BlockNode(const Token &token)
         : Node { token } { }
 
-    BlockNode(const Token &token, SharedPtr<Node> single_node)
+    BlockNode(const Token &token, NodePtr<Node> single_node)
         : Node { token } {
         add_node(single_node);
     }
 
     virtual Type type() const override { return Type::Block; }
 
-    const Vector<SharedPtr<Node>> &nodes() const { return m_nodes; }
+    const ArenaVector<NodePtr<Node>> &nodes() const { return m_nodes; }
 
-    void add_node(SharedPtr<Node> node) {
+    void add_node(NodePtr<Node> node) {
         m_nodes.push(node);
     }
 
-    SharedPtr<Node> take_first_node() {
+    NodePtr<Node> take_first_node() {
         return m_nodes.pop_front();
     }
 
     bool is_empty() const { return m_nodes.is_empty(); }
 
     bool has_one_node() const { return m_nodes.size() == 1; }
-    SharedPtr<Node> first() const { return m_nodes.at(0); }
+    NodePtr<Node> first() const { return m_nodes.at(0); }
 
     const Node &without_unnecessary_nesting() const {
         if (has_one_node())
@@ -50,6 +50,6 @@ public:
     }
 
 protected:
-    Vector<SharedPtr<Node>> m_nodes {};
+    ArenaVector<NodePtr<Node>> m_nodes {};
 };
 }
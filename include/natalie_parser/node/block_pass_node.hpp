@@ -12,7 +12,7 @@ using namespace TM;
 
 class BlockPassNode : public Node {
 public:
-    BlockPassNode(const Token &token, SharedPtr<Node> node)
+    BlockPassNode(const Token &token, NodePtr<Node> node)
         : Node { token }
         , m_node { node } {
         assert(m_node);
@@ -20,7 +20,7 @@ public:
 
     virtual Type type() const override { return Type::BlockPass; }
 
-    const SharedPtr<Node> node() const { return m_node; }
+    const NodePtr<Node> node() const { return m_node; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("block_pass");
@@ -28,6 +28,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_node {};
+    NodePtr<Node> m_node {};
 };
 }
@@ -12,13 +12,13 @@ using namespace TM;
 
 class BreakNode : public NodeWithArgs {
 public:
-    BreakNode(const Token &token, SharedPtr<Node> arg = {})
+    BreakNode(const Token &token, NodePtr<Node> arg = {})
         : NodeWithArgs { token }
         , m_arg { arg } { }
 
     virtual Type type() const override { return Type::Break; }
 
-    const SharedPtr<Node> arg() const { return m_arg; }
+    const NodePtr<Node> arg() const { return m_arg; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("break");
@@ -27,6 +27,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_arg {};
+    NodePtr<Node> m_arg {};
 };
 }
@@ -2,6 +2,7 @@
 
 #include "natalie_parser/node/node.hpp"
 #include "natalie_parser/node/node_with_args.hpp"
+#include "natalie_parser/symbol_table.hpp"
 #include "tm/hashmap.hpp"
 #include "tm/owned_ptr.hpp"
 #include "tm/string.hpp"
@@ -12,7 +13,7 @@ using namespace TM;
 
 class CallNode : public NodeWithArgs {
 public:
-    CallNode(const Token &token, SharedPtr<Node> receiver, SharedPtr<String> message)
+    CallNode(const Token &token, NodePtr<Node> receiver, SharedPtr<String> message)
         : NodeWithArgs { token }
         , m_receiver { receiver }
         , m_message { message } {
@@ -38,13 +39,24 @@ public:
     virtual bool is_callable() const override { return true; }
 
     virtual bool can_accept_a_block() const override {
+        // if the message came straight from the lexer, we can check its interned id
+        if (m_token.symbol_id() && m_token.literal_string().ptr() == m_message.ptr()) {
+            switch (m_token.symbol_id()) {
+            case SymbolTable::Private:
+            case SymbolTable::Protected:
+            case SymbolTable::Public:
+                return false;
+            default:
+                return true;
+            }
+        }
         if (*m_message == "private" || *m_message == "protected" || *m_message == "public")
             return false;
         return true;
     }
 
-    const SharedPtr<Node> receiver() const { return m_receiver; }
-    void set_receiver(SharedPtr<Node> receiver) { m_receiver = receiver; }
+    const NodePtr<Node> receiver() const { return m_receiver; }
+    void set_receiver(NodePtr<Node> receiver) { m_receiver = receiver; }
 
     SharedPtr<String> message() const { return m_message; }
 
@@ -79,7 +91,7 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_receiver {};
+    NodePtr<Node> m_receiver {};
     SharedPtr<String> m_message {};
 };
 }
@@ -13,7 +13,7 @@ using namespace TM;
 
 class CaseInNode : public Node {
 public:
-    CaseInNode(const Token &token, SharedPtr<Node> pattern, SharedPtr<BlockNode> body)
+    CaseInNode(const Token &token, NodePtr<Node> pattern, NodePtr<BlockNode> body)
         : Node { token }
         , m_pattern { pattern }
         , m_body { body } {
@@ -23,8 +23,8 @@ public:
 
     virtual Type type() const override { return Type::CaseIn; }
 
-    const SharedPtr<Node> pattern() const { return m_pattern; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> pattern() const { return m_pattern; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("in");
@@ -37,7 +37,7 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_pattern {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_pattern {};
+    NodePtr<BlockNode> m_body {};
 };
 }
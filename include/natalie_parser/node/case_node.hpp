@@ -13,7 +13,7 @@ using namespace TM;
 
 class CaseNode : public Node {
 public:
-    CaseNode(const Token &token, SharedPtr<Node> subject)
+    CaseNode(const Token &token, NodePtr<Node> subject)
         : Node { token }
         , m_subject { subject } {
         assert(m_subject);
@@ -21,17 +21,17 @@ public:
 
     virtual Type type() const override { return Type::Case; }
 
-    void add_node(SharedPtr<Node> node) {
+    void add_node(NodePtr<Node> node) {
         m_nodes.push(node);
     }
 
-    void set_else_node(SharedPtr<BlockNode> node) {
+    void set_else_node(NodePtr<BlockNode> node) {
         m_else_node = node;
     }
 
-    const SharedPtr<Node> subject() const { return m_subject; }
-    Vector<SharedPtr<Node>> &nodes() { return m_nodes; }
-    const SharedPtr<BlockNode> else_node() const { return m_else_node; }
+    const NodePtr<Node> subject() const { return m_subject; }
+    ArenaVector<NodePtr<Node>> &nodes() { return m_nodes; }
+    const NodePtr<BlockNode> else_node() const { return m_else_node; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("case");
@@ -45,8 +45,8 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_subject {};
-    Vector<SharedPtr<Node>> m_nodes {};
-    SharedPtr<BlockNode> m_else_node {};
+    NodePtr<Node> m_subject {};
+    ArenaVector<NodePtr<Node>> m_nodes {};
+    NodePtr<BlockNode> m_else_node {};
 };
 }
@@ -13,7 +13,7 @@ using namespace TM;
 
 class CaseWhenNode : public Node {
 public:
-    CaseWhenNode(const Token &token, SharedPtr<Node> condition, SharedPtr<BlockNode> body)
+    CaseWhenNode(const Token &token, NodePtr<Node> condition, NodePtr<BlockNode> body)
         : Node { token }
         , m_condition { condition }
         , m_body { body } {
@@ -23,8 +23,8 @@ public:
 
     virtual Type type() const override { return Type::CaseWhen; }
 
-    const SharedPtr<Node> condition() const { return m_condition; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> condition() const { return m_condition; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("when");
@@ -37,7 +37,7 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_condition {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_condition {};
+    NodePtr<BlockNode> m_body {};
 };
 }
@@ -13,7 +13,7 @@ using namespace TM;
 
 class ClassNode : public Node {
 public:
-    ClassNode(const Token &token, SharedPtr<Node> name, SharedPtr<Node> superclass, SharedPtr<BlockNode> body)
+    ClassNode(const Token &token, NodePtr<Node> name, NodePtr<Node> superclass, NodePtr<BlockNode> body)
         : Node { token }
         , m_name { name }
         , m_superclass { superclass }
@@ -25,15 +25,15 @@ public:
 
     virtual Type type() const override { return Type::Class; }
 
-    const SharedPtr<Node> name() const { return m_name; }
-    const SharedPtr<Node> superclass() const { return m_superclass; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> name() const { return m_name; }
+    const NodePtr<Node> superclass() const { return m_superclass; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<Node> m_name {};
-    SharedPtr<Node> m_superclass {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_name {};
+    NodePtr<Node> m_superclass {};
+    NodePtr<BlockNode> m_body {};
 };
 }
@@ -12,7 +12,7 @@ using namespace TM;
 
 class Colon2Node : public Node {
 public:
-    Colon2Node(const Token &token, SharedPtr<Node> left, SharedPtr<String> name)
+    Colon2Node(const Token &token, NodePtr<Node> left, SharedPtr<String> name)
         : Node { token }
         , m_left { left }
         , m_name { name } {
@@ -25,7 +25,7 @@ public:
     virtual bool is_assignable() const override { return true; }
     virtual bool is_callable() const override { return true; }
 
-    const SharedPtr<Node> left() const { return m_left; }
+    const NodePtr<Node> left() const { return m_left; }
     SharedPtr<String> name() const { return m_name; }
 
     virtual void transform(Creator *creator) const override {
@@ -39,7 +39,7 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_left {};
+    NodePtr<Node> m_left {};
     SharedPtr<String> m_name {};
 };
 }
@@ -12,7 +12,7 @@ using namespace TM;
 
 class ComplexNode : public Node {
 public:
-    ComplexNode(const Token &token, SharedPtr<Node> value)
+    ComplexNode(const Token &token, NodePtr<Node> value)
         : Node { token }
         , m_value { value } { }
 
@@ -44,6 +44,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_value;
+    NodePtr<Node> m_value;
 };
 }
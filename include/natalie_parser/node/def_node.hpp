@@ -13,7 +13,7 @@ using namespace TM;
 
 class DefNode : public NodeWithArgs {
 public:
-    DefNode(const Token &token, SharedPtr<Node> self_node, SharedPtr<String> name, const Vector<SharedPtr<Node>> &args, SharedPtr<BlockNode> body)
+    DefNode(const Token &token, NodePtr<Node> self_node, SharedPtr<String> name, const ArenaVector<NodePtr<Node>> &args, NodePtr<BlockNode> body)
         : NodeWithArgs { token, args }
         , m_self_node { self_node }
         , m_name { name }
@@ -23,9 +23,9 @@ public:
 
     virtual Type type() const override { return Type::Def; }
 
-    const SharedPtr<Node> self_node() const { return m_self_node; }
+    const NodePtr<Node> self_node() const { return m_self_node; }
     SharedPtr<String> name() const { return m_name; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override {
         if (m_self_node) {
@@ -48,8 +48,8 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_self_node {};
+    NodePtr<Node> m_self_node {};
     SharedPtr<String> m_name {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<BlockNode> m_body {};
 };
 }
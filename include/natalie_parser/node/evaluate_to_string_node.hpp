@@ -15,7 +15,7 @@ public:
     EvaluateToStringNode(const Token &token)
         : Node { token } { }
 
-    EvaluateToStringNode(const Token &token, SharedPtr<Node> node)
+    EvaluateToStringNode(const Token &token, NodePtr<Node> node)
         : Node { token }
         , m_node { node } {
         assert(m_node);
@@ -23,7 +23,7 @@ public:
 
     virtual Type type() const override { return Type::EvaluateToString; }
 
-    const SharedPtr<Node> node() const { return m_node; }
+    const NodePtr<Node> node() const { return m_node; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("evstr");
@@ -32,6 +32,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_node {};
+    NodePtr<Node> m_node {};
 };
 }
@@ -10,7 +10,7 @@ using namespace TM;
 
 class ForNode : public Node {
 public:
-    ForNode(const Token &token, SharedPtr<Node> expr, SharedPtr<Node> vars, SharedPtr<BlockNode> body)
+    ForNode(const Token &token, NodePtr<Node> expr, NodePtr<Node> vars, NodePtr<BlockNode> body)
         : Node { token }
         , m_expr { expr }
         , m_vars { vars }
@@ -21,15 +21,15 @@ public:
 
     virtual Type type() const override { return Type::For; }
 
-    const SharedPtr<Node> expr() const { return m_expr; }
-    const SharedPtr<Node> vars() const { return m_vars; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> expr() const { return m_expr; }
+    const NodePtr<Node> vars() const { return m_vars; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<Node> m_expr {};
-    SharedPtr<Node> m_vars {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_expr {};
+    NodePtr<Node> m_vars {};
+    NodePtr<BlockNode> m_body {};
 };
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "natalie_parser/locals_hashmap.hpp"
 #include "natalie_parser/node/node.hpp"
 #include "tm/hashmap.hpp"
 
@@ -14,7 +15,7 @@ public:
 
     virtual Type type() const override { return Type::ForwardArgs; }
 
-    void add_to_locals(TM::Hashmap<TM::String> &locals) {
+    void add_to_locals(LocalsHashmap &locals) {
         locals.set("...");
     }
 
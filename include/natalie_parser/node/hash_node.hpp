@@ -17,11 +17,11 @@ public:
 
     virtual Type type() const override { return Type::Hash; }
 
-    void add_node(SharedPtr<Node> node) {
+    void add_node(NodePtr<Node> node) {
         m_nodes.push(node);
     }
 
-    const Vector<SharedPtr<Node>> &nodes() const { return m_nodes; }
+    const ArenaVector<NodePtr<Node>> &nodes() const { return m_nodes; }
 
     virtual void transform(Creator *creator) const override {
         if (m_bare)
@@ -33,7 +33,7 @@ public:
     }
 
 protected:
-    Vector<SharedPtr<Node>> m_nodes {};
+    ArenaVector<NodePtr<Node>> m_nodes {};
     bool m_bare { false };
 };
 }
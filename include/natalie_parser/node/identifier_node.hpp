@@ -1,5 +1,6 @@
 #pragma once
 
+#include "natalie_parser/locals_hashmap.hpp"
 #include "natalie_parser/node/node.hpp"
 #include "natalie_parser/node/node_with_args.hpp"
 #include "tm/hashmap.hpp"
@@ -25,16 +26,16 @@ public:
     SharedPtr<String> name() const { return m_token.literal_string(); }
 
     void prepend_to_name(char c) {
-        auto literal = m_token.literal_string();
+        // the name may be shared through the symbol table
+        SharedPtr<String> literal = new String { *m_token.literal_string() };
         literal->prepend_char(c);
-        // FIXME: set_literal() unneeded?
         m_token.set_literal(literal);
     }
 
     void append_to_name(char c) {
-        auto literal = m_token.literal_string();
+        // the name may be shared through the symbol table
+        SharedPtr<String> literal = new String { *m_token.literal_string() };
         literal->append_char(c);
-        // FIXME: set_literal() unneeded?
         m_token.set_literal(literal);
     }
 
@@ -51,9 +52,9 @@ public:
     bool is_lvar() const { return m_is_lvar; }
     void set_is_lvar(bool is_lvar) { m_is_lvar = is_lvar; }
 
-    void add_to_locals(TM::Hashmap<TM::String> &locals) const {
+    void add_to_locals(LocalsHashmap &locals) const {
         if (token_type() == Token::Type::BareName)
-            locals.set(name()->c_str());
+            locals.set(*name());
     }
 
     virtual void transform(Creator *creator) const override {
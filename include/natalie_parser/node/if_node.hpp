@@ -12,7 +12,7 @@ using namespace TM;
 
 class IfNode : public Node {
 public:
-    IfNode(const Token &token, SharedPtr<Node> condition, SharedPtr<Node> true_expr, SharedPtr<Node> false_expr)
+    IfNode(const Token &token, NodePtr<Node> condition, NodePtr<Node> true_expr, NodePtr<Node> false_expr)
         : Node { token }
         , m_condition { condition }
         , m_true_expr { true_expr }
@@ -24,9 +24,9 @@ public:
 
     virtual Type type() const override { return Type::If; }
 
-    const SharedPtr<Node> condition() const { return m_condition; }
-    const SharedPtr<Node> true_expr() const { return m_true_expr; }
-    const SharedPtr<Node> false_expr() const { return m_false_expr; }
+    const NodePtr<Node> condition() const { return m_condition; }
+    const NodePtr<Node> true_expr() const { return m_true_expr; }
+    const NodePtr<Node> false_expr() const { return m_false_expr; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("if");
@@ -36,8 +36,8 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_condition {};
-    SharedPtr<Node> m_true_expr {};
-    SharedPtr<Node> m_false_expr {};
+    NodePtr<Node> m_condition {};
+    NodePtr<Node> m_true_expr {};
+    NodePtr<Node> m_false_expr {};
 };
 }
@@ -10,7 +10,7 @@ using namespace TM;
 
 class InfixOpNode : public Node {
 public:
-    InfixOpNode(const Token &token, SharedPtr<Node> left, SharedPtr<String> op, SharedPtr<Node> right)
+    InfixOpNode(const Token &token, NodePtr<Node> left, SharedPtr<String> op, NodePtr<Node> right)
         : Node { token }
         , m_left { left }
         , m_op { op }
@@ -25,11 +25,11 @@ public:
     virtual bool is_callable() const override { return false; }
     virtual bool can_accept_a_block() const override { return false; }
 
-    const SharedPtr<Node> left() const { return m_left; }
+    const NodePtr<Node> left() const { return m_left; }
     const SharedPtr<String> op() const { return m_op; }
-    const SharedPtr<Node> right() const { return m_right; }
+    const NodePtr<Node> right() const { return m_right; }
 
-    void set_right(SharedPtr<Node> right) { m_right = right; }
+    void set_right(NodePtr<Node> right) { m_right = right; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("call");
@@ -39,8 +39,8 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_left {};
+    NodePtr<Node> m_left {};
     SharedPtr<String> m_op {};
-    SharedPtr<Node> m_right {};
+    NodePtr<Node> m_right {};
 };
 }
@@ -22,12 +22,12 @@ public:
 
     bool is_empty() const { return m_nodes.is_empty(); }
 
-    void prepend_node(SharedPtr<Node> node) { m_nodes.push_front(node); };
-    void add_node(SharedPtr<Node> node) { m_nodes.push(node); };
+    void prepend_node(NodePtr<Node> node) { m_nodes.push_front(node); };
+    void add_node(NodePtr<Node> node) { m_nodes.push(node); };
 
-    const Vector<SharedPtr<Node>> &nodes() const { return m_nodes; }
+    const ArenaVector<NodePtr<Node>> &nodes() const { return m_nodes; }
 
 protected:
-    Vector<SharedPtr<Node>> m_nodes {};
+    ArenaVector<NodePtr<Node>> m_nodes {};
 };
 }
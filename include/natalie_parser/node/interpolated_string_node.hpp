@@ -20,11 +20,11 @@ public:
 
     virtual bool can_be_concatenated_to_a_string() const override { return true; }
 
-    SharedPtr<InterpolatedSymbolNode> to_symbol_node() const {
+    NodePtr<InterpolatedSymbolNode> to_symbol_node() const {
         return new InterpolatedSymbolNode { *this };
     }
 
-    SharedPtr<Node> append_string_node(SharedPtr<Node> string2) const;
+    NodePtr<Node> append_string_node(NodePtr<Node> string2) const;
 
     virtual void transform(Creator *creator) const override;
 };
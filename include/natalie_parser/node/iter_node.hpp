@@ -12,7 +12,7 @@ using namespace TM;
 
 class IterNode : public NodeWithArgs {
 public:
-    IterNode(const Token &token, SharedPtr<Node> call, bool has_args, const Vector<SharedPtr<Node>> &args, SharedPtr<BlockNode> body)
+    IterNode(const Token &token, NodePtr<Node> call, bool has_args, const ArenaVector<NodePtr<Node>> &args, NodePtr<BlockNode> body)
         : NodeWithArgs { token, args }
         , m_has_args { has_args }
         , m_call { call }
@@ -23,8 +23,8 @@ public:
 
     virtual Type type() const override { return Type::Iter; }
 
-    const SharedPtr<Node> call() const { return m_call; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> call() const { return m_call; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("iter");
@@ -39,7 +39,7 @@ public:
 
 protected:
     bool m_has_args { false };
-    SharedPtr<Node> m_call {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_call {};
+    NodePtr<BlockNode> m_body {};
 };
 }
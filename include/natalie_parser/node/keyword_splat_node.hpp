@@ -15,7 +15,7 @@ public:
     KeywordSplatNode(const Token &token)
         : Node { token } { }
 
-    KeywordSplatNode(const Token &token, SharedPtr<Node> node)
+    KeywordSplatNode(const Token &token, NodePtr<Node> node)
         : Node { token }
         , m_node { node } {
         assert(m_node);
@@ -23,7 +23,7 @@ public:
 
     virtual Type type() const override { return Type::KeywordSplat; }
 
-    const SharedPtr<Node> node() const { return m_node; }
+    const NodePtr<Node> node() const { return m_node; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("kwsplat");
@@ -32,7 +32,7 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_node {};
+    NodePtr<Node> m_node {};
 };
 
 }
@@ -12,7 +12,7 @@ using namespace TM;
 
 class LogicalAndNode : public Node {
 public:
-    LogicalAndNode(const Token &token, SharedPtr<Node> left, SharedPtr<Node> right)
+    LogicalAndNode(const Token &token, NodePtr<Node> left, NodePtr<Node> right)
         : Node { token }
         , m_left { left }
         , m_right { right } {
@@ -22,10 +22,10 @@ public:
 
     virtual Type type() const override { return Type::LogicalAnd; }
 
-    const SharedPtr<Node> left() const { return m_left; }
-    const SharedPtr<Node> right() const { return m_right; }
+    const NodePtr<Node> left() const { return m_left; }
+    const NodePtr<Node> right() const { return m_right; }
 
-    void set_right(SharedPtr<Node> right) { m_right = right; }
+    void set_right(NodePtr<Node> right) { m_right = right; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("and");
@@ -34,7 +34,7 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_left {};
-    SharedPtr<Node> m_right {};
+    NodePtr<Node> m_left {};
+    NodePtr<Node> m_right {};
 };
 }
@@ -13,13 +13,13 @@ using namespace TM;
 
 class MatchNode : public Node {
 public:
-    MatchNode(const Token &token, SharedPtr<RegexpNode> regexp)
+    MatchNode(const Token &token, NodePtr<RegexpNode> regexp)
         : Node { token }
         , m_regexp { regexp } {
         assert(m_regexp);
     }
 
-    MatchNode(const Token &token, SharedPtr<RegexpNode> regexp, SharedPtr<Node> arg, bool regexp_on_left)
+    MatchNode(const Token &token, NodePtr<RegexpNode> regexp, NodePtr<Node> arg, bool regexp_on_left)
         : Node { token }
         , m_regexp { regexp }
         , m_arg { arg }
@@ -30,15 +30,15 @@ public:
 
     virtual Type type() const override { return Type::Match; }
 
-    const SharedPtr<RegexpNode> regexp() const { return m_regexp; }
-    const SharedPtr<Node> arg() const { return m_arg; }
+    const NodePtr<RegexpNode> regexp() const { return m_regexp; }
+    const NodePtr<Node> arg() const { return m_arg; }
     bool regexp_on_left() const { return m_regexp_on_left; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<RegexpNode> m_regexp {};
-    SharedPtr<Node> m_arg {};
+    NodePtr<RegexpNode> m_regexp {};
+    NodePtr<Node> m_arg {};
     bool m_regexp_on_left { false };
 };
 }
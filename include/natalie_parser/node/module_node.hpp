@@ -13,20 +13,20 @@ using namespace TM;
 
 class ModuleNode : public Node {
 public:
-    ModuleNode(const Token &token, SharedPtr<Node> name, SharedPtr<BlockNode> body)
+    ModuleNode(const Token &token, NodePtr<Node> name, NodePtr<BlockNode> body)
         : Node { token }
         , m_name { name }
         , m_body { body } { }
 
     virtual Type type() const override { return Type::Module; }
 
-    const SharedPtr<Node> name() const { return m_name; }
-    const SharedPtr<BlockNode> body() const { return m_body; }
+    const NodePtr<Node> name() const { return m_name; }
+    const NodePtr<BlockNode> body() const { return m_body; }
 
     virtual void transform(Creator *creator) const override;
 
 protected:
-    SharedPtr<Node> m_name {};
-    SharedPtr<BlockNode> m_body {};
+    NodePtr<Node> m_name {};
+    NodePtr<BlockNode> m_body {};
 };
 }
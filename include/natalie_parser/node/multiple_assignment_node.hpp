@@ -1,5 +1,6 @@
 #pragma once
 
+#include "natalie_parser/locals_hashmap.hpp"
 #include "natalie_parser/node/array_node.hpp"
 #include "natalie_parser/node/node.hpp"
 #include "natalie_parser/node/node_with_args.hpp"
@@ -19,7 +20,7 @@ public:
 
     virtual bool is_assignable() const override { return true; }
 
-    void add_locals(TM::Hashmap<TM::String> &);
+    void add_locals(LocalsHashmap &);
 
     virtual void transform(Creator *creator) const override {
         creator->with_assignment(true, [&]() {
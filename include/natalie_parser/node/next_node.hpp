@@ -12,7 +12,7 @@ using namespace TM;
 
 class NextNode : public Node {
 public:
-    NextNode(const Token &token, SharedPtr<Node> arg = {})
+    NextNode(const Token &token, NodePtr<Node> arg = {})
         : Node { token }
         , m_arg { arg } {
     }
@@ -32,6 +32,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_arg {};
+    NodePtr<Node> m_arg {};
 };
 }
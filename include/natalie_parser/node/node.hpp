@@ -1,6 +1,8 @@
 #pragma once
 
+#include "natalie_parser/arena.hpp"
 #include "natalie_parser/creator.hpp"
+#include "natalie_parser/node_ptr.hpp"
 #include "natalie_parser/token.hpp"
 
 namespace NatalieParser {
@@ -114,6 +116,11 @@ public:
 
     virtual ~Node() { }
 
+    // Nodes are only created during a parse, in the parser's Arena, which
+    // destroys them all when it goes away (see Tree).
+    static void *operator new(size_t size) { return Arena::allocate(size, finalize); }
+    static void operator delete(void *ptr) { Arena::abandon(ptr); }
+
     virtual Type type() const { return Type::Invalid; }
 
     virtual bool is_callable() const { return false; }
@@ -144,9 +151,8 @@ public:
     const Token &token() const { return m_token; }
 
     const static Node &invalid() {
-        if (!s_invalid)
-            s_invalid = new Node;
-        return *s_invalid;
+        static Node invalid_node;
+        return invalid_node;
     }
 
     operator bool() const {
@@ -156,8 +162,10 @@ public:
     void debug();
 
 protected:
-    static inline SharedPtr<Node> s_invalid {};
     Token m_token {};
+
+private:
+    static void finalize(void *node) { static_cast<Node *>(node)->~Node(); }
 };
 
 }
@@ -15,7 +15,7 @@ public:
     NodeWithArgs(const Token &token)
         : Node { token } { }
 
-    NodeWithArgs(const Token &token, const Vector<SharedPtr<Node>> &args)
+    NodeWithArgs(const Token &token, const ArenaVector<NodePtr<Node>> &args)
         : Node { token } {
         for (auto arg : args)
             add_arg(arg);
@@ -27,7 +27,7 @@ public:
             add_arg(arg);
     }
 
-    void add_arg(SharedPtr<Node> arg) {
+    void add_arg(NodePtr<Node> arg) {
         // TODO: error if BlockPass already added (must be last)
         m_args.push(arg);
     }
@@ -36,12 +36,12 @@ public:
         return m_args.size() > 0 && m_args.last()->type() == Node::Type::BlockPass;
     }
 
-    Vector<SharedPtr<Node>> &args() { return m_args; }
-    const Vector<SharedPtr<Node>> &args() const { return m_args; }
+    ArenaVector<NodePtr<Node>> &args() { return m_args; }
+    const ArenaVector<NodePtr<Node>> &args() const { return m_args; }
 
     void append_method_or_block_args(Creator *creator) const;
 
 protected:
-    Vector<SharedPtr<Node>> m_args {};
+    ArenaVector<NodePtr<Node>> m_args {};
 };
 }
@@ -12,7 +12,7 @@ using namespace TM;
 
 class NotNode : public Node {
 public:
-    NotNode(const Token &token, SharedPtr<Node> expression)
+    NotNode(const Token &token, NodePtr<Node> expression)
         : Node { token }
         , m_expression { expression } {
         assert(m_expression);
@@ -20,9 +20,9 @@ public:
 
     virtual Type type() const override { return Type::Not; }
 
-    const SharedPtr<Node> expression() const { return m_expression; }
+    const NodePtr<Node> expression() const { return m_expression; }
 
-    void set_expression(SharedPtr<Node> expression) { m_expression = expression; }
+    void set_expression(NodePtr<Node> expression) { m_expression = expression; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("call");
@@ -32,6 +32,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_expression {};
+    NodePtr<Node> m_expression {};
 };
 }
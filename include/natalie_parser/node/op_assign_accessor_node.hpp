@@ -12,7 +12,7 @@ using namespace TM;
 
 class OpAssignAccessorNode : public NodeWithArgs {
 public:
-    OpAssignAccessorNode(const Token &token, SharedPtr<String> op, SharedPtr<Node> receiver, SharedPtr<String> message, SharedPtr<Node> value, Vector<SharedPtr<Node>> &args)
+    OpAssignAccessorNode(const Token &token, SharedPtr<String> op, NodePtr<Node> receiver, SharedPtr<String> message, NodePtr<Node> value, ArenaVector<NodePtr<Node>> &args)
         : NodeWithArgs { token }
         , m_op { op }
         , m_receiver { receiver }
@@ -29,9 +29,9 @@ public:
     virtual Type type() const override { return Type::OpAssignAccessor; }
 
     const SharedPtr<String> op() const { return m_op; }
-    const SharedPtr<Node> receiver() const { return m_receiver; }
+    const NodePtr<Node> receiver() const { return m_receiver; }
     const SharedPtr<String> message() const { return m_message; }
-    const SharedPtr<Node> value() const { return m_value; }
+    const NodePtr<Node> value() const { return m_value; }
 
     bool safe() const { return m_safe; }
     void set_safe(bool safe) { m_safe = safe; }
@@ -66,9 +66,9 @@ public:
 
 protected:
     SharedPtr<String> m_op {};
-    SharedPtr<Node> m_receiver {};
+    NodePtr<Node> m_receiver {};
     SharedPtr<String> m_message {};
-    SharedPtr<Node> m_value {};
+    NodePtr<Node> m_value {};
     bool m_safe { false };
 };
 }
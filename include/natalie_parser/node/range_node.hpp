@@ -13,7 +13,7 @@ using namespace TM;
 
 class RangeNode : public Node {
 public:
-    RangeNode(const Token &token, SharedPtr<Node> first, SharedPtr<Node> last, bool exclude_end)
+    RangeNode(const Token &token, NodePtr<Node> first, NodePtr<Node> last, bool exclude_end)
         : Node { token }
         , m_first { first }
         , m_last { last }
@@ -24,8 +24,8 @@ public:
 
     virtual Type type() const override { return Type::Range; }
 
-    const SharedPtr<Node> first() const { return m_first; }
-    const SharedPtr<Node> last() const { return m_last; }
+    const NodePtr<Node> first() const { return m_first; }
+    const NodePtr<Node> last() const { return m_last; }
     bool exclude_end() const { return m_exclude_end; }
 
     virtual void transform(Creator *creator) const override {
@@ -45,8 +45,8 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_first {};
-    SharedPtr<Node> m_last {};
+    NodePtr<Node> m_first {};
+    NodePtr<Node> m_last {};
     bool m_exclude_end { false };
 };
 }
@@ -11,7 +11,7 @@ using namespace TM;
 
 class RationalNode : public Node {
 public:
-    RationalNode(const Token &token, SharedPtr<Node> value)
+    RationalNode(const Token &token, NodePtr<Node> value)
         : Node { token }
         , m_value { value } { }
 
@@ -40,6 +40,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_value;
+    NodePtr<Node> m_value;
 };
 }
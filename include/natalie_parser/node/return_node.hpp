@@ -12,7 +12,7 @@ using namespace TM;
 
 class ReturnNode : public Node {
 public:
-    ReturnNode(const Token &token, SharedPtr<Node> value)
+    ReturnNode(const Token &token, NodePtr<Node> value)
         : Node { token }
         , m_value { value } {
         assert(m_value);
@@ -20,7 +20,7 @@ public:
 
     virtual Type type() const override { return Type::Return; }
 
-    const SharedPtr<Node> value() const { return m_value; }
+    const NodePtr<Node> value() const { return m_value; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("return");
@@ -29,6 +29,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_value {};
+    NodePtr<Node> m_value {};
 };
 }
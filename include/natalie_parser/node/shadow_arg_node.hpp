@@ -1,5 +1,6 @@
 #pragma once
 
+#include "natalie_parser/locals_hashmap.hpp"
 #include "natalie_parser/node/node.hpp"
 #include "natalie_parser/node/node_with_args.hpp"
 #include "tm/hashmap.hpp"
@@ -23,9 +24,9 @@ public:
         m_names.push(name);
     }
 
-    void add_to_locals(TM::Hashmap<TM::String> &locals) {
+    void add_to_locals(LocalsHashmap &locals) {
         for (auto name : m_names)
-            locals.set(name->c_str());
+            locals.set(*name);
     }
 
     virtual void transform(Creator *creator) const override {
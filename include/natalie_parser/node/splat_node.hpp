@@ -15,7 +15,7 @@ public:
     SplatNode(const Token &token)
         : Node { token } { }
 
-    SplatNode(const Token &token, SharedPtr<Node> node)
+    SplatNode(const Token &token, NodePtr<Node> node)
         : Node { token }
         , m_node { node } {
         assert(m_node);
@@ -25,7 +25,7 @@ public:
 
     virtual bool is_assignable() const override { return true; }
 
-    const SharedPtr<Node> node() const { return m_node; }
+    const NodePtr<Node> node() const { return m_node; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("splat");
@@ -34,6 +34,6 @@ public:
     }
 
 protected:
-    SharedPtr<Node> m_node {};
+    NodePtr<Node> m_node {};
 };
 }
@@ -11,7 +11,7 @@ using namespace TM;
 
 class StabbyProcNode : public NodeWithArgs {
 public:
-    StabbyProcNode(const Token &token, bool has_args, const Vector<SharedPtr<Node>> &args)
+    StabbyProcNode(const Token &token, bool has_args, const ArenaVector<NodePtr<Node>> &args)
         : NodeWithArgs { token, args }
         , m_has_args { has_args } { }
 
@@ -25,11 +25,11 @@ public:
 
     SharedPtr<String> string() const { return m_string; }
 
-    SharedPtr<SymbolNode> to_symbol_node() const {
+    NodePtr<SymbolNode> to_symbol_node() const {
         return new SymbolNode { m_token, m_string };
     }
 
-    SharedPtr<Node> append_string_node(SharedPtr<Node> string2) const;
+    NodePtr<Node> append_string_node(NodePtr<Node> string2) const;
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("str");
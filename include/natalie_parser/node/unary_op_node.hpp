@@ -10,7 +10,7 @@ using namespace TM;
 
 class UnaryOpNode : public Node {
 public:
-    UnaryOpNode(const Token &token, SharedPtr<String> op, SharedPtr<Node> right)
+    UnaryOpNode(const Token &token, SharedPtr<String> op, NodePtr<Node> right)
         : Node { token }
         , m_op { op }
         , m_right { right } {
@@ -24,9 +24,9 @@ public:
     virtual bool can_accept_a_block() const override { return false; }
 
     const SharedPtr<String> op() const { return m_op; }
-    const SharedPtr<Node> right() const { return m_right; }
+    const NodePtr<Node> right() const { return m_right; }
 
-    void set_right(SharedPtr<Node> right) { m_right = right; }
+    void set_right(NodePtr<Node> right) { m_right = right; }
 
     virtual void transform(Creator *creator) const override {
         creator->set_type("call");
@@ -36,6 +36,6 @@ public:
 
 protected:
     SharedPtr<String> m_op {};
-    SharedPtr<Node> m_right {};
+    NodePtr<Node> m_right {};
 };
 }
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <assert.h>
+#include <cstddef>
+
+namespace NatalieParser {
+
+// A pointer to a Node. Nodes are owned by the Arena of the parse that
+// built them (see Tree), so this is a plain pointer that doesn't count
+// anything, with the same interface as SharedPtr.
+template <typename T>
+class NodePtr {
+public:
+    NodePtr() { }
+    NodePtr(std::nullptr_t) { }
+
+    NodePtr(T *ptr)
+        : m_ptr { ptr } { }
+
+    template <typename U>
+    NodePtr(const NodePtr<U> &other)
+        : m_ptr { static_cast<T *>(other.ptr()) } { }
+
+    T *operator->() const {
+        assert(m_ptr);
+        return m_ptr;
+    }
+
+    T &operator*() const {
+        assert(m_ptr);
+        return *m_ptr;
+    }
+
+    T &ref() const {
+        assert(m_ptr);
+        return *m_ptr;
+    }
+
+    T *ptr() const { return m_ptr; }
+
+    operator bool() const { return !!m_ptr; }
+
+    bool operator!() const { return !m_ptr; }
+
+    bool operator==(const NodePtr &other) const { return m_ptr == other.m_ptr; }
+    bool operator!=(const NodePtr &other) const { return m_ptr != other.m_ptr; }
+    bool operator==(std::nullptr_t) const { return !m_ptr; }
+    bool operator!=(std::nullptr_t) const { return !!m_ptr; }
+
+    template <typename U>
+    NodePtr<U> static_cast_as() const {
+        return NodePtr<U> { static_cast<U *>(m_ptr) };
+    }
+
+private:
+    T *m_ptr { nullptr };
+};
+
+}
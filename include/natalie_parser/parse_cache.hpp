@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "natalie_parser/binary_ast.hpp"
+#include "tm/optional.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// Keeps parsed trees on disk, in the binary form BinaryCreator writes, so
+// code that was parsed before (by this or any other process) is mapped in
+// instead of being parsed again.
+//
+// Each entry is a file in the directory named after a 128-bit hash of the
+// code, the file name (which is part of the tree), the flags, and the
+// version, so an edited file or a new parser simply misses. The payload is
+// checksummed, and an entry that fails the checksum or BinaryAst's checks
+// is deleted and treated as a miss. Entries are written to a temporary file
+// and renamed into place, so readers never see half of one.
+//
+// A hit touches the entry's modification time, and every so often a store
+// removes the least recently used entries until the directory is under
+// max_size again.
+//
+// One ParseCache must only be used by one thread at a time, but any number
+// of them (in any number of processes) can share a directory.
+//
+//     ParseCache cache { "tmp/cache" };
+//     auto entry = cache.fetch(code, file);
+//     entry->ast().root() ...
+class ParseCache {
+public:
+    static constexpr size_t DefaultMaxSize = 256 * 1024 * 1024;
+
+    struct Key {
+        uint64_t high;
+        uint64_t low;
+    };
+
+    // A tree, either mapped from the cache or just parsed. The mapping
+    // lasts as long as the Entry, even if the file is removed.
+    class Entry {
+    public:
+        ~Entry();
+
+        Entry(const Entry &) = delete;
+        Entry &operator=(const Entry &) = delete;
+
+        const BinaryAst &ast() const { return m_ast.value(); }
+
+        // true if this came from the cache
+        bool is_mapped() const { return m_mapping != nullptr; }
+
+    private:
+        friend class ParseCache;
+
+        Entry() { }
+
+        void *m_mapping { nullptr };
+        size_t m_mapping_size { 0 };
+        String m_binary {};
+        Optional<BinaryAst> m_ast {};
+    };
+
+    // The directory (and any missing parents) is created on the first
+    // store. Pass the version of whatever builds on the trees as version,
+    // so that upgrading it starts a fresh set of entries.
+    ParseCache(String directory, String version = {}, size_t max_size = DefaultMaxSize);
+
+    // The tree for code, from the cache if it is there, or else parsed,
+    // stored, and returned. Throws Parser::SyntaxError, and doesn't cache
+    // code with errors. cancel_flag is handed to the Parser (see
+    // Parser::set_cancel_flag()).
+    SharedPtr<Entry> fetch(SharedPtr<String> code, SharedPtr<String> file, uint16_t flags = BinaryAst::Locations | BinaryAst::Comments, const std::atomic<bool> *cancel_flag = nullptr);
+
+    Key key(const String &code, const String &file, uint16_t flags) const;
+
+    // the entry for key, or nullptr if there isn't a good one
+    SharedPtr<Entry> lookup(Key key);
+
+    // Writes binary (from BinaryCreator::serialize()) under key and hands
+    // it back as an Entry. Failing to write is not an error; the entry is
+    // just not cached.
+    SharedPtr<Entry> store(Key key, String binary);
+
+    // Removes the least recently used entries until the directory holds at
+    // most max_size bytes of them.
+    void evict();
+
+    const String &directory() const { return m_directory; }
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+
+    // entries found damaged (and removed)
+    size_t rejected() const { return m_rejected; }
+
+private:
+    String path(Key key) const;
+    bool make_directory() const;
+
+    String m_directory;
+    String m_version;
+    size_t m_max_size;
+    size_t m_hits { 0 };
+    size_t m_misses { 0 };
+    size_t m_rejected { 0 };
+};
+
+}
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "natalie_parser/arena.hpp"
+#include "natalie_parser/flat_ast.hpp"
 #include "natalie_parser/lexer.hpp"
+#include "natalie_parser/locals_hashmap.hpp"
 #include "natalie_parser/node.hpp"
 #include "natalie_parser/token.hpp"
+#include "natalie_parser/tree.hpp"
 #include "tm/string.hpp"
 
 namespace NatalieParser {
@@ -36,8 +40,10 @@ public:
 
     Parser(SharedPtr<String> code, SharedPtr<String> file)
         : m_code { code }
-        , m_file { file } {
-        m_tokens = Lexer { m_code, m_file }.tokens();
+        , m_file { file }
+        , m_symbols { new SymbolTable }
+        , m_lexer { code, file, m_symbols } {
+        m_arena->keep(m_lexer.source());
         m_call_depth.push(0);
     }
 
@@ -45,7 +51,15 @@ public:
         // SharedPtr ftw
     }
 
-    using LocalsHashmap = TM::Hashmap<TM::String>;
+    using LocalsHashmap = NatalieParser::LocalsHashmap;
+
+    SharedPtr<SymbolTable> symbols() const { return m_symbols; }
+
+    // see Lexer::Cancelled
+    void set_cancel_flag(const std::atomic<bool> *flag) { m_lexer.set_cancel_flag(flag); }
+
+    // see Lexer::set_keep_doc_comments()
+    void set_keep_doc_comments(bool keep) { m_lexer.set_keep_doc_comments(keep); }
 
     enum class Precedence;
 
@@ -55,166 +69,194 @@ public:
         CURLY_AND_BLOCK,
     };
 
-    SharedPtr<Node> tree();
+    Tree tree();
+
+    // Same as tree(), but converted to the flat representation.
+    FlatAst flat_tree();
+
+    // Runs the same grammar as tree() and throws the same SyntaxError, but
+    // drops each top-level expression as soon as it is parsed instead of
+    // building up the whole tree.
+    void check();
+
+    // A top-level expression, along with what IncrementalParser needs to
+    // know to restart parsing at it or to reuse it.
+    struct Statement {
+        size_t offset { 0 }; // of its first token
+        Token token {}; // its first token
+        Arena::Ref arena {}; // owns node, and the code its tokens point into
+        NodePtr<Node> node {};
+        Vector<SharedPtr<String>> new_locals {}; // top-level locals it assigns first
+    };
+
+    // Parses top-level expressions starting at byte offset start (see
+    // Lexer::seek), with the given local variables already assigned.
+    // Before each expression, should_stop gets its offset and the
+    // expressions parsed so far, and can end parsing there.
+    Vector<Statement> parse_statements(size_t start, const Vector<SharedPtr<String>> &locals, std::function<bool(size_t, const Vector<Statement> &)> should_stop);
 
 private:
-    bool higher_precedence(Token &token, SharedPtr<Node> left, Precedence current_precedence, IterAllow iter_allow);
+    bool higher_precedence(Token &token, NodePtr<Node> left, Precedence current_precedence, IterAllow iter_allow);
 
-    Precedence get_precedence(Token &token, SharedPtr<Node> left = {});
+    Precedence get_precedence(Token &token, NodePtr<Node> left = {});
 
-    bool is_first_arg_of_call_without_parens(SharedPtr<Node>, Token &);
+    bool is_first_arg_of_call_without_parens(NodePtr<Node>, Token &);
 
-    SharedPtr<Node> parse_expression(Precedence, LocalsHashmap &, IterAllow = IterAllow::CURLY_AND_BLOCK);
+    NodePtr<Node> parse_expression(Precedence, LocalsHashmap &, IterAllow = IterAllow::CURLY_AND_BLOCK);
 
-    SharedPtr<BlockNode> parse_body(LocalsHashmap &, Precedence, std::function<bool(Token::Type)>, bool = false);
-    SharedPtr<BlockNode> parse_body(LocalsHashmap &, Precedence, Token::Type = Token::Type::EndKeyword, bool = false);
-    SharedPtr<BlockNode> parse_case_body(LocalsHashmap &, Token::Type);
-    SharedPtr<Node> parse_if_body(LocalsHashmap &);
-    SharedPtr<BlockNode> parse_def_body(LocalsHashmap &);
+    NodePtr<BlockNode> parse_body(LocalsHashmap &, Precedence, std::function<bool(Token::Type)>, bool = false);
+    NodePtr<BlockNode> parse_body(LocalsHashmap &, Precedence, Token::Type = Token::Type::EndKeyword, bool = false);
+    NodePtr<BlockNode> parse_case_body(LocalsHashmap &, Token::Type);
+    NodePtr<Node> parse_if_body(LocalsHashmap &);
+    NodePtr<BlockNode> parse_def_body(LocalsHashmap &);
 
     void reinsert_collapsed_newline();
-    SharedPtr<Node> parse_alias(LocalsHashmap &);
-    SharedPtr<SymbolNode> parse_alias_arg(LocalsHashmap &, const char *);
+    NodePtr<Node> parse_alias(LocalsHashmap &);
+    NodePtr<SymbolNode> parse_alias_arg(LocalsHashmap &, const char *);
     SharedPtr<String> parse_valias_arg(bool allow_number, const char *);
 
-    SharedPtr<Node> parse_array(LocalsHashmap &);
-    SharedPtr<Node> parse_back_ref(LocalsHashmap &);
-    SharedPtr<Node> parse_begin_block(LocalsHashmap &);
-    SharedPtr<Node> parse_begin(LocalsHashmap &);
+    NodePtr<Node> parse_array(LocalsHashmap &);
+    NodePtr<Node> parse_back_ref(LocalsHashmap &);
+    NodePtr<Node> parse_begin_block(LocalsHashmap &);
+    NodePtr<Node> parse_begin(LocalsHashmap &);
     void parse_rest_of_begin(BeginNode &, LocalsHashmap &);
-    SharedPtr<Node> parse_beginless_range(LocalsHashmap &);
-    SharedPtr<Node> parse_block_pass(LocalsHashmap &);
-    SharedPtr<Node> parse_bool(LocalsHashmap &);
-    SharedPtr<Node> parse_break(LocalsHashmap &);
-    SharedPtr<Node> parse_class(LocalsHashmap &);
-    SharedPtr<Node> parse_class_or_module_name(LocalsHashmap &);
-    SharedPtr<Node> parse_case(LocalsHashmap &);
-    SharedPtr<Node> parse_case_in_pattern(LocalsHashmap &);
-    SharedPtr<Node> parse_case_in_pattern_alternation(LocalsHashmap &);
-    SharedPtr<Node> parse_case_in_pattern_hash_symbol_key(LocalsHashmap &);
-    SharedPtr<Node> parse_case_in_patterns(LocalsHashmap &);
+    NodePtr<Node> parse_beginless_range(LocalsHashmap &);
+    NodePtr<Node> parse_block_pass(LocalsHashmap &);
+    NodePtr<Node> parse_bool(LocalsHashmap &);
+    NodePtr<Node> parse_break(LocalsHashmap &);
+    NodePtr<Node> parse_class(LocalsHashmap &);
+    NodePtr<Node> parse_class_or_module_name(LocalsHashmap &);
+    NodePtr<Node> parse_case(LocalsHashmap &);
+    NodePtr<Node> parse_case_in_pattern(LocalsHashmap &);
+    NodePtr<Node> parse_case_in_pattern_alternation(LocalsHashmap &);
+    NodePtr<Node> parse_case_in_pattern_hash_symbol_key(LocalsHashmap &);
+    NodePtr<Node> parse_case_in_patterns(LocalsHashmap &);
     void parse_comma_separated_expressions(ArrayNode &, LocalsHashmap &);
-    SharedPtr<Node> parse_constant(LocalsHashmap &);
-    SharedPtr<Node> parse_def(LocalsHashmap &);
-    SharedPtr<Node> parse_defined(LocalsHashmap &);
+    NodePtr<Node> parse_constant(LocalsHashmap &);
+    NodePtr<Node> parse_def(LocalsHashmap &);
+    NodePtr<Node> parse_defined(LocalsHashmap &);
 
-    void parse_def_args(Vector<SharedPtr<Node>> &, LocalsHashmap &);
+    void parse_def_args(ArenaVector<NodePtr<Node>> &, LocalsHashmap &);
     enum class ArgsContext {
         Block,
         Method,
         Proc,
     };
-    void parse_def_single_arg(Vector<SharedPtr<Node>> &, LocalsHashmap &, ArgsContext, IterAllow = IterAllow::CURLY_AND_BLOCK);
-    SharedPtr<Node> parse_arg_default_value(LocalsHashmap &, IterAllow);
-
-    SharedPtr<Node> parse_encoding(LocalsHashmap &);
-    SharedPtr<Node> parse_end_block(LocalsHashmap &);
-    SharedPtr<Node> parse_file_constant(LocalsHashmap &);
-    SharedPtr<Node> parse_for(LocalsHashmap &);
-    SharedPtr<Node> parse_forward_args(LocalsHashmap &);
-    SharedPtr<Node> parse_group(LocalsHashmap &);
-    SharedPtr<Node> parse_hash(LocalsHashmap &);
-    SharedPtr<Node> parse_hash_inner(LocalsHashmap &, Precedence, Token::Type, bool, SharedPtr<Node> = {});
-    SharedPtr<Node> parse_identifier(LocalsHashmap &);
-    SharedPtr<Node> parse_if(LocalsHashmap &);
-    SharedPtr<Node> parse_if_branch(LocalsHashmap &, bool);
+    void parse_def_single_arg(ArenaVector<NodePtr<Node>> &, LocalsHashmap &, ArgsContext, IterAllow = IterAllow::CURLY_AND_BLOCK);
+    NodePtr<Node> parse_arg_default_value(LocalsHashmap &, IterAllow);
+
+    NodePtr<Node> parse_encoding(LocalsHashmap &);
+    NodePtr<Node> parse_end_block(LocalsHashmap &);
+    NodePtr<Node> parse_file_constant(LocalsHashmap &);
+    NodePtr<Node> parse_for(LocalsHashmap &);
+    NodePtr<Node> parse_forward_args(LocalsHashmap &);
+    NodePtr<Node> parse_group(LocalsHashmap &);
+    NodePtr<Node> parse_hash(LocalsHashmap &);
+    NodePtr<Node> parse_hash_inner(LocalsHashmap &, Precedence, Token::Type, bool, NodePtr<Node> = {});
+    NodePtr<Node> parse_identifier(LocalsHashmap &);
+    NodePtr<Node> parse_if(LocalsHashmap &);
+    NodePtr<Node> parse_if_branch(LocalsHashmap &, bool);
     void parse_interpolated_body(LocalsHashmap &, InterpolatedNode &, Token::Type);
-    SharedPtr<Node> parse_interpolated_regexp(LocalsHashmap &);
+    NodePtr<Node> parse_interpolated_regexp(LocalsHashmap &);
     int parse_regexp_options(String &);
-    SharedPtr<Node> parse_interpolated_shell(LocalsHashmap &);
-    SharedPtr<Node> parse_interpolated_string(LocalsHashmap &);
-    SharedPtr<Node> parse_interpolated_symbol(LocalsHashmap &);
-    SharedPtr<Node> parse_line_constant(LocalsHashmap &);
-    SharedPtr<Node> parse_lit(LocalsHashmap &);
-    SharedPtr<Node> parse_keyword_splat(LocalsHashmap &);
-    SharedPtr<Node> parse_keyword_splat_wrapped_in_hash(LocalsHashmap &);
+    NodePtr<Node> parse_interpolated_shell(LocalsHashmap &);
+    NodePtr<Node> parse_interpolated_string(LocalsHashmap &);
+    NodePtr<Node> parse_interpolated_symbol(LocalsHashmap &);
+    NodePtr<Node> parse_line_constant(LocalsHashmap &);
+    NodePtr<Node> parse_lit(LocalsHashmap &);
+    NodePtr<Node> parse_keyword_splat(LocalsHashmap &);
+    NodePtr<Node> parse_keyword_splat_wrapped_in_hash(LocalsHashmap &);
     SharedPtr<String> parse_method_name(LocalsHashmap &);
-    SharedPtr<Node> parse_module(LocalsHashmap &);
-    SharedPtr<Node> parse_next(LocalsHashmap &);
-    SharedPtr<Node> parse_nil(LocalsHashmap &);
-    SharedPtr<Node> parse_not(LocalsHashmap &);
-    SharedPtr<Node> parse_nth_ref(LocalsHashmap &);
-    void parse_proc_args(Vector<SharedPtr<Node>> &, LocalsHashmap &, IterAllow);
-    SharedPtr<Node> parse_redo(LocalsHashmap &);
-    SharedPtr<Node> parse_retry(LocalsHashmap &);
-    SharedPtr<Node> parse_return(LocalsHashmap &);
-    SharedPtr<Node> parse_sclass(LocalsHashmap &);
-    SharedPtr<Node> parse_self(LocalsHashmap &);
-    void parse_shadow_variables_in_args(Vector<SharedPtr<Node>> &, LocalsHashmap &);
+    NodePtr<Node> parse_module(LocalsHashmap &);
+    NodePtr<Node> parse_next(LocalsHashmap &);
+    NodePtr<Node> parse_nil(LocalsHashmap &);
+    NodePtr<Node> parse_not(LocalsHashmap &);
+    NodePtr<Node> parse_nth_ref(LocalsHashmap &);
+    void parse_proc_args(ArenaVector<NodePtr<Node>> &, LocalsHashmap &, IterAllow);
+    NodePtr<Node> parse_redo(LocalsHashmap &);
+    NodePtr<Node> parse_retry(LocalsHashmap &);
+    NodePtr<Node> parse_return(LocalsHashmap &);
+    NodePtr<Node> parse_sclass(LocalsHashmap &);
+    NodePtr<Node> parse_self(LocalsHashmap &);
+    void parse_shadow_variables_in_args(ArenaVector<NodePtr<Node>> &, LocalsHashmap &);
     SharedPtr<String> parse_shadow_variable_single_arg();
-    SharedPtr<Node> parse_splat(LocalsHashmap &);
-    SharedPtr<Node> parse_stabby_proc(LocalsHashmap &);
-    SharedPtr<Node> parse_string(LocalsHashmap &);
-    SharedPtr<Node> parse_super(LocalsHashmap &);
-    SharedPtr<Node> parse_symbol(LocalsHashmap &);
-    SharedPtr<Node> parse_symbol_key(LocalsHashmap &);
-    SharedPtr<Node> parse_statement_keyword(LocalsHashmap &);
-    SharedPtr<Node> parse_top_level_constant(LocalsHashmap &);
-    SharedPtr<Node> parse_triple_dot(LocalsHashmap &);
-    SharedPtr<Node> parse_unary_operator(LocalsHashmap &);
-    SharedPtr<Node> parse_undef(LocalsHashmap &);
-    SharedPtr<Node> parse_unless(LocalsHashmap &);
-    SharedPtr<Node> parse_while(LocalsHashmap &);
-    SharedPtr<Node> parse_word_array(LocalsHashmap &);
-    SharedPtr<Node> parse_word_symbol_array(LocalsHashmap &);
-    SharedPtr<Node> parse_yield(LocalsHashmap &);
-
-    SharedPtr<Node> parse_assignment_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_assignment_expression_without_multiple_values(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_assignment_expression(SharedPtr<Node>, LocalsHashmap &, bool);
-    void add_assignment_locals(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_assignment_expression_value(bool, LocalsHashmap &, bool);
-    SharedPtr<Node> parse_assignment_identifier(bool, LocalsHashmap &);
-    SharedPtr<Node> parse_call_expression_without_parens(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_call_expression_with_parens(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_call_hash_args(LocalsHashmap &, bool, Token::Type, SharedPtr<Node>);
-    SharedPtr<Node> parse_constant_resolution_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_infix_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_proc_call_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_iter_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<BlockNode> parse_iter_body(LocalsHashmap &, bool);
-    SharedPtr<Node> parse_logical_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_match_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_modifier_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_multiple_assignment_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_not_match_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_op_assign_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_op_attr_assign_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_range_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_ref_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_rescue_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_safe_send_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_send_expression(SharedPtr<Node>, LocalsHashmap &);
-    SharedPtr<Node> parse_ternary_expression(SharedPtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_splat(LocalsHashmap &);
+    NodePtr<Node> parse_stabby_proc(LocalsHashmap &);
+    NodePtr<Node> parse_string(LocalsHashmap &);
+    NodePtr<Node> parse_super(LocalsHashmap &);
+    NodePtr<Node> parse_symbol(LocalsHashmap &);
+    NodePtr<Node> parse_symbol_key(LocalsHashmap &);
+    NodePtr<Node> parse_statement_keyword(LocalsHashmap &);
+    NodePtr<Node> parse_top_level_constant(LocalsHashmap &);
+    NodePtr<Node> parse_triple_dot(LocalsHashmap &);
+    NodePtr<Node> parse_unary_operator(LocalsHashmap &);
+    NodePtr<Node> parse_undef(LocalsHashmap &);
+    NodePtr<Node> parse_unless(LocalsHashmap &);
+    NodePtr<Node> parse_while(LocalsHashmap &);
+    NodePtr<Node> parse_word_array(LocalsHashmap &);
+    NodePtr<Node> parse_word_symbol_array(LocalsHashmap &);
+    NodePtr<Node> parse_yield(LocalsHashmap &);
+
+    NodePtr<Node> parse_assignment_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_assignment_expression_without_multiple_values(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_assignment_expression(NodePtr<Node>, LocalsHashmap &, bool);
+    void add_assignment_locals(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_assignment_expression_value(bool, LocalsHashmap &, bool);
+    NodePtr<Node> parse_assignment_identifier(bool, LocalsHashmap &);
+    NodePtr<Node> parse_call_expression_without_parens(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_call_expression_with_parens(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_call_hash_args(LocalsHashmap &, bool, Token::Type, NodePtr<Node>);
+    NodePtr<Node> parse_constant_resolution_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_infix_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_proc_call_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_iter_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<BlockNode> parse_iter_body(LocalsHashmap &, bool);
+    NodePtr<Node> parse_logical_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_match_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_modifier_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_multiple_assignment_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_not_match_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_op_assign_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_op_attr_assign_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_range_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_ref_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_rescue_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_safe_send_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_send_expression(NodePtr<Node>, LocalsHashmap &);
+    NodePtr<Node> parse_ternary_expression(NodePtr<Node>, LocalsHashmap &);
 
     void parse_call_args(NodeWithArgs &, LocalsHashmap &, bool = false, Token::Type = Token::Type::RParen);
-    void parse_iter_args(Vector<SharedPtr<Node>> &, LocalsHashmap &);
+    void parse_iter_args(ArenaVector<NodePtr<Node>> &, LocalsHashmap &);
 
-    using parse_null_fn = SharedPtr<Node> (Parser::*)(LocalsHashmap &);
-    using parse_left_fn = SharedPtr<Node> (Parser::*)(SharedPtr<Node>, LocalsHashmap &);
+    using parse_null_fn = NodePtr<Node> (Parser::*)(LocalsHashmap &);
+    using parse_left_fn = NodePtr<Node> (Parser::*)(NodePtr<Node>, LocalsHashmap &);
 
     parse_null_fn null_denotation(Token::Type);
-    parse_left_fn left_denotation(Token &, SharedPtr<Node>, Precedence);
+    parse_left_fn left_denotation(Token &, NodePtr<Node>, Precedence);
 
-    bool treat_left_bracket_as_element_reference(SharedPtr<Node> left, Token &token) {
+    bool treat_left_bracket_as_element_reference(NodePtr<Node> left, Token &token) {
         return !token.whitespace_precedes() || (left->type() == Node::Type::Identifier && left.static_cast_as<IdentifierNode>()->is_lvar());
     }
 
     // convert ((x and y) and z) to (x and (y and z))
     template <typename T>
-    SharedPtr<Node> regroup(Token &token, SharedPtr<Node> left, SharedPtr<Node> right) {
+    NodePtr<Node> regroup(Token &token, NodePtr<Node> left, NodePtr<Node> right) {
         auto left_node = left.static_cast_as<T>();
         return new T { left_node->token(), left_node->left(), new T { token, left_node->right(), right } };
     };
 
-    SharedPtr<Node> append_string_nodes(SharedPtr<Node> string1, SharedPtr<Node> string2);
-    SharedPtr<Node> concat_adjacent_strings(SharedPtr<Node> string, LocalsHashmap &locals, bool &strings_were_appended);
+    NodePtr<Node> append_string_nodes(NodePtr<Node> string1, NodePtr<Node> string2);
+    NodePtr<Node> concat_adjacent_strings(NodePtr<Node> string, LocalsHashmap &locals, bool &strings_were_appended);
+
+    NodePtr<NodeWithArgs> to_node_with_args(NodePtr<Node> node);
 
-    SharedPtr<NodeWithArgs> to_node_with_args(SharedPtr<Node> node);
+    Token &previous_token();
+    Token &current_token();
+    Token &peek_token();
 
-    Token &previous_token() const;
-    Token &current_token() const;
-    Token &peek_token() const;
+    Token &token_at(size_t);
+    void insert_token(Token);
+    void retire_consumed_tokens();
 
     void next_expression();
     void skip_newlines();
@@ -235,8 +277,18 @@ private:
 
     SharedPtr<String> m_code;
     SharedPtr<String> m_file;
+    SharedPtr<SymbolTable> m_symbols;
+    Arena::Ref m_arena { new Arena };
+    Lexer m_lexer;
+    bool m_lexer_finished { false };
+
+    // Tokens are pulled from the lexer as the parser needs them. m_tokens is
+    // a sliding window over the token stream: m_index is the absolute index
+    // of the current token, and m_window_start is the absolute index of
+    // m_tokens[0].
     size_t m_index { 0 };
-    SharedPtr<Vector<Token>> m_tokens {};
+    size_t m_window_start { 0 };
+    Vector<Token> m_tokens {};
 
     Vector<Precedence> m_precedence_stack {};
     Vector<unsigned int> m_call_depth {};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "natalie_parser/line_index.hpp"
+#include "natalie_parser/symbol_table.hpp"
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// The code a Lexer reads, and what it takes to turn the Tokens it makes
+// back into names and positions. A token is only an offset into the code
+// (see Token), so the lexer never copies a name; it goes into the
+// SymbolTable the first time the parser asks for it as a String.
+//
+// The lexers of nested literals share their parent's Source, even for a
+// heredoc body, which is lexed from a copy (see Lexer::reads_source()).
+class Source {
+public:
+    // What doesn't fit in a Token: a literal that isn't a span of the code
+    // (a string with its escapes decoded, a number), a doc comment, or a
+    // position that isn't an offset into the code, such as one in a
+    // heredoc body.
+    struct TokenValue {
+        SharedPtr<String> literal {};
+        SharedPtr<String> doc {};
+        union {
+            long long fixnum { 0 };
+            double dbl;
+        };
+        uint32_t line { 0 };
+        uint32_t column { 0 };
+        SymbolTable::Id symbol_id { 0 };
+    };
+
+    Source(SharedPtr<String> code, SharedPtr<String> file, SharedPtr<SymbolTable> symbols)
+        : m_code { code }
+        , m_file { file }
+        , m_symbols { symbols }
+        , m_line_index { new LineIndex { *code } } {
+        assert(code->length() <= UINT32_MAX); // see Token
+    }
+
+    Source(const Source &) = delete;
+    Source &operator=(const Source &) = delete;
+
+    const SharedPtr<String> &code() const { return m_code; }
+    SharedPtr<String> file() const { return m_file; }
+    const SharedPtr<SymbolTable> &symbols() const { return m_symbols; }
+    const SharedPtr<LineIndex> &line_index() const { return m_line_index; }
+
+    const char *at(size_t offset) const { return m_code->c_str() + offset; }
+
+    SymbolTable::Id intern(size_t offset, size_t length) const {
+        return m_symbols->intern(at(offset), length);
+    }
+
+    SharedPtr<String> name(size_t offset, size_t length) const {
+        return m_symbols->string(intern(offset, length));
+    }
+
+    // Values are only ever added, since any number of copies of a Token
+    // may refer to one. Adding one invalidates references to the others.
+    uint32_t add_value(const TokenValue &value) {
+        m_values.push(value);
+        return static_cast<uint32_t>(m_values.size() - 1);
+    }
+
+    const TokenValue &value(uint32_t index) const { return m_values[index]; }
+
+    // A counted reference to a Source. Tokens point to their Source with
+    // a plain pointer, to stay small and cheap to copy, so whatever keeps
+    // tokens after their Lexer is gone (a Node, a LexerState) holds one of
+    // these as well.
+    class Ref {
+    public:
+        Ref() { }
+
+        Ref(Source *source)
+            : m_source { source } {
+            if (m_source)
+                m_source->m_ref_count++;
+        }
+
+        Ref(const Ref &other)
+            : Ref { other.m_source } { }
+
+        Ref(Ref &&other)
+            : m_source { other.m_source } {
+            other.m_source = nullptr;
+        }
+
+        ~Ref() { release(); }
+
+        Ref &operator=(const Ref &other) {
+            if (other.m_source)
+                other.m_source->m_ref_count++;
+            release();
+            m_source = other.m_source;
+            return *this;
+        }
+
+        Ref &operator=(Ref &&other) {
+            if (this == &other)
+                return *this;
+            release();
+            m_source = other.m_source;
+            other.m_source = nullptr;
+            return *this;
+        }
+
+        Source *operator->() const {
+            assert(m_source);
+            return m_source;
+        }
+
+        Source *ptr() const { return m_source; }
+
+        operator bool() const { return !!m_source; }
+
+    private:
+        void release() {
+            if (m_source && --m_source->m_ref_count == 0)
+                delete m_source;
+            m_source = nullptr;
+        }
+
+        Source *m_source { nullptr };
+    };
+
+private:
+    SharedPtr<String> m_code;
+    SharedPtr<String> m_file;
+    SharedPtr<SymbolTable> m_symbols;
+    SharedPtr<LineIndex> m_line_index;
+    Vector<TokenValue> m_values {};
+    unsigned int m_ref_count { 0 };
+};
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace NatalieParser {
+
+using namespace TM;
+
+// Interns the names (identifiers, constants, variables, symbols) seen while
+// parsing a file, so each distinct name is allocated once and gets a small
+// integer id. Ids start at 1; 0 means "not interned".
+class SymbolTable {
+public:
+    using Id = uint32_t;
+
+    // These are interned up front so the parser can check for them by id.
+    enum WellKnownId : Id {
+        Private = 1,
+        Protected,
+        Public,
+    };
+
+    SymbolTable();
+
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    Id intern(const char *name, size_t length);
+    Id intern(const String &name) { return intern(name.c_str(), name.length()); }
+
+    // Returns the id of the name without interning it, or 0.
+    Id lookup(const char *name, size_t length) const;
+    Id lookup(const String &name) const { return lookup(name.c_str(), name.length()); }
+
+    // Returns the id if this is the shared String instance handed out by
+    // string(), or 0 for any other String (even one with the same contents).
+    Id find(const String *string) const;
+
+    SharedPtr<String> string(Id id) const {
+        assert(id > 0 && id <= m_strings.size());
+        return m_strings[id - 1];
+    }
+
+    size_t size() const { return m_strings.size(); }
+
+private:
+    Id lookup(const char *name, size_t length, size_t hash) const;
+    void grow();
+
+    Vector<SharedPtr<String>> m_strings {};
+
+    // open addressing; both tables hold ids and 0 marks an empty slot
+    Vector<Id> m_by_name {};
+    Vector<Id> m_by_pointer {};
+    Vector<uint32_t> m_hashes {};
+};
+
+}
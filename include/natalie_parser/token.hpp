@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stdint.h>
+
+#include "natalie_parser/source.hpp"
 #include "tm/macros.hpp"
 #include "tm/optional.hpp"
 #include "tm/shared_ptr.hpp"
@@ -11,7 +14,7 @@ using namespace TM;
 
 class Token {
 public:
-    enum class Type {
+    enum class Type : unsigned char {
         Invalid, // must be first
         InvalidCharacterEscape,
         InvalidUnicodeEscape,
@@ -159,71 +162,56 @@ public:
 
     Token() { }
 
-    Token(Type type, SharedPtr<String> file, size_t line, size_t column, bool whitespace_precedes)
-        : m_type { type }
-        , m_file { file }
-        , m_line { line }
-        , m_column { column }
-        , m_whitespace_precedes { whitespace_precedes } {
-        assert(file);
-    }
-
-    Token(Type type, const char *literal, SharedPtr<String> file, size_t line, size_t column, bool whitespace_precedes)
-        : m_type { type }
-        , m_literal { new String(literal) }
-        , m_file { file }
-        , m_line { line }
-        , m_column { column }
-        , m_whitespace_precedes { whitespace_precedes } {
-        assert(literal);
-        assert(file);
-    }
-
-    Token(Type type, SharedPtr<String> literal, SharedPtr<String> file, size_t line, size_t column, bool whitespace_precedes)
-        : m_type { type }
-        , m_literal { literal }
-        , m_file { file }
-        , m_line { line }
-        , m_column { column }
-        , m_whitespace_precedes { whitespace_precedes } {
-        assert(literal);
-        assert(file);
-    }
-
-    Token(Type type, char literal, SharedPtr<String> file, size_t line, size_t column, bool whitespace_precedes)
-        : m_type { type }
-        , m_literal { new String(literal) }
-        , m_file { file }
-        , m_line { line }
-        , m_column { column }
-        , m_whitespace_precedes { whitespace_precedes } {
-        assert(file);
-    }
-
-    Token(Type type, long long fixnum, SharedPtr<String> file, size_t line, size_t column, bool whitespace_precedes)
-        : m_type { type }
-        , m_fixnum { fixnum }
-        , m_file { file }
-        , m_line { line }
-        , m_column { column }
-        , m_whitespace_precedes { whitespace_precedes } {
-        assert(file);
-    }
-
-    Token(Type type, double dbl, SharedPtr<String> file, size_t line, size_t column, bool whitespace_precedes)
-        : m_type { type }
-        , m_double { dbl }
-        , m_file { file }
-        , m_line { line }
-        , m_column { column }
-        , m_whitespace_precedes { whitespace_precedes } {
-        assert(file);
+    // A token at offset in the source's code, whose type says it all.
+    Token(Type type, Source *source, size_t offset, bool whitespace_precedes)
+        : m_source { source }
+        , m_offset { static_cast<uint32_t>(offset) }
+        , m_type { type }
+        , m_flags { flags(whitespace_precedes) } {
+        assert(offset <= source->code()->length());
+    }
+
+    // A name: its literal is length bytes of the code at offset, and the
+    // token starts prefix bytes earlier (the colon of a symbol).
+    Token(Type type, Source *source, size_t offset, size_t length, size_t prefix, bool whitespace_precedes)
+        : m_source { source }
+        , m_offset { static_cast<uint32_t>(offset) }
+        , m_length { static_cast<uint16_t>(length) }
+        , m_type { type }
+        , m_flags { static_cast<uint8_t>(flags(whitespace_precedes) | Span | prefix << PrefixShift) } {
+        assert(length <= MAX_SPAN_LENGTH && prefix <= MAX_SPAN_PREFIX && prefix <= offset);
+        assert(offset + length <= source->code()->length());
+    }
+
+    // Anything else keeps its literal, number or position in the source.
+    Token(Type type, Source *source, const Source::TokenValue &value, bool whitespace_precedes)
+        : m_source { source }
+        , m_offset { source->add_value(value) }
+        , m_type { type }
+        , m_flags { static_cast<uint8_t>(flags(whitespace_precedes) | Value) } { }
+
+    // A token of another type, with no literal, in the same place.
+    Token(Type type, const Token &place)
+        : m_source { place.m_source }
+        , m_offset { place.m_offset }
+        , m_type { type }
+        , m_flags { flags(place.whitespace_precedes()) } {
+        if (place.is_span()) {
+            m_offset = place.start();
+        } else if (place.has_value()) {
+            Source::TokenValue value;
+            value.line = place.line();
+            value.column = place.column();
+            set_value(value);
+        }
     }
 
+    static constexpr size_t MAX_SPAN_LENGTH = UINT16_MAX;
+    static constexpr size_t MAX_SPAN_PREFIX = 31;
+
     static Token &invalid() {
-        if (!s_invalid)
-            s_invalid = new Token {};
-        return *s_invalid;
+        static Token invalid_token {};
+        return invalid_token;
     }
 
     operator bool() const { return is_valid(); }
@@ -232,26 +220,37 @@ public:
     void set_type(Token::Type type) { m_type = type; }
 
     const char *literal() const {
-        if (!m_literal)
+        if (is_span())
+            return m_source->symbols()->string(symbol_id())->c_str();
+        if (!has_value() || !value().literal)
             return nullptr;
-        return m_literal.value()->c_str();
+        return value().literal->c_str();
     }
 
     const char *literal_or_blank() const {
-        if (!m_literal)
-            return "";
-        return m_literal.value()->c_str();
+        auto lit = literal();
+        return lit ? lit : "";
     }
 
     SharedPtr<String> literal_string() const {
-        assert(m_literal);
-        return m_literal.value();
+        if (is_span())
+            return m_source->name(m_offset, m_length);
+        assert(has_value() && value().literal);
+        return value().literal;
     }
 
     bool has_literal() const {
-        return !!m_literal;
+        return is_span() || (has_value() && value().literal);
     }
 
+    // Names are a span of the source's code rather than a String of their
+    // own; literal_string() (or symbol_id()) copies one into the
+    // SymbolTable the first time it is asked for.
+    Source *source() const { return m_source; }
+    bool is_span() const { return m_flags & Span; }
+    const char *span() const { return m_source->at(m_offset); }
+    size_t span_length() const { return m_length; }
+
     const char *type_value() const {
         switch (m_type) {
         case Type::AliasKeyword:
@@ -891,39 +890,117 @@ public:
         }
     }
 
-    void set_literal(const char *literal) { m_literal = new String(literal); }
-    void set_literal(SharedPtr<String> literal) { m_literal = literal; }
-    void set_literal(String literal) { m_literal = new String(literal); }
+    void set_literal(const char *literal) { set_literal(SharedPtr<String>(new String(literal))); }
+    void set_literal(String literal) { set_literal(SharedPtr<String>(new String(literal))); }
+    void set_literal(SharedPtr<String> literal) {
+        auto value = copy_value();
+        value.literal = literal;
+        value.symbol_id = 0;
+        set_value(value);
+    }
 
-    Optional<SharedPtr<String>> doc() const { return m_doc; }
-    void set_doc(SharedPtr<String> doc) { m_doc = doc; }
+    // For names, the id of the literal in the parser's SymbolTable, else 0.
+    uint32_t symbol_id() const {
+        if (is_span())
+            return m_source->intern(m_offset, m_length);
+        return has_value() ? value().symbol_id : 0;
+    }
 
-    long long get_fixnum() const { return m_fixnum; }
-    double get_double() const { return m_double; }
+    Optional<SharedPtr<String>> doc() const {
+        if (!has_value() || !value().doc)
+            return {};
+        return value().doc;
+    }
+    void set_doc(SharedPtr<String> doc) {
+        auto value = copy_value();
+        value.doc = doc;
+        set_value(value);
+    }
 
-    SharedPtr<String> file() const { return m_file; }
+    long long get_fixnum() const { return has_value() ? value().fixnum : 0; }
+    double get_double() const { return has_value() ? value().dbl : 0; }
 
-    size_t line() const { return m_line; }
-    void set_line(size_t line) { m_line = line; }
+    SharedPtr<String> file() const {
+        if (!m_source)
+            return {};
+        return m_source->file();
+    }
+
+    size_t line() const {
+        if (has_value())
+            return value().line;
+        return m_source ? m_source->line_index()->line(start()) : 0;
+    }
+    void set_line(size_t line) {
+        auto value = copy_value();
+        value.line = line;
+        set_value(value);
+    }
 
-    size_t column() const { return m_column; }
-    void set_column(size_t column) { m_column = column; }
+    size_t column() const {
+        if (has_value())
+            return value().column;
+        return m_source ? m_source->line_index()->column(start()) : 0;
+    }
+    void set_column(size_t column) {
+        auto value = copy_value();
+        value.column = column;
+        set_value(value);
+    }
 
-    bool whitespace_precedes() const { return m_whitespace_precedes; }
-    void set_whitespace_precedes(bool whitespace_precedes) { m_whitespace_precedes = whitespace_precedes; }
+    bool whitespace_precedes() const { return m_flags & WhitespacePrecedes; }
+    void set_whitespace_precedes(bool whitespace_precedes) {
+        m_flags = whitespace_precedes ? m_flags | WhitespacePrecedes : m_flags & ~WhitespacePrecedes;
+    }
 
     void validate();
 
 private:
+    enum Flag : uint8_t {
+        WhitespacePrecedes = 1,
+        Span = 2, // m_offset and m_length are a name in the code
+        Value = 4, // m_offset is the index of a Source::TokenValue
+    };
+    static constexpr int PrefixShift = 3; // the rest of m_flags, for spans
+
+    static uint8_t flags(bool whitespace_precedes) { return whitespace_precedes ? WhitespacePrecedes : 0; }
+
+    bool has_value() const { return m_flags & Value; }
+    const Source::TokenValue &value() const { return m_source->value(m_offset); }
+
+    // the offset in the code where the token starts
+    size_t start() const { return is_span() ? m_offset - (m_flags >> PrefixShift) : m_offset; }
+
+    Source::TokenValue copy_value() const {
+        assert(m_source);
+        if (has_value())
+            return value();
+        Source::TokenValue value;
+        if (is_span()) {
+            value.symbol_id = symbol_id();
+            value.literal = m_source->symbols()->string(value.symbol_id);
+        }
+        value.line = line();
+        value.column = column();
+        return value;
+    }
+
+    // Copies of this token keep the value they had.
+    void set_value(const Source::TokenValue &value) {
+        m_offset = m_source->add_value(value);
+        m_length = 0;
+        m_flags = (m_flags & WhitespacePrecedes) | Value;
+    }
+
+    // Tokens are copied around a lot by the parser and embedded in every
+    // node, so they are 16 bytes: an offset into the code, or the index of
+    // whatever else they need in the Source.
+    Source *m_source { nullptr };
+    uint32_t m_offset { 0 };
+    uint16_t m_length { 0 };
     Type m_type { Type::Invalid };
-    Optional<SharedPtr<String>> m_literal {};
-    Optional<SharedPtr<String>> m_doc {};
-    long long m_fixnum { 0 };
-    double m_double { 0 };
-    SharedPtr<String> m_file;
-    size_t m_line { 0 };
-    size_t m_column { 0 };
-    bool m_whitespace_precedes { false };
-    static inline Token *s_invalid { nullptr };
+    uint8_t m_flags { 0 };
 };
+
+static_assert(sizeof(Token) == 16);
 }
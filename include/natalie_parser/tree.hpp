@@ -0,0 +1,35 @@
+#pragma once
+
+#include "natalie_parser/arena.hpp"
+#include "natalie_parser/node_ptr.hpp"
+
+namespace NatalieParser {
+
+class Node;
+
+// What Parser::tree() returns: the root node, along with the Arena that
+// owns it and every node below it. The nodes are all freed at once when
+// the last Tree (or other Arena::Ref) for them goes away, so a node may
+// not be used after that.
+class Tree {
+public:
+    Tree() { }
+
+    Tree(NodePtr<Node> root, Arena::Ref arena)
+        : m_root { root }
+        , m_arena { arena } { }
+
+    Node *operator->() const { return m_root.operator->(); }
+    Node &operator*() const { return *m_root; }
+
+    NodePtr<Node> root() const { return m_root; }
+    const Arena::Ref &arena() const { return m_arena; }
+
+    operator bool() const { return !!m_root; }
+
+private:
+    NodePtr<Node> m_root {};
+    Arena::Ref m_arena {};
+};
+
+}
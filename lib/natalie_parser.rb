@@ -1,3 +1,4 @@
 require_relative './natalie_parser/sexp'
 require_relative './natalie_parser/version'
 require 'natalie_parser/natalie_parser'
+require_relative './natalie_parser/binary_ast'
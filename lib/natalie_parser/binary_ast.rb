@@ -0,0 +1,178 @@
+require_relative './sexp'
+
+class NatalieParser
+  # Reads the binary form of a tree written by NatalieParser.serialize
+  # (the format is described in include/natalie_parser/binary_ast.hpp)
+  # straight out of the String it is given, without the C extension.
+  #
+  #     ast = NatalieParser::BinaryAst.new(File.binread('foo.ast'))
+  #     ast.file    # => "foo.rb"
+  #     ast.to_sexp # => the same Sexp NatalieParser.parse gave
+  #
+  # Unlike NatalieParser.deserialize, this only checks the header, so a
+  # damaged tree may raise something other than FormatError.
+  class BinaryAst
+    VERSION = 1
+    HEADER_SIZE = 20
+
+    LOCATIONS = 1
+    COMMENTS = 2
+
+    SEXP = 1
+    BIGNUM = 2
+    COMPLEX = 3
+    FALSE = 4
+    FIXNUM = 5
+    FLOAT = 6
+    NIL = 7
+    RANGE = 8
+    RATIONAL = 9
+    REGEXP = 10
+    STRING = 11
+    SYMBOL = 12
+    TRUE = 13
+
+    class FormatError < StandardError; end
+
+    attr_reader :flags, :file
+
+    def initialize(data)
+      @data = data
+      raise FormatError, 'not a binary AST' unless data.bytesize >= HEADER_SIZE && data.byteslice(0, 4) == 'NPAB'
+
+      version, @flags, file, @strings_offset, size = data.unpack('S<S<L<L<L<', offset: 4)
+      raise FormatError, 'binary AST is from a different version' unless version == VERSION
+      raise FormatError, 'binary AST is truncated' if size > data.bytesize || @strings_offset + 8 > size
+
+      @string_count = data.unpack1('L<', offset: @strings_offset)
+      @strings_start = @strings_offset + 4 + (@string_count + 1) * 4
+      raise FormatError, 'binary AST is truncated' if @strings_start > size
+
+      @symbols = {}
+      @file = string(file)
+    end
+
+    def locations?
+      @flags & LOCATIONS != 0
+    end
+
+    def comments?
+      @flags & COMMENTS != 0
+    end
+
+    def to_sexp
+      read(HEADER_SIZE).first
+    end
+
+    # by string number (index + 1), or nil for 0
+    def string(number)
+      return if number.zero?
+
+      start, finish = @data.unpack('L<L<', offset: @strings_offset + 4 * number)
+      @data.byteslice(@strings_start + start, finish - start)
+    end
+
+    private
+
+    # the value at offset, and the offset after it
+    def read(offset)
+      kind = @data.getbyte(offset)
+      offset += 1
+      case kind
+      when SEXP
+        read_sexp(offset)
+      when BIGNUM
+        number, offset = read_varint(offset)
+        [Integer(string(number)), offset]
+      when COMPLEX
+        number, offset = read(offset)
+        [Complex(0, number), offset]
+      when FALSE
+        [false, offset]
+      when FIXNUM
+        number, offset = read_varint(offset)
+        [unzigzag(number), offset]
+      when FLOAT
+        [@data.unpack1('E', offset: offset), offset + 8]
+      when NIL
+        [nil, offset]
+      when RANGE
+        exclude_end = @data.getbyte(offset) == 1
+        first, offset = read_varint(offset + 1)
+        last, offset = read_varint(offset)
+        [Range.new(unzigzag(first), unzigzag(last), exclude_end), offset]
+      when RATIONAL
+        number, offset = read(offset)
+        [number.is_a?(Float) ? number.rationalize : Rational(number, 1), offset]
+      when REGEXP
+        pattern, offset = read_varint(offset)
+        options, offset = read_varint(offset)
+        pattern = string(pattern)
+        pattern.force_encoding(pattern.ascii_only? ? Encoding::ASCII_8BIT : Encoding::UTF_8)
+        [Regexp.new(pattern, options), offset]
+      when STRING
+        number, offset = read_varint(offset)
+        value = string(number).force_encoding(Encoding::UTF_8)
+        value.force_encoding(Encoding::ASCII_8BIT) unless value.valid_encoding?
+        [value, offset]
+      when SYMBOL
+        number, offset = read_varint(offset)
+        [symbol(number), offset]
+      when TRUE
+        [true, offset]
+      else
+        raise FormatError, "binary AST has an unknown kind of value (#{kind.inspect})"
+      end
+    end
+
+    def read_sexp(offset)
+      sexp = Sexp.new
+      type, offset = read_varint(offset)
+      if locations?
+        line, offset = read_varint(offset)
+        column, offset = read_varint(offset)
+        sexp.file = @file
+        sexp.line = line + 1
+        sexp.column = column + 1
+      end
+      if comments?
+        comments, offset = read_varint(offset)
+        sexp.comments = string(comments).force_encoding(Encoding::UTF_8) unless comments.zero?
+      end
+      size, offset = read_varint(offset)
+      finish = offset + size
+      sexp << symbol(type) unless type.zero?
+      while offset < finish
+        value, offset = read(offset)
+        sexp << value
+      end
+      [sexp, offset]
+    end
+
+    def symbol(number)
+      @symbols[number] ||= begin
+        name = string(number)
+        name.force_encoding(name.ascii_only? ? Encoding::ASCII_8BIT : Encoding::UTF_8).to_sym
+      end
+    end
+
+    def read_varint(offset)
+      value = 0
+      shift = 0
+      loop do
+        byte = @data.getbyte(offset)
+        raise FormatError, 'binary AST is truncated' unless byte
+
+        offset += 1
+        value |= (byte & 0x7f) << shift
+        return [value, offset] if byte < 0x80
+
+        shift += 7
+      end
+    end
+
+    def unzigzag(value)
+      (value >> 1) ^ -(value & 1)
+    end
+  end
+end
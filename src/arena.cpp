@@ -0,0 +1,105 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "natalie_parser/arena.hpp"
+
+namespace NatalieParser {
+
+struct Arena::Chunk {
+    Chunk *next;
+    size_t used;
+    size_t capacity;
+    alignas(16) char data[1];
+};
+
+// Every allocation is preceded by its finalizer and size, so that the
+// finalizers can be found by walking the chunks.
+struct Header {
+    Arena::Finalizer finalize;
+    size_t size;
+};
+
+static constexpr size_t chunk_size = 64 * 1024;
+static constexpr size_t chunk_header_size = 32;
+static constexpr size_t chunk_data_size = chunk_size - chunk_header_size;
+static constexpr size_t max_chunk_allocation = chunk_data_size / 8;
+
+static size_t align(size_t size) {
+    return (size + alignof(void *) - 1) & ~(alignof(void *) - 1);
+}
+
+Arena::~Arena() {
+    for (auto chunk = m_chunks; chunk; chunk = chunk->next) {
+        size_t offset = 0;
+        while (offset < chunk->used) {
+            auto header = reinterpret_cast<Header *>(chunk->data + offset);
+            if (header->finalize)
+                header->finalize(header + 1);
+            offset += sizeof(Header) + header->size;
+        }
+    }
+    while (m_chunks) {
+        auto next = m_chunks->next;
+        free(m_chunks);
+        m_chunks = next;
+    }
+}
+
+void *Arena::allocate(size_t size, Finalizer finalize) {
+    assert(s_current);
+    size = align(size);
+    if (size > max_chunk_allocation)
+        return s_current->allocate_in_own_chunk(size, finalize);
+    return s_current->allocate_in_chunk(size, finalize);
+}
+
+void Arena::abandon(void *ptr) {
+    auto header = static_cast<Header *>(ptr) - 1;
+    header->finalize = nullptr;
+}
+
+void *Arena::allocate_in_chunk(size_t size, Finalizer finalize) {
+    static_assert(offsetof(Chunk, data) <= chunk_header_size);
+    auto needed = sizeof(Header) + size;
+    if (!m_chunks || m_chunks->used + needed > m_chunks->capacity) {
+        auto chunk = new_chunk(chunk_data_size);
+        chunk->next = m_chunks;
+        m_chunks = chunk;
+    }
+    auto header = reinterpret_cast<Header *>(m_chunks->data + m_chunks->used);
+    header->finalize = finalize;
+    header->size = size;
+    m_chunks->used += needed;
+    return header + 1;
+}
+
+// Big allocations (a long array literal's elements) get a chunk of their
+// own, behind the one being allocated from.
+void *Arena::allocate_in_own_chunk(size_t size, Finalizer finalize) {
+    auto chunk = new_chunk(sizeof(Header) + size);
+    if (m_chunks) {
+        chunk->next = m_chunks->next;
+        m_chunks->next = chunk;
+    } else {
+        chunk->next = nullptr;
+        m_chunks = chunk;
+    }
+    auto header = reinterpret_cast<Header *>(chunk->data);
+    header->finalize = finalize;
+    header->size = size;
+    chunk->used = chunk->capacity;
+    return header + 1;
+}
+
+Arena::Chunk *Arena::new_chunk(size_t capacity) {
+    auto chunk = static_cast<Chunk *>(malloc(chunk_header_size + capacity));
+    if (!chunk)
+        abort();
+    s_malloc_count.fetch_add(1, std::memory_order_relaxed);
+    chunk->next = nullptr;
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+}
@@ -0,0 +1,129 @@
+#include <errno.h>
+#include <stdio.h>
+
+#include "natalie_parser/batch_parser.hpp"
+#include "natalie_parser/parser.hpp"
+
+namespace NatalieParser {
+
+// how many finished results each worker may get ahead of next()
+static constexpr size_t results_ahead_per_thread = 4;
+
+BatchParser::BatchParser(Vector<String> paths, size_t thread_count)
+    : m_paths { paths }
+    , m_slots(paths.size(), Slot {}) {
+    for (size_t i = 0; i < m_paths.size(); i++)
+        m_slots[i].result.path = m_paths[i];
+
+    if (thread_count == 0)
+        thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0)
+        thread_count = 1;
+    if (thread_count > m_paths.size())
+        thread_count = m_paths.size();
+    m_max_ahead = thread_count * results_ahead_per_thread;
+
+    for (size_t i = 0; i < thread_count; i++)
+        m_threads.emplace_back([this]() { work(); });
+}
+
+BatchParser::~BatchParser() {
+    cancel();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+bool BatchParser::next(Result &result) {
+    std::unique_lock<std::mutex> lock { m_mutex };
+    if (m_next_result >= m_slots.size())
+        return false;
+    m_result_ready.wait(lock, [this]() { return m_cancelled.load() || m_slots[m_next_result].ready; });
+    if (m_cancelled.load())
+        return false;
+    auto &slot = m_slots[m_next_result++];
+    result = slot.result;
+    slot.result = {};
+    lock.unlock();
+    m_work_available.notify_all();
+    return true;
+}
+
+void BatchParser::cancel() {
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        m_cancelled.store(true);
+    }
+    m_work_available.notify_all();
+    m_result_ready.notify_all();
+}
+
+Vector<BatchParser::Result> BatchParser::parse_files(Vector<String> paths, size_t thread_count) {
+    Vector<Result> results(paths.size());
+    BatchParser batch { paths, thread_count };
+    Result result;
+    while (batch.next(result))
+        results.push(result);
+    return results;
+}
+
+void BatchParser::work() {
+    for (;;) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock { m_mutex };
+            m_work_available.wait(lock, [this]() {
+                return m_cancelled.load() || m_next_claim >= m_slots.size() || m_next_claim < m_next_result + m_max_ahead;
+            });
+            if (m_cancelled.load() || m_next_claim >= m_slots.size())
+                return;
+            index = m_next_claim++;
+        }
+
+        // Nothing else touches this slot until it is marked ready, and by
+        // then every object this thread made for the parse (the Parser,
+        // its tokens) is gone, so the reference counts in the result are
+        // only ever touched by whoever calls next().
+        parse_file(m_slots[index].result);
+
+        {
+            std::lock_guard<std::mutex> lock { m_mutex };
+            m_slots[index].ready = true;
+        }
+        m_result_ready.notify_all();
+    }
+}
+
+void BatchParser::parse_file(Result &result) {
+    SharedPtr<String> code = new String;
+    FILE *fp = fopen(result.path.c_str(), "rb");
+    if (!fp) {
+        result.status = Result::Status::ReadError;
+        result.error_number = errno;
+        return;
+    }
+    char buf[16 * 1024];
+    size_t bytes;
+    while ((bytes = fread(buf, 1, sizeof(buf), fp)) > 0)
+        code->append(buf, bytes);
+    if (ferror(fp)) {
+        result.status = Result::Status::ReadError;
+        result.error_number = errno;
+        fclose(fp);
+        return;
+    }
+    fclose(fp);
+
+    try {
+        Parser parser { code, new String { result.path } };
+        parser.set_cancel_flag(&m_cancelled);
+        result.tree = parser.tree();
+        result.symbols = parser.symbols();
+    } catch (Parser::SyntaxError &error) {
+        result.status = Result::Status::SyntaxError;
+        result.error_message = error.message();
+    } catch (Lexer::Cancelled &) {
+        // nobody will see this result
+    }
+}
+
+}
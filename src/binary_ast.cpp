@@ -0,0 +1,585 @@
+#include "natalie_parser/binary_ast.hpp"
+#include "natalie_parser/creator/binary_creator.hpp"
+
+namespace NatalieParser {
+
+static constexpr char Magic[] = "NPAB";
+
+static void write_u16(String &buffer, uint16_t value) {
+    buffer.append_char(value & 0xff);
+    buffer.append_char(value >> 8);
+}
+
+static void write_u32(String &buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        buffer.append_char((value >> (i * 8)) & 0xff);
+}
+
+static void patch_u32(String &buffer, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        buffer[offset + i] = (value >> (i * 8)) & 0xff;
+}
+
+static size_t encode_varint(unsigned char *out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+static void write_varint(String &buffer, uint64_t value) {
+    unsigned char bytes[10];
+    auto length = encode_varint(bytes, value);
+    buffer.append(reinterpret_cast<const char *>(bytes), length);
+}
+
+static uint64_t zigzag(long long value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static long long unzigzag(uint64_t value) {
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+static uint16_t read_u16(const unsigned char *data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t read_u32(const unsigned char *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// Only for buffers that have been through BinaryAst::validate().
+static uint64_t read_varint(const unsigned char *data, size_t &offset) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        auto byte = data[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+static uint64_t read_checked_varint(const unsigned char *data, size_t &offset, size_t end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= end)
+            throw BinaryAst::FormatError { "binary AST is truncated" };
+        auto byte = data[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw BinaryAst::FormatError { "binary AST has a malformed number" };
+}
+
+uint32_t BinaryCreator::Output::string_number(const char *string, size_t length) {
+    auto id = strings.intern(string, length);
+    while (numbers.size() <= id)
+        numbers.push(0);
+    if (!numbers[id]) {
+        order.push(id);
+        numbers[id] = order.size();
+    }
+    return numbers[id];
+}
+
+String BinaryCreator::serialize(const Node &tree, uint16_t flags) {
+    Output output { flags };
+    output.buffer.append(Magic, 4);
+    write_u16(output.buffer, BinaryAst::Version);
+    write_u16(output.buffer, flags);
+    write_u32(output.buffer, 0); // file
+    write_u32(output.buffer, 0); // string table
+    write_u32(output.buffer, 0); // total size
+    assert(output.buffer.length() == BinaryAst::HeaderSize);
+
+    BinaryCreator creator { output, tree.line(), tree.column() };
+    tree.transform(&creator);
+    creator.finish();
+
+    auto file = tree.file();
+    if (file)
+        patch_u32(output.buffer, 8, output.string_number(file->c_str(), file->length()));
+
+    auto &buffer = output.buffer;
+    patch_u32(buffer, 12, buffer.length());
+    write_u32(buffer, output.order.size());
+    uint32_t offset = 0;
+    for (auto id : output.order) {
+        write_u32(buffer, offset);
+        offset += output.strings.string(id)->length();
+    }
+    write_u32(buffer, offset);
+    for (auto id : output.order) {
+        auto string = output.strings.string(id);
+        buffer.append(string->c_str(), string->length());
+    }
+    patch_u32(buffer, 16, buffer.length());
+    return buffer;
+}
+
+BinaryCreator::BinaryCreator(Output &output, size_t line, size_t column)
+    : m_output { output }
+    , m_start { output.buffer.length() }
+    , m_last_child { output.buffer.length() }
+    , m_sexp_line { line }
+    , m_sexp_column { column } {
+    set_line(line);
+    set_column(column);
+}
+
+void BinaryCreator::reset_sexp() {
+    m_output.buffer.truncate(m_start);
+    m_last_child = m_start;
+    m_type = 0;
+    m_comments = 0;
+    m_sexp_line = line();
+    m_sexp_column = column();
+}
+
+void BinaryCreator::set_comments(const TM::String &comments) {
+    if (m_output.flags & BinaryAst::Comments)
+        m_comments = m_output.string_number(comments.c_str(), comments.length());
+}
+
+void BinaryCreator::set_type(const char *type) {
+    m_type = m_output.string_number(type, strlen(type));
+}
+
+void BinaryCreator::append(const Node &node) {
+    if (node.type() == Node::Type::Nil) {
+        append_nil();
+        return;
+    }
+    start_child();
+    BinaryCreator creator { m_output, node.line(), node.column() };
+    creator.set_assignment(assignment());
+    node.transform(&creator);
+    creator.finish();
+}
+
+void BinaryCreator::append_array(const ArrayNode &array) {
+    start_child();
+    BinaryCreator creator { m_output, array.line(), array.column() };
+    creator.set_assignment(assignment());
+    array.ArrayNode::transform(&creator);
+    creator.finish();
+}
+
+void BinaryCreator::append_false() {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::False));
+}
+
+void BinaryCreator::append_bignum(TM::String &number) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Bignum));
+    write_varint(m_output.buffer, m_output.string_number(number.c_str(), number.length()));
+}
+
+void BinaryCreator::append_fixnum(long long number) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Fixnum));
+    write_varint(m_output.buffer, zigzag(number));
+}
+
+void BinaryCreator::append_float(double number) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Float));
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    write_u32(m_output.buffer, bits & 0xffffffff);
+    write_u32(m_output.buffer, bits >> 32);
+}
+
+void BinaryCreator::append_nil() {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Nil));
+}
+
+void BinaryCreator::append_range(long long first, long long last, bool exclude_end) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Range));
+    m_output.buffer.append_char(exclude_end ? 1 : 0);
+    write_varint(m_output.buffer, zigzag(first));
+    write_varint(m_output.buffer, zigzag(last));
+}
+
+void BinaryCreator::append_regexp(TM::String &pattern, int options) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Regexp));
+    write_varint(m_output.buffer, m_output.string_number(pattern.c_str(), pattern.length()));
+    write_varint(m_output.buffer, options);
+}
+
+void BinaryCreator::append_sexp(std::function<void(Creator *)> fn) {
+    start_child();
+    BinaryCreator creator { m_output, line(), column() };
+    fn(&creator);
+    creator.finish();
+}
+
+void BinaryCreator::append_string(TM::String &string) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::String));
+    write_varint(m_output.buffer, m_output.string_number(string.c_str(), string.length()));
+}
+
+void BinaryCreator::append_symbol(TM::String &name) {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::Symbol));
+    write_varint(m_output.buffer, m_output.string_number(name.c_str(), name.length()));
+}
+
+void BinaryCreator::append_true() {
+    start_child();
+    m_output.buffer.append_char(static_cast<char>(BinaryAst::Kind::True));
+}
+
+// The last child is always a number at the end of the buffer, so there
+// is only a byte or few to move.
+void BinaryCreator::make_complex_number() {
+    m_output.buffer.insert(m_last_child, static_cast<char>(BinaryAst::Kind::Complex));
+}
+
+void BinaryCreator::make_rational_number() {
+    m_output.buffer.insert(m_last_child, static_cast<char>(BinaryAst::Kind::Rational));
+}
+
+// What we have so far becomes the first child of a new Sexp.
+void BinaryCreator::wrap(const char *type) {
+    finish();
+    m_last_child = m_start;
+    m_comments = 0;
+    m_sexp_line = line();
+    m_sexp_column = column();
+    set_type(type);
+}
+
+void BinaryCreator::start_child() {
+    m_last_child = m_output.buffer.length();
+}
+
+// Slots the Sexp header in front of the children.
+void BinaryCreator::finish() {
+    unsigned char header[1 + 5 + 10 + 10 + 5 + 5];
+    size_t length = 0;
+    header[length++] = static_cast<unsigned char>(BinaryAst::Kind::Sexp);
+    length += encode_varint(header + length, m_type);
+    if (m_output.flags & BinaryAst::Locations) {
+        length += encode_varint(header + length, m_sexp_line);
+        length += encode_varint(header + length, m_sexp_column);
+    }
+    if (m_output.flags & BinaryAst::Comments)
+        length += encode_varint(header + length, m_comments);
+    auto children_size = m_output.buffer.length() - m_start;
+    length += encode_varint(header + length, children_size);
+
+    auto &buffer = m_output.buffer;
+    buffer.append(length, '\0');
+    auto data = &buffer[0];
+    memmove(data + m_start + length, data + m_start, children_size);
+    memcpy(data + m_start, header, length);
+}
+
+size_t BinaryAst::size_from_header(const char *data, size_t size) {
+    auto bytes = reinterpret_cast<const unsigned char *>(data);
+    if (size < HeaderSize || memcmp(data, Magic, 4) != 0 || read_u16(bytes + 4) != Version)
+        return 0;
+    auto total = read_u32(bytes + 16);
+    if (total < HeaderSize || total > size)
+        return 0;
+    return total;
+}
+
+BinaryAst::BinaryAst(const char *data, size_t size)
+    : m_data { reinterpret_cast<const unsigned char *>(data) }
+    , m_size { size } {
+    if (size < HeaderSize || memcmp(data, Magic, 4) != 0)
+        throw FormatError { "not a binary AST" };
+    if (read_u16(m_data + 4) != Version)
+        throw FormatError { "binary AST is from a different version" };
+    m_size = read_u32(m_data + 16);
+    if (m_size > size || m_size < HeaderSize)
+        throw FormatError { "binary AST is truncated" };
+    m_flags = read_u16(m_data + 6);
+    if (m_flags & ~(Locations | Comments))
+        throw FormatError { "binary AST has unknown flags" };
+    m_file = read_u32(m_data + 8);
+    m_strings_offset = read_u32(m_data + 12);
+    if (m_strings_offset <= HeaderSize || m_strings_offset > m_size || m_size - m_strings_offset < 8)
+        throw FormatError { "binary AST is truncated" };
+    m_string_count = read_u32(m_data + m_strings_offset);
+    if ((m_size - m_strings_offset - 4) / 4 < static_cast<size_t>(m_string_count) + 1)
+        throw FormatError { "binary AST is truncated" };
+    auto offsets = m_data + m_strings_offset + 4;
+    size_t bytes_size = m_size - (m_strings_offset + 4 + (m_string_count + 1) * 4);
+    for (uint32_t i = 0; i < m_string_count; i++) {
+        if (read_u32(offsets + i * 4) > read_u32(offsets + (i + 1) * 4))
+            throw FormatError { "binary AST has a malformed string table" };
+    }
+    if (read_u32(offsets + m_string_count * 4) > bytes_size)
+        throw FormatError { "binary AST is truncated" };
+    if (m_file > m_string_count)
+        throw FormatError { "binary AST refers to a missing string" };
+    validate();
+}
+
+BinaryAst::Slice BinaryAst::string(uint32_t number) const {
+    if (!number)
+        return {};
+    assert(number <= m_string_count);
+    auto offsets = m_data + m_strings_offset + 4;
+    auto bytes = reinterpret_cast<const char *>(offsets + (m_string_count + 1) * 4);
+    auto start = read_u32(offsets + (number - 1) * 4);
+    auto end = read_u32(offsets + number * 4);
+    return { bytes + start, end - start };
+}
+
+// Walks every value front to back (without recursion, as trees can be
+// deep), checking that each lies inside its parent.
+void BinaryAst::validate() const {
+    auto check_string = [&](uint64_t number, bool required) {
+        if (number > m_string_count || (required && !number))
+            throw FormatError { "binary AST refers to a missing string" };
+    };
+
+    if (m_data[HeaderSize] != static_cast<unsigned char>(Kind::Sexp))
+        throw FormatError { "binary AST does not start with a Sexp" };
+
+    Vector<size_t> ends {};
+    size_t offset = HeaderSize;
+    bool in_number = false; // after Complex or Rational
+    do {
+        while (!ends.is_empty() && offset == ends.last()) {
+            if (in_number)
+                throw FormatError { "binary AST is truncated" };
+            ends.pop();
+        }
+        if (ends.is_empty() && offset > HeaderSize)
+            break;
+        auto end = ends.is_empty() ? m_strings_offset : ends.last();
+        if (offset >= end)
+            throw FormatError { "binary AST is truncated" };
+        auto kind = static_cast<Kind>(m_data[offset++]);
+        if (in_number && kind != Kind::Fixnum && kind != Kind::Bignum && kind != Kind::Float && kind != Kind::Rational)
+            throw FormatError { "binary AST has a malformed number" };
+        in_number = false;
+        switch (kind) {
+        case Kind::Sexp: {
+            check_string(read_checked_varint(m_data, offset, end), false);
+            if (m_flags & Locations) {
+                read_checked_varint(m_data, offset, end);
+                read_checked_varint(m_data, offset, end);
+            }
+            if (m_flags & Comments)
+                check_string(read_checked_varint(m_data, offset, end), false);
+            auto size = read_checked_varint(m_data, offset, end);
+            if (size > end - offset)
+                throw FormatError { "binary AST is truncated" };
+            ends.push(offset + size);
+            break;
+        }
+        case Kind::Bignum:
+        case Kind::String:
+        case Kind::Symbol:
+            check_string(read_checked_varint(m_data, offset, end), true);
+            break;
+        case Kind::Complex:
+        case Kind::Rational:
+            in_number = true;
+            break;
+        case Kind::False:
+        case Kind::Nil:
+        case Kind::True:
+            break;
+        case Kind::Fixnum:
+            read_checked_varint(m_data, offset, end);
+            break;
+        case Kind::Float:
+            if (end - offset < 8)
+                throw FormatError { "binary AST is truncated" };
+            offset += 8;
+            break;
+        case Kind::Range:
+            if (offset >= end)
+                throw FormatError { "binary AST is truncated" };
+            offset++;
+            read_checked_varint(m_data, offset, end);
+            read_checked_varint(m_data, offset, end);
+            break;
+        case Kind::Regexp:
+            check_string(read_checked_varint(m_data, offset, end), true);
+            if (read_checked_varint(m_data, offset, end) > INT32_MAX)
+                throw FormatError { "binary AST has a malformed number" };
+            break;
+        default:
+            throw FormatError { "binary AST has an unknown kind of value" };
+        }
+    } while (!ends.is_empty() || in_number);
+    if (offset != m_strings_offset)
+        throw FormatError { "binary AST has extra bytes after the tree" };
+}
+
+BinaryAst::SexpHeader BinaryAst::sexp_header(size_t offset) const {
+    assert(m_data[offset] == static_cast<unsigned char>(Kind::Sexp));
+    offset++;
+    SexpHeader header {};
+    header.type = read_varint(m_data, offset);
+    if (m_flags & Locations) {
+        header.line = read_varint(m_data, offset);
+        header.column = read_varint(m_data, offset);
+    }
+    if (m_flags & Comments)
+        header.comments = read_varint(m_data, offset);
+    auto size = read_varint(m_data, offset);
+    header.children = offset;
+    header.end = offset + size;
+    return header;
+}
+
+// the offset just past the value at offset
+size_t BinaryAst::skip(size_t offset) const {
+    switch (static_cast<Kind>(m_data[offset])) {
+    case Kind::Sexp:
+        return sexp_header(offset).end;
+    case Kind::Bignum:
+    case Kind::Fixnum:
+    case Kind::String:
+    case Kind::Symbol:
+        offset++;
+        read_varint(m_data, offset);
+        return offset;
+    case Kind::Complex:
+    case Kind::Rational:
+        return skip(offset + 1);
+    case Kind::False:
+    case Kind::Nil:
+    case Kind::True:
+        return offset + 1;
+    case Kind::Float:
+        return offset + 9;
+    case Kind::Range:
+        offset += 2;
+        read_varint(m_data, offset);
+        read_varint(m_data, offset);
+        return offset;
+    case Kind::Regexp:
+        offset++;
+        read_varint(m_data, offset);
+        read_varint(m_data, offset);
+        return offset;
+    }
+    TM_UNREACHABLE();
+}
+
+uint32_t BinaryAst::Value::type_number() const {
+    return m_ast->sexp_header(m_offset).type;
+}
+
+size_t BinaryAst::Value::line() const {
+    return m_ast->sexp_header(m_offset).line;
+}
+
+size_t BinaryAst::Value::column() const {
+    return m_ast->sexp_header(m_offset).column;
+}
+
+uint32_t BinaryAst::Value::comments_number() const {
+    return m_ast->sexp_header(m_offset).comments;
+}
+
+size_t BinaryAst::Value::size() const {
+    size_t size = 0;
+    each_child([&](Value) { size++; });
+    return size;
+}
+
+long long BinaryAst::Value::fixnum() const {
+    assert(kind() == Kind::Fixnum || kind() == Kind::Range);
+    size_t offset = m_offset + (kind() == Kind::Range ? 2 : 1);
+    return unzigzag(read_varint(m_ast->m_data, offset));
+}
+
+long long BinaryAst::Value::range_last() const {
+    assert(kind() == Kind::Range);
+    size_t offset = m_offset + 2;
+    read_varint(m_ast->m_data, offset);
+    return unzigzag(read_varint(m_ast->m_data, offset));
+}
+
+bool BinaryAst::Value::range_excludes_end() const {
+    assert(kind() == Kind::Range);
+    return m_ast->m_data[m_offset + 1];
+}
+
+double BinaryAst::Value::float_value() const {
+    assert(kind() == Kind::Float);
+    uint64_t bits = read_u32(m_ast->m_data + m_offset + 1) | (static_cast<uint64_t>(read_u32(m_ast->m_data + m_offset + 5)) << 32);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint32_t BinaryAst::Value::string_number() const {
+    assert(kind() == Kind::Bignum || kind() == Kind::Regexp || kind() == Kind::String || kind() == Kind::Symbol);
+    size_t offset = m_offset + 1;
+    return read_varint(m_ast->m_data, offset);
+}
+
+int BinaryAst::Value::regexp_options() const {
+    assert(kind() == Kind::Regexp);
+    size_t offset = m_offset + 1;
+    read_varint(m_ast->m_data, offset);
+    return read_varint(m_ast->m_data, offset);
+}
+
+String BinaryAst::Value::to_string() const {
+    switch (kind()) {
+    case Kind::Sexp: {
+        Vector<String> parts {};
+        if (has_type())
+            parts.push(String::format(":{}", type().to_string()));
+        each_child([&](Value child) { parts.push(child.to_string()); });
+        String buf = "(";
+        for (size_t i = 0; i < parts.size(); ++i) {
+            buf.append(parts[i]);
+            if (i + 1 < parts.size())
+                buf.append(", ");
+        }
+        buf.append_char(')');
+        return buf;
+    }
+    case Kind::Bignum:
+        return string().to_string();
+    case Kind::Complex:
+        return String::format("Complex(0, {})", number().to_string());
+    case Kind::False:
+        return "false";
+    case Kind::Fixnum:
+        return String(fixnum());
+    case Kind::Float:
+        return String(float_value());
+    case Kind::Nil:
+        return "nil";
+    case Kind::Range:
+        return String::format("{}, {}, {}", String(range_first()), range_excludes_end() ? "..." : "..", String(range_last()));
+    case Kind::Rational:
+        return String::format("Rational({}, 1)", number().to_string());
+    case Kind::Regexp:
+        return String::format("/, {}, /", string().to_string());
+    case Kind::String:
+        return String::format("\"{}\"", string().to_string());
+    case Kind::Symbol:
+        return String::format(":{}", string().to_string());
+    case Kind::True:
+        return "true";
+    }
+    TM_UNREACHABLE();
+}
+
+}
@@ -0,0 +1,266 @@
+#include "natalie_parser/flat_ast.hpp"
+
+namespace NatalieParser {
+
+// Fills in one Sexp record of a FlatAst; nested nodes get their own
+// FlatCreator, the same way MRICreator and DebugCreator work.
+class FlatCreator : public Creator {
+public:
+    FlatCreator(FlatAst &ast, FlatAst::Index index, size_t line, size_t column)
+        : m_ast { ast }
+        , m_index { index } {
+        set_line(line);
+        set_column(column);
+    }
+
+    virtual ~FlatCreator() { }
+
+    virtual void set_comments(const TM::String &comments) override {
+        m_ast.set_comments(m_index, comments);
+    }
+
+    virtual void set_type(const char *type) override {
+        m_ast.m_records[m_index].value = m_ast.m_symbols->intern(type, strlen(type));
+    }
+
+    virtual void append(const Node &node) override {
+        if (node.type() == Node::Type::Nil) {
+            append_nil();
+            return;
+        }
+        auto index = add_child(FlatAst::Kind::Sexp, 0, node.line(), node.column());
+        FlatCreator creator { m_ast, index, node.line(), node.column() };
+        creator.set_assignment(assignment());
+        node.transform(&creator);
+    }
+
+    virtual void append_array(const ArrayNode &array) override {
+        auto index = add_child(FlatAst::Kind::Sexp, 0, array.line(), array.column());
+        FlatCreator creator { m_ast, index, array.line(), array.column() };
+        creator.set_assignment(assignment());
+        array.ArrayNode::transform(&creator);
+    }
+
+    virtual void append_false() override {
+        add_child(FlatAst::Kind::False);
+    }
+
+    virtual void append_bignum(TM::String &number) override {
+        add_child(FlatAst::Kind::Bignum, m_ast.m_strings.size());
+        m_ast.m_strings.push(number);
+    }
+
+    virtual void append_fixnum(long long number) override {
+        add_child(FlatAst::Kind::Fixnum, m_ast.m_fixnums.size());
+        m_ast.m_fixnums.push(number);
+    }
+
+    virtual void append_float(double number) override {
+        add_child(FlatAst::Kind::Float, m_ast.m_floats.size());
+        m_ast.m_floats.push(number);
+    }
+
+    virtual void append_nil() override {
+        add_child(FlatAst::Kind::Nil);
+    }
+
+    virtual void append_range(long long first, long long last, bool exclude_end) override {
+        auto range = add_child(FlatAst::Kind::Range);
+        m_ast.m_records[range].flags = exclude_end ? 1 : 0;
+        auto first_index = m_ast.add_record(FlatAst::Kind::Fixnum, m_ast.m_fixnums.size(), line(), column());
+        m_ast.m_fixnums.push(first);
+        auto last_index = m_ast.add_record(FlatAst::Kind::Fixnum, m_ast.m_fixnums.size(), line(), column());
+        m_ast.m_fixnums.push(last);
+        m_ast.m_records[range].first_child = first_index;
+        m_ast.m_records[first_index].next_sibling = last_index;
+    }
+
+    virtual void append_regexp(TM::String &pattern, int options) override {
+        auto index = add_child(FlatAst::Kind::Regexp, m_ast.m_strings.size());
+        m_ast.m_records[index].flags = options;
+        m_ast.m_strings.push(pattern);
+    }
+
+    virtual void append_sexp(std::function<void(Creator *)> fn) override {
+        auto index = add_child(FlatAst::Kind::Sexp);
+        FlatCreator creator { m_ast, index, line(), column() };
+        fn(&creator);
+    }
+
+    virtual void append_string(TM::String &string) override {
+        add_child(FlatAst::Kind::String, m_ast.m_strings.size());
+        m_ast.m_strings.push(string);
+    }
+
+    virtual void append_symbol(TM::String &name) override {
+        add_child(FlatAst::Kind::Symbol, m_ast.m_symbols->intern(name));
+    }
+
+    virtual void append_true() override {
+        add_child(FlatAst::Kind::True);
+    }
+
+    virtual void make_complex_number() override {
+        wrap_last_child(FlatAst::Kind::Complex);
+    }
+
+    virtual void make_rational_number() override {
+        wrap_last_child(FlatAst::Kind::Rational);
+    }
+
+    virtual void wrap(const char *type) override {
+        // move what we have built so far down into a new record...
+        auto inner = m_ast.add_record(FlatAst::Kind::Sexp, 0, line(), column());
+        auto &record = m_ast.m_records[m_index];
+        m_ast.m_records[inner] = record;
+        m_ast.m_records[inner].next_sibling = FlatAst::None;
+        m_ast.move_comments(m_index, inner);
+
+        // ...and make this record its parent
+        record.value = 0;
+        record.first_child = inner;
+        m_last_child = inner;
+        set_type(type);
+    }
+
+private:
+    FlatAst::Index add_child(FlatAst::Kind kind, uint32_t value = 0) {
+        return add_child(kind, value, line(), column());
+    }
+
+    FlatAst::Index add_child(FlatAst::Kind kind, uint32_t value, size_t line, size_t column) {
+        auto index = m_ast.add_record(kind, value, line, column);
+        if (m_last_child == FlatAst::None)
+            m_ast.m_records[m_index].first_child = index;
+        else
+            m_ast.m_records[m_last_child].next_sibling = index;
+        m_last_child = index;
+        return index;
+    }
+
+    void wrap_last_child(FlatAst::Kind kind) {
+        assert(m_last_child != FlatAst::None);
+        auto inner = m_ast.add_record(kind, 0, line(), column());
+        auto &record = m_ast.m_records[m_last_child];
+        m_ast.m_records[inner] = record;
+        m_ast.m_records[inner].next_sibling = FlatAst::None;
+        record.kind = kind;
+        record.value = 0;
+        record.flags = 0;
+        record.first_child = inner;
+    }
+
+    FlatAst &m_ast;
+    FlatAst::Index m_index;
+    FlatAst::Index m_last_child { FlatAst::None };
+};
+
+FlatAst::FlatAst(const Node &tree, SharedPtr<SymbolTable> symbols)
+    : m_symbols { symbols } {
+    auto index = add_record(Kind::Sexp, 0, tree.line(), tree.column());
+    FlatCreator creator { *this, index, tree.line(), tree.column() };
+    tree.transform(&creator);
+}
+
+FlatAst::Index FlatAst::add_record(Kind kind, uint32_t value, size_t line, size_t column) {
+    Index index = m_records.size();
+    m_records.push(Record { kind, 0, value, static_cast<uint32_t>(line), static_cast<uint32_t>(column), None, None });
+    return index;
+}
+
+const String *FlatAst::symbol(const Record &record) const {
+    assert(record.kind == Kind::Sexp || record.kind == Kind::Symbol);
+    if (!record.value)
+        return nullptr;
+    return m_symbols->string(record.value).ptr();
+}
+
+const String *FlatAst::comments(Index index) const {
+    auto position = find_comment(index);
+    if (position < m_comments.size() && m_comments[position].record == index)
+        return &m_comments[position].text;
+    return nullptr;
+}
+
+// Records get their comments in roughly increasing order, so this is
+// nearly always a push.
+void FlatAst::set_comments(Index index, const String &comments) {
+    auto position = find_comment(index);
+    if (position < m_comments.size() && m_comments[position].record == index)
+        m_comments[position].text = comments;
+    else
+        m_comments.insert(position, Comment { index, comments });
+}
+
+void FlatAst::move_comments(Index from, Index to) {
+    auto position = find_comment(from);
+    if (position == m_comments.size() || m_comments[position].record != from)
+        return;
+    auto text = m_comments[position].text;
+    m_comments.remove(position);
+    set_comments(to, text);
+}
+
+// the position of the first comment for index or a later record
+size_t FlatAst::find_comment(Index index) const {
+    size_t low = 0;
+    size_t high = m_comments.size();
+    while (low < high) {
+        auto middle = low + (high - low) / 2;
+        if (m_comments[middle].record < index)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+String FlatAst::to_string(Index index) const {
+    auto &record = m_records[index];
+    switch (record.kind) {
+    case Kind::Sexp: {
+        Vector<String> parts {};
+        if (record.value)
+            parts.push(String::format(":{}", *symbol(record)));
+        each_child(index, [&](Index child) { parts.push(to_string(child)); });
+        String buf = "(";
+        for (size_t i = 0; i < parts.size(); ++i) {
+            buf.append(parts[i]);
+            if (i + 1 < parts.size())
+                buf.append(", ");
+        }
+        buf.append_char(')');
+        return buf;
+    }
+    case Kind::Bignum:
+        return string(record);
+    case Kind::Complex:
+        return String::format("Complex(0, {})", to_string(record.first_child));
+    case Kind::False:
+        return "false";
+    case Kind::Fixnum:
+        return String(fixnum(record));
+    case Kind::Float:
+        return String(float_value(record));
+    case Kind::Nil:
+        return "nil";
+    case Kind::Range: {
+        auto &first = m_records[record.first_child];
+        auto &last = m_records[first.next_sibling];
+        return String::format("{}, {}, {}", String(fixnum(first)), record.flags ? "..." : "..", String(fixnum(last)));
+    }
+    case Kind::Rational:
+        return String::format("Rational({}, 1)", to_string(record.first_child));
+    case Kind::Regexp:
+        return String::format("/, {}, /", string(record));
+    case Kind::String:
+        return String::format("\"{}\"", string(record));
+    case Kind::Symbol:
+        return String::format(":{}", *symbol(record));
+    case Kind::True:
+        return "true";
+    }
+    TM_UNREACHABLE();
+}
+
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <string.h>
+
+#include "natalie_parser/incremental_parser.hpp"
+#include "natalie_parser/lexer/char_class.hpp"
+
+namespace NatalieParser {
+
+IncrementalParser::IncrementalParser(SharedPtr<String> code, SharedPtr<String> file)
+    : m_code { code }
+    , m_file { file }
+    , m_line_index { new LineIndex { *code } } {
+    parse_all();
+}
+
+Tree IncrementalParser::edit(size_t offset, size_t removed_length, const String &inserted) {
+    assert(offset + removed_length <= m_code->length());
+    SharedPtr<String> code = new String { m_code->c_str(), offset };
+    code->append(inserted);
+    code->append(m_code->c_str() + offset + removed_length, m_code->length() - offset - removed_length);
+    m_code = code;
+    m_line_index = new LineIndex { *code };
+
+    // Grow the damaged region (the part that differs from the last
+    // successful parse) to cover this edit.
+    auto inserted_end = offset + inserted.length();
+    if (m_damaged) {
+        auto end = std::max(m_damage_new_end, offset + removed_length);
+        m_damage_old_end = end - m_damage_new_end + m_damage_old_end;
+        if (m_damage_new_end <= offset)
+            m_damage_new_end = std::max(m_damage_new_end, inserted_end);
+        else if (m_damage_new_end >= offset + removed_length)
+            m_damage_new_end = std::max(m_damage_new_end - removed_length + inserted.length(), inserted_end);
+        else
+            m_damage_new_end = inserted_end;
+        m_damage_start = std::min(m_damage_start, offset);
+    } else {
+        m_damaged = true;
+        m_damage_start = offset;
+        m_damage_old_end = offset + removed_length;
+        m_damage_new_end = inserted_end;
+    }
+
+    reparse_damage();
+    m_damaged = false;
+    return m_tree;
+}
+
+// Parses the damaged region again, along with as few statements around it
+// as possible, then stitches the result together with the statements from
+// the last successful parse before and after it.
+void IncrementalParser::reparse_damage() {
+    auto same_lines = m_line_index->line_count() == m_base_line_count;
+    long long delta = (long long)m_damage_new_end - (long long)m_damage_old_end;
+
+    // Restart at the last statement that begins a line before the damage.
+    // Everything up to there is unchanged.
+    size_t restart = find_statement(m_damage_start);
+    while (restart > 0 && (m_statements[restart].offset >= m_damage_start || !is_restart_point(m_statements[restart].offset)))
+        restart--;
+    size_t start = 0;
+    Vector<SharedPtr<String>> locals {};
+    if (restart > 0) {
+        start = m_line_index->line_start(m_line_index->line(m_statements[restart].offset));
+        for (size_t i = 0; i < restart; i++) {
+            for (auto &name : m_statements[i].new_locals)
+                locals.push(name);
+        }
+    }
+
+    // Stop once we reach an old statement on a line that starts past the
+    // damage, if its line and column haven't moved and the same locals are
+    // assigned before it. (A line starting right where the damage ends may
+    // have lost or gained indentation, which would move the column.)
+    bool resumed = false;
+    size_t resume = 0;
+    auto should_stop = [&](size_t new_offset, const Vector<Parser::Statement> &parsed) {
+        if (!same_lines || new_offset < m_damage_new_end)
+            return false;
+        if (m_line_index->line_start(m_line_index->line(new_offset)) <= m_damage_new_end || !is_restart_point(new_offset))
+            return false;
+        auto old_offset = new_offset - delta;
+        auto old_index = find_statement(old_offset);
+        if (old_index >= m_statements.size() || old_index < restart || m_statements[old_index].offset != old_offset)
+            return false;
+        // The comment it took its doc from may have been edited away.
+        auto &old_statement = m_statements[old_index];
+        if (old_statement.token.doc() || old_statement.node->doc())
+            return false;
+        Vector<SharedPtr<String>> new_locals {};
+        for (auto &statement : parsed) {
+            for (auto &name : statement.new_locals)
+                new_locals.push(name);
+        }
+        size_t index = 0;
+        for (size_t i = restart; i < old_index; i++) {
+            for (auto &name : m_statements[i].new_locals) {
+                if (index >= new_locals.size() || !(*new_locals[index] == *name))
+                    return false;
+                index++;
+            }
+        }
+        if (index != new_locals.size())
+            return false;
+        resumed = true;
+        resume = old_index;
+        return true;
+    };
+
+    auto parsed = Parser { m_code, m_file }.parse_statements(start, locals, should_stop);
+
+    Vector<Parser::Statement> statements {};
+    for (size_t i = 0; i < restart; i++)
+        statements.push(m_statements[i]);
+    for (auto &statement : parsed)
+        statements.push(statement);
+    if (resumed) {
+        for (size_t i = resume; i < m_statements.size(); i++) {
+            auto statement = m_statements[i];
+            statement.offset += delta;
+            statements.push(statement);
+        }
+    }
+    // Each reused statement keeps the Arena of the parse it came from
+    // alive, along with the copy of the code it was parsed from. Parse
+    // everything again once they hold on to too many of them.
+    Vector<Arena *> arenas {};
+    for (auto &statement : statements) {
+        auto arena = statement.arena.ptr();
+        bool seen = false;
+        for (auto other : arenas)
+            seen = seen || other == arena;
+        if (seen)
+            continue;
+        if (arenas.size() == MAX_ARENAS) {
+            parse_all();
+            return;
+        }
+        arenas.push(arena);
+    }
+
+    m_statements = statements;
+    m_base_line_count = m_line_index->line_count();
+    m_reparsed_count = parsed.size();
+    build_tree();
+}
+
+void IncrementalParser::parse_all() {
+    m_statements = Parser { m_code, m_file }.parse_statements(0, {}, [](size_t, const Vector<Parser::Statement> &) { return false; });
+    m_base_line_count = m_line_index->line_count();
+    m_reparsed_count = m_statements.size();
+    build_tree();
+}
+
+// the same shape of tree as Parser::tree()
+void IncrementalParser::build_tree() {
+    if (m_statements.is_empty()) {
+        m_tree = Parser { m_code, m_file }.tree();
+        return;
+    }
+    if (m_statements.size() == 1) {
+        m_tree = Tree { m_statements.first().node, m_statements.first().arena };
+        return;
+    }
+    // The block goes in an Arena of its own, which keeps the statements'
+    // arenas alive.
+    Arena::Ref arena { new Arena };
+    Arena *kept = nullptr;
+    for (auto &statement : m_statements) {
+        if (statement.arena.ptr() != kept) {
+            arena->keep(statement.arena);
+            kept = statement.arena.ptr();
+        }
+    }
+    Arena::Scope arena_scope { *arena };
+    NodePtr<BlockNode> block = new BlockNode { m_statements.first().token };
+    for (auto &statement : m_statements)
+        block->add_node(statement.node);
+    m_tree = Tree { block, arena };
+}
+
+// A statement that starts its line can be lexed from the start of the line
+// with a fresh lexer, unless a comment above it would have been attached to
+// it as documentation.
+bool IncrementalParser::is_restart_point(size_t offset) const {
+    auto str = m_code->c_str();
+    auto line = m_line_index->line(offset);
+    for (auto i = m_line_index->line_start(line); i < offset; i++) {
+        if (str[i] != ' ' && str[i] != '\t')
+            return false;
+    }
+    while (line > 0) {
+        line--;
+        auto i = m_line_index->line_start(line);
+        auto end = m_line_index->line_end(line);
+        while (i < end && is_space_char(str[i]))
+            i++;
+        if (i == end)
+            continue;
+        return str[i] != '#' && strncmp(str + i, "=end", 4) != 0;
+    }
+    return true;
+}
+
+// index of the last statement starting at or before offset (or 0)
+size_t IncrementalParser::find_statement(size_t offset) const {
+    size_t low = 0;
+    size_t high = m_statements.size();
+    while (high - low > 1) {
+        auto middle = low + (high - low) / 2;
+        if (m_statements[middle].offset <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+}
@@ -1,8 +1,14 @@
-#include <errno.h>
 #include <limits>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
 
 #include "natalie_parser/lexer.hpp"
+#include "natalie_parser/lexer/char_class.hpp"
 #include "natalie_parser/lexer/interpolated_string_lexer.hpp"
 #include "natalie_parser/lexer/regexp_lexer.hpp"
 #include "natalie_parser/lexer/word_array_lexer.hpp"
@@ -12,74 +18,276 @@ namespace NatalieParser {
 
 SharedPtr<Vector<Token>> Lexer::tokens() {
     SharedPtr<Vector<Token>> tokens = new Vector<Token> {};
-    bool skip_next_newline = false;
-    Token last_doc_token;
     for (;;) {
+        auto token = next_significant_token();
+        tokens->push(token);
+        if (token.is_eof() || !token.is_valid())
+            return tokens;
+    }
+    TM_UNREACHABLE();
+}
+
+Token Lexer::next_significant_token() {
+    // hand out newlines we were holding back, followed by the token that ended them
+    if (m_pending_index < m_pending_tokens.size()) {
+        auto token = m_pending_tokens[m_pending_index++];
+        if (m_pending_index == m_pending_tokens.size()) {
+            m_pending_tokens.clear();
+            m_pending_index = 0;
+        }
+        return token;
+    }
+
+    for (;;) {
+        if (m_cancel_flag && m_cancel_flag->load(std::memory_order_relaxed))
+            throw Cancelled {};
         auto token = next_token();
         if (token.is_comment())
             continue;
 
         if (token.is_doc()) {
-            if (last_doc_token)
-                last_doc_token.literal_string()->append(*token.literal_string());
-            else
-                last_doc_token = token;
+            if (m_last_doc_token) {
+                // a saved state may share the old doc string, so make a new one
+                SharedPtr<String> doc = new String { *m_last_doc_token.literal_string() };
+                doc->append(*token.literal_string());
+                m_last_doc_token.set_literal(doc);
+            } else
+                m_last_doc_token = token;
             continue;
         }
 
         // get rid of newlines after certain tokens
-        if (skip_next_newline) {
+        if (m_skip_next_newline) {
             if (token.is_newline())
                 continue;
             else
-                skip_next_newline = false;
+                m_skip_next_newline = false;
         }
 
         // get rid of newlines before certain tokens
-        while (token.can_follow_collapsible_newline() && !tokens->is_empty() && tokens->last().is_newline())
-            tokens->pop();
+        if (token.can_follow_collapsible_newline())
+            m_pending_tokens.clear();
 
-        if (last_doc_token) {
+        if (m_last_doc_token) {
             if (token.can_have_doc()) {
-                token.set_doc(last_doc_token.literal_string());
-                last_doc_token = {};
+                token.set_doc(m_last_doc_token.literal_string());
+                m_last_doc_token = {};
             } else if (!token.is_end_of_line()) {
-                last_doc_token = {};
+                m_last_doc_token = {};
             }
         }
 
-        tokens->push(token);
-
         m_last_token = token;
 
-        if (token.is_eof())
-            return tokens;
-        if (!token.is_valid())
-            return tokens;
+        // We can't know if a newline survives until we see the next real token,
+        // so hold on to it until then.
+        if (token.is_newline()) {
+            m_pending_tokens.push(token);
+            continue;
+        }
+
         if (token.can_precede_collapsible_newline())
-            skip_next_newline = true;
+            m_skip_next_newline = true;
+
+        if (m_pending_tokens.is_empty())
+            return token;
+
+        m_pending_tokens.push(token);
+        m_pending_index = 1;
+        return m_pending_tokens.first();
     };
     TM_UNREACHABLE();
 }
 
+void Lexer::release_nested_lexer() {
+    if (!m_nested_lexer)
+        return;
+    m_nested_lexer->release_nested_lexer();
+    if (m_pool) {
+        // a pooled lexer must not keep the pool alive
+        m_nested_lexer->m_pool = SharedPtr<LexerPool> {};
+        m_pool->release(m_nested_lexer);
+    } else {
+        delete m_nested_lexer;
+    }
+    m_nested_lexer = nullptr;
+}
+
+void Lexer::reset(const Lexer &other) {
+    reset(other, other.m_start_char, other.m_stop_char);
+    for (auto index : other.m_heredoc_stack)
+        m_heredoc_stack.push(index);
+    m_whitespace_precedes = other.m_whitespace_precedes;
+    m_last_token = other.m_last_token;
+    m_open_ternary = other.m_open_ternary;
+    m_cancel_flag = other.m_cancel_flag;
+    m_pair_depth = other.m_pair_depth;
+    m_skip_next_newline = other.m_skip_next_newline;
+    m_last_doc_token = other.m_last_doc_token;
+    for (auto &token : other.m_pending_tokens)
+        m_pending_tokens.push(token);
+    m_pending_index = other.m_pending_index;
+    m_remaining_method_names = other.m_remaining_method_names;
+    m_allow_assignment_method = other.m_allow_assignment_method;
+    m_method_name_separator = other.m_method_name_separator;
+    m_last_method_name = other.m_last_method_name;
+}
+
+void Lexer::reset(const Lexer &other, char start_char, char stop_char) {
+    m_source = other.m_source;
+    m_state_source = {};
+    m_input = other.m_input;
+    m_file = other.m_file;
+    m_symbols = other.m_symbols;
+    m_line_index = other.m_line_index;
+    m_size = other.m_size;
+    m_index = other.m_index;
+    m_first_line = other.m_first_line;
+    m_token_index = other.m_token_index;
+    clear_state();
+    m_keep_doc_comments = other.m_keep_doc_comments;
+    m_stop_char = stop_char;
+    m_start_char = start_char;
+}
+
+void Lexer::reset(const Lexer &parent, SharedPtr<String> input) {
+    m_source = parent.m_source;
+    m_state_source = {};
+    m_input = input;
+    m_file = parent.m_file;
+    m_symbols = parent.m_symbols;
+    m_line_index = new LineIndex { *input };
+    m_size = input->length();
+    m_index = 0;
+    m_first_line = 0;
+    m_token_index = 0;
+    clear_state();
+}
+
+LexerState Lexer::state() const {
+    LexerState state;
+    save_state(state, nullptr);
+    return state;
+}
+
+void Lexer::restore(const LexerState &state) {
+    assert(state.kind == kind());
+    restore_state(state);
+}
+
+void Lexer::save_state(LexerState &state, const Lexer *parent) const {
+    state.kind = kind();
+    state.source = m_state_source ? m_state_source : m_source;
+    state.index = m_index;
+    if (parent && m_input != parent->m_input)
+        state.input = m_input;
+    state.first_line = m_first_line;
+    state.token_index = m_token_index;
+    state.heredoc_stack = m_heredoc_stack;
+    state.whitespace_precedes = m_whitespace_precedes;
+    state.last_token = m_last_token;
+    state.open_ternary = m_open_ternary;
+    state.stop_char = m_stop_char;
+    state.start_char = m_start_char;
+    state.pair_depth = m_pair_depth;
+    state.skip_next_newline = m_skip_next_newline;
+    state.last_doc_token = m_last_doc_token;
+    state.pending_tokens = m_pending_tokens;
+    state.pending_index = m_pending_index;
+    state.remaining_method_names = m_remaining_method_names;
+    state.allow_assignment_method = m_allow_assignment_method;
+    state.method_name_separator = m_method_name_separator;
+    state.last_method_name = m_last_method_name;
+    if (m_nested_lexer) {
+        state.nested = new LexerState;
+        m_nested_lexer->save_state(*state.nested, this);
+    }
+}
+
+void Lexer::restore_state(const LexerState &state) {
+    release_nested_lexer();
+    m_state_source = state.source.ptr() != m_source.ptr() ? state.source : Source::Ref {};
+    m_index = state.index;
+    m_first_line = state.first_line;
+    m_token_index = state.token_index;
+    m_heredoc_stack = state.heredoc_stack;
+    m_whitespace_precedes = state.whitespace_precedes;
+    m_last_token = state.last_token;
+    m_open_ternary = state.open_ternary;
+    m_stop_char = state.stop_char;
+    m_start_char = state.start_char;
+    m_pair_depth = state.pair_depth;
+    m_skip_next_newline = state.skip_next_newline;
+    m_last_doc_token = state.last_doc_token;
+    m_pending_tokens = state.pending_tokens;
+    m_pending_index = state.pending_index;
+    m_remaining_method_names = state.remaining_method_names;
+    m_allow_assignment_method = state.allow_assignment_method;
+    m_method_name_separator = state.method_name_separator;
+    m_last_method_name = state.last_method_name;
+    if (!state.nested)
+        return;
+
+    // The constructor arguments don't matter; restore_state() overwrites
+    // everything they set.
+    auto &nested = *state.nested;
+    switch (nested.kind) {
+    case LexerKind::Plain:
+        start_nested_lexer<Lexer>(*this);
+        break;
+    case LexerKind::InterpolatedString:
+        start_nested_lexer<InterpolatedStringLexer>(*this, nested.start_char, nested.stop_char, nested.end_type);
+        break;
+    case LexerKind::Regexp:
+        start_nested_lexer<RegexpLexer>(*this, nested.start_char, nested.stop_char);
+        break;
+    case LexerKind::WordArray:
+        start_nested_lexer<WordArrayLexer>(*this, nested.array_start_char, nested.stop_char, nested.interpolated);
+        break;
+    }
+    if (nested.input) {
+        m_nested_lexer->m_input = nested.input;
+        m_nested_lexer->m_line_index = new LineIndex { *nested.input };
+        m_nested_lexer->m_size = nested.input->length();
+    }
+    m_nested_lexer->restore_state(nested);
+}
+
+// everything but the input and position goes back to its initial value
+void Lexer::clear_state() {
+    m_heredoc_stack.clear();
+    m_whitespace_precedes = false;
+    m_last_token = {};
+    m_open_ternary = false;
+    m_nested_lexer = nullptr;
+    m_cancel_flag = nullptr;
+    m_stop_char = 0;
+    m_start_char = 0;
+    m_pair_depth = 0;
+    m_skip_next_newline = false;
+    m_last_doc_token = {};
+    m_pending_tokens.clear();
+    m_pending_index = 0;
+    m_remaining_method_names = 0;
+    m_allow_assignment_method = false;
+    m_method_name_separator = Token::Type::Invalid;
+    m_last_method_name = {};
+}
+
 Token Lexer::next_token() {
     if (m_nested_lexer) {
         auto token = m_nested_lexer->next_token();
         if (token.is_eof()) {
             if (m_nested_lexer->alters_parent_cursor_position()) {
                 m_index = m_nested_lexer->m_index;
-                m_cursor_line = m_nested_lexer->m_cursor_line;
-                m_cursor_column = m_nested_lexer->m_cursor_column;
             }
-            delete m_nested_lexer;
-            m_nested_lexer = nullptr;
+            release_nested_lexer();
         } else {
             return token;
         }
     }
     m_whitespace_precedes = skip_whitespace();
-    m_token_line = m_cursor_line;
-    m_token_column = m_cursor_column;
+    m_token_index = m_index;
     Token token = build_next_token();
     switch (token.type()) {
     case Token::Type::AliasKeyword:
@@ -118,23 +326,125 @@ Token Lexer::next_token() {
     return token;
 }
 
-bool is_name_start_char(char c) {
-    if (!c) return false;
-    return (c >= 'a' && c <= 'z') || c == '_' || (unsigned int)c >= 128;
+struct Keyword {
+    constexpr Keyword(const char *name, Token::Type type)
+        : name { name }
+        , length { std::char_traits<char>::length(name) }
+        , type { type } { }
+
+    const char *name;
+    size_t length;
+    Token::Type type;
+};
+
+constexpr Keyword keywords[] = {
+    { "__ENCODING__", Token::Type::ENCODINGKeyword },
+    { "__LINE__", Token::Type::LINEKeyword },
+    { "__FILE__", Token::Type::FILEKeyword },
+    { "BEGIN", Token::Type::BEGINKeyword },
+    { "END", Token::Type::ENDKeyword },
+    { "alias", Token::Type::AliasKeyword },
+    { "and", Token::Type::AndKeyword },
+    { "begin", Token::Type::BeginKeyword },
+    { "break", Token::Type::BreakKeyword },
+    { "case", Token::Type::CaseKeyword },
+    { "class", Token::Type::ClassKeyword },
+    { "defined?", Token::Type::DefinedKeyword },
+    { "def", Token::Type::DefKeyword },
+    { "do", Token::Type::DoKeyword },
+    { "else", Token::Type::ElseKeyword },
+    { "elsif", Token::Type::ElsifKeyword },
+    { "end", Token::Type::EndKeyword },
+    { "ensure", Token::Type::EnsureKeyword },
+    { "false", Token::Type::FalseKeyword },
+    { "for", Token::Type::ForKeyword },
+    { "if", Token::Type::IfKeyword },
+    { "in", Token::Type::InKeyword },
+    { "module", Token::Type::ModuleKeyword },
+    { "next", Token::Type::NextKeyword },
+    { "nil", Token::Type::NilKeyword },
+    { "not", Token::Type::NotKeyword },
+    { "or", Token::Type::OrKeyword },
+    { "redo", Token::Type::RedoKeyword },
+    { "rescue", Token::Type::RescueKeyword },
+    { "retry", Token::Type::RetryKeyword },
+    { "return", Token::Type::ReturnKeyword },
+    { "self", Token::Type::SelfKeyword },
+    { "super", Token::Type::SuperKeyword },
+    { "then", Token::Type::ThenKeyword },
+    { "true", Token::Type::TrueKeyword },
+    { "undef", Token::Type::UndefKeyword },
+    { "unless", Token::Type::UnlessKeyword },
+    { "until", Token::Type::UntilKeyword },
+    { "when", Token::Type::WhenKeyword },
+    { "while", Token::Type::WhileKeyword },
+    { "yield", Token::Type::YieldKeyword },
+};
+
+constexpr size_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+constexpr size_t keyword_min_length = 2;
+constexpr size_t keyword_max_length = 12;
+
+// The hash only looks at the first, middle and last bytes plus the length,
+// which is enough to tell all of the keywords apart. The multiplier is found
+// at compile time so that no two keywords land in the same slot.
+constexpr size_t keyword_table_bits = 7;
+constexpr size_t keyword_table_size = 1 << keyword_table_bits;
+
+constexpr size_t keyword_hash(const char *word, size_t length, uint32_t seed) {
+    uint32_t key = ((uint32_t)(unsigned char)word[0] << 24)
+        | ((uint32_t)(unsigned char)word[length / 2] << 16)
+        | ((uint32_t)(unsigned char)word[length - 1] << 8)
+        | (uint32_t)length;
+    return (uint32_t)(key * seed) >> (32 - keyword_table_bits);
 }
 
-bool is_identifier_char(char c) {
-    if (!c) return false;
-    return isalnum(c) || c == '_' || (unsigned int)c >= 128;
+constexpr bool keyword_hash_is_perfect(uint32_t seed) {
+    bool used[keyword_table_size] {};
+    for (size_t i = 0; i < keyword_count; i++) {
+        auto slot = keyword_hash(keywords[i].name, keywords[i].length, seed);
+        if (used[slot])
+            return false;
+        used[slot] = true;
+    }
+    return true;
 }
 
-bool is_message_suffix(char c) {
-    if (!c) return false;
-    return c == '?' || c == '!';
+constexpr uint32_t find_keyword_hash_seed() {
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        if (keyword_hash_is_perfect(seed))
+            return seed;
+    }
+    return 0;
 }
 
-bool is_identifier_char_or_message_suffix(char c) {
-    return is_identifier_char(c) || is_message_suffix(c);
+constexpr uint32_t keyword_hash_seed = find_keyword_hash_seed();
+static_assert(keyword_hash_seed != 0, "could not find a perfect hash for the keyword table");
+
+struct KeywordTable {
+    constexpr KeywordTable()
+        : slots {} {
+        for (size_t i = 0; i < keyword_table_size; i++)
+            slots[i] = -1;
+        for (size_t i = 0; i < keyword_count; i++)
+            slots[keyword_hash(keywords[i].name, keywords[i].length, keyword_hash_seed)] = i;
+    }
+
+    int8_t slots[keyword_table_size];
+};
+
+constexpr KeywordTable keyword_table {};
+
+Token::Type keyword_type(const char *word, size_t length) {
+    if (length < keyword_min_length || length > keyword_max_length)
+        return Token::Type::Invalid;
+    auto index = keyword_table.slots[keyword_hash(word, length, keyword_hash_seed)];
+    if (index == -1)
+        return Token::Type::Invalid;
+    auto &keyword = keywords[index];
+    if (keyword.length != length || memcmp(keyword.name, word, length) != 0)
+        return Token::Type::Invalid;
+    return keyword.type;
 }
 
 bool Lexer::match(size_t bytes, const char *compare) {
@@ -149,28 +459,25 @@ bool Lexer::match(size_t bytes, const char *compare) {
     return false;
 }
 
-void Lexer::advance() {
-    auto c = current_char();
-    m_index++;
-    if (c == '\n') {
-        m_cursor_line++;
-        m_cursor_column = 0;
-    } else {
-        m_cursor_column++;
-    }
-}
-
-void Lexer::advance(size_t bytes) {
-    for (size_t i = 0; i < bytes; i++) {
-        advance();
+// Scans the word at the cursor once and looks it up in the keyword table.
+// Like match(), a keyword only counts if it is not followed by more
+// identifier characters (or a '?'/'!' suffix).
+Token::Type Lexer::match_keyword() {
+    const char *word = m_input->c_str() + m_index;
+    size_t available = m_size - m_index;
+    size_t length = 0;
+    while (length < available && is_identifier_char(word[length]))
+        length++;
+    if (length < available && is_message_suffix(word[length])) {
+        // defined? is the only keyword that ends with a suffix
+        length++;
+        if (length < available && is_identifier_char_or_message_suffix(word[length]))
+            return Token::Type::Invalid;
     }
-}
-
-// NOTE: this does not work across lines
-void Lexer::rewind(size_t bytes) {
-    current_char();
-    m_cursor_column -= bytes;
-    m_index -= bytes;
+    auto type = keyword_type(word, length);
+    if (type != Token::Type::Invalid)
+        advance(length);
+    return type;
 }
 
 bool Lexer::skip_whitespace() {
@@ -187,12 +494,12 @@ bool Lexer::skip_whitespace() {
 
 Token Lexer::build_next_token() {
     if (m_index >= m_size)
-        return Token { Token::Type::Eof, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::Eof);
     if (m_start_char && current_char() == m_start_char) {
         m_pair_depth++;
     } else if (m_stop_char && current_char() == m_stop_char) {
         if (m_pair_depth == 0)
-            return Token { Token::Type::Eof, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+            return make_token_at(m_index, Token::Type::Eof);
         m_pair_depth--;
     } else if (m_index == 0 && current_char() == '\xEF') {
         // UTF-8 BOM
@@ -210,30 +517,33 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '=': {
                 advance();
-                return Token { Token::Type::EqualEqualEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::EqualEqualEqual);
             }
             default:
-                return Token { Token::Type::EqualEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::EqualEqual);
             }
         }
         case '>':
             advance();
-            return Token { Token::Type::HashRocket, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::HashRocket);
         case '~':
             advance();
-            return Token { Token::Type::Match, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Match);
         default:
-            if (m_cursor_column == 1 && match(5, "begin")) {
-                SharedPtr<String> doc = new String("=begin");
+            if (cursor_column() == 1 && match(5, "begin")) {
+                SharedPtr<String> doc = m_keep_doc_comments ? new String("=begin") : nullptr;
                 char c = current_char();
                 do {
-                    doc->append_char(c);
+                    if (doc)
+                        doc->append_char(c);
                     c = next();
-                } while (c && !(m_cursor_column == 0 && match(4, "=end")));
+                } while (c && !(cursor_column() == 0 && match(4, "=end")));
+                if (!doc)
+                    return make_token(Token::Type::Comment);
                 doc->append("=end\n");
-                return Token { Token::Type::Doc, doc, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Doc, doc);
             }
-            auto token = Token { Token::Type::Equal, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            auto token = make_token(Token::Type::Equal);
             return token;
         }
     }
@@ -242,37 +552,37 @@ Token Lexer::build_next_token() {
         switch (current_char()) {
         case '=':
             advance();
-            return Token { Token::Type::PlusEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::PlusEqual);
         case '@':
             if (m_remaining_method_names > 0) {
                 advance();
                 SharedPtr<String> lit = new String("+@");
-                return Token { Token::Type::OperatorName, lit, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::OperatorName, lit);
             } else {
-                return Token { Token::Type::Plus, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Plus);
             }
         default:
-            return Token { Token::Type::Plus, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Plus);
         }
     case '-':
         advance();
         switch (current_char()) {
         case '>':
             advance();
-            return Token { Token::Type::Arrow, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Arrow);
         case '=':
             advance();
-            return Token { Token::Type::MinusEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::MinusEqual);
         case '@':
             if (m_remaining_method_names > 0) {
                 advance();
                 SharedPtr<String> lit = new String("-@");
-                return Token { Token::Type::OperatorName, lit, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::OperatorName, lit);
             } else {
-                return Token { Token::Type::Minus, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Minus);
             }
         default:
-            return Token { Token::Type::Minus, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Minus);
         }
     case '*':
         advance();
@@ -282,22 +592,22 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '=':
                 advance();
-                return Token { Token::Type::StarStarEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::StarStarEqual);
             default:
-                return Token { Token::Type::StarStar, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::StarStar);
             }
         case '=':
             advance();
-            return Token { Token::Type::StarEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::StarEqual);
         default:
-            return Token { Token::Type::Star, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Star);
         }
     case '/': {
         advance();
         if (!m_last_token)
             return consume_regexp('/', '/');
         if (m_remaining_method_names > 0)
-            return Token { Token::Type::Slash, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Slash);
         switch (m_last_token.type()) {
         case Token::Type::Comma:
         case Token::Type::Doc:
@@ -316,16 +626,16 @@ Token Lexer::build_next_token() {
                 if (m_last_token.is_keyword() && m_last_token.can_precede_regexp_literal()) {
                     return consume_regexp('/', '/');
                 } else {
-                    return Token { Token::Type::Slash, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(Token::Type::Slash);
                 }
             case '=':
                 advance();
-                return Token { Token::Type::SlashEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::SlashEqual);
             default:
                 if (m_whitespace_precedes) {
                     return consume_regexp('/', '/');
                 } else {
-                    return Token { Token::Type::Slash, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(Token::Type::Slash);
                 }
             }
         }
@@ -336,7 +646,7 @@ Token Lexer::build_next_token() {
         switch (current_char()) {
         case '=':
             advance();
-            return Token { Token::Type::PercentEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::PercentEqual);
         case 'q':
             return consume_percent_string(&Lexer::consume_single_quoted_string);
         case 'Q':
@@ -363,20 +673,20 @@ Token Lexer::build_next_token() {
         switch (current_char()) {
         case '=':
             advance();
-            return Token { Token::Type::NotEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::NotEqual);
         case '~':
             advance();
-            return Token { Token::Type::NotMatch, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::NotMatch);
         case '@':
             if (m_remaining_method_names > 0) {
                 advance();
                 SharedPtr<String> lit = new String("!@");
-                return Token { Token::Type::OperatorName, lit, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::OperatorName, lit);
             } else {
-                return Token { Token::Type::Not, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Not);
             }
         default:
-            return Token { Token::Type::Not, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Not);
         }
     case '<':
         advance();
@@ -387,7 +697,7 @@ Token Lexer::build_next_token() {
             case '~':
             case '-': {
                 auto next = peek();
-                if (isalpha(next))
+                if (is_alpha_char(next))
                     return consume_heredoc();
                 switch (next) {
                 case '_':
@@ -396,12 +706,12 @@ Token Lexer::build_next_token() {
                 case '\'':
                     return consume_heredoc();
                 default:
-                    return Token { Token::Type::LeftShift, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(Token::Type::LeftShift);
                 }
             }
             case '=':
                 advance();
-                return Token { Token::Type::LeftShiftEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::LeftShiftEqual);
             default:
                 if (!m_whitespace_precedes) {
                     if (token_is_first_on_line())
@@ -409,9 +719,9 @@ Token Lexer::build_next_token() {
                     else if (m_last_token.can_precede_heredoc_that_looks_like_left_shift_operator())
                         return consume_heredoc();
                     else
-                        return Token { Token::Type::LeftShift, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                        return make_token(Token::Type::LeftShift);
                 }
-                if (isalpha(current_char()))
+                if (is_alpha_char(current_char()))
                     return consume_heredoc();
                 switch (current_char()) {
                 case '_':
@@ -420,7 +730,7 @@ Token Lexer::build_next_token() {
                 case '\'':
                     return consume_heredoc();
                 default:
-                    return Token { Token::Type::LeftShift, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(Token::Type::LeftShift);
                 }
             }
         }
@@ -429,12 +739,12 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '>':
                 advance();
-                return Token { Token::Type::Comparison, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Comparison);
             default:
-                return Token { Token::Type::LessThanOrEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::LessThanOrEqual);
             }
         default:
-            return Token { Token::Type::LessThan, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::LessThan);
         }
     case '>':
         advance();
@@ -444,15 +754,15 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '=':
                 advance();
-                return Token { Token::Type::RightShiftEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::RightShiftEqual);
             default:
-                return Token { Token::Type::RightShift, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::RightShift);
             }
         case '=':
             advance();
-            return Token { Token::Type::GreaterThanOrEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::GreaterThanOrEqual);
         default:
-            return Token { Token::Type::GreaterThan, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::GreaterThan);
         }
     case '&':
         advance();
@@ -462,18 +772,18 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '=':
                 advance();
-                return Token { Token::Type::AmpersandAmpersandEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::AmpersandAmpersandEqual);
             default:
-                return Token { Token::Type::AmpersandAmpersand, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::AmpersandAmpersand);
             }
         case '=':
             advance();
-            return Token { Token::Type::AmpersandEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::AmpersandEqual);
         case '.':
             advance();
-            return Token { Token::Type::SafeNavigation, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::SafeNavigation);
         default:
-            return Token { Token::Type::Ampersand, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Ampersand);
         }
     case '|':
         advance();
@@ -483,24 +793,24 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '=':
                 advance();
-                return Token { Token::Type::PipePipeEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::PipePipeEqual);
             default:
-                return Token { Token::Type::PipePipe, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::PipePipe);
             }
         case '=':
             advance();
-            return Token { Token::Type::PipeEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::PipeEqual);
         default:
-            return Token { Token::Type::Pipe, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Pipe);
         }
     case '^':
         advance();
         switch (current_char()) {
         case '=':
             advance();
-            return Token { Token::Type::CaretEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::CaretEqual);
         default:
-            return Token { Token::Type::Caret, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Caret);
         }
     case '~':
         advance();
@@ -509,28 +819,28 @@ Token Lexer::build_next_token() {
             if (m_remaining_method_names > 0) {
                 advance();
                 SharedPtr<String> lit = new String("~@");
-                return Token { Token::Type::OperatorName, lit, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::OperatorName, lit);
             } else {
-                return Token { Token::Type::Tilde, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Tilde);
             }
         default:
-            return Token { Token::Type::Tilde, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Tilde);
         }
     case '?': {
         auto c = next();
-        if (isspace(c) || c == 0) {
+        if (is_space_char(c) || c == 0) {
             m_open_ternary = true;
-            return Token { Token::Type::TernaryQuestion, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::TernaryQuestion);
         } else {
             advance();
             if (c == '\\') {
                 auto buf = new String();
                 auto result = consume_escaped_byte(*buf);
                 if (!result.first)
-                    return Token { result.second, current_char(), m_file, m_token_line, m_token_column, m_whitespace_precedes };
-                return Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(result.second, current_char());
+                return make_token(Token::Type::String, buf);
             } else {
-                return Token { Token::Type::String, c, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::String, c);
             }
         }
     }
@@ -538,19 +848,19 @@ Token Lexer::build_next_token() {
         auto c = next();
         if (c == ':') {
             advance();
-            return Token { Token::Type::ConstantResolution, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::ConstantResolution);
         } else if (m_last_token.type() == Token::Type::InterpolatedStringEnd && !m_whitespace_precedes && !m_open_ternary) {
-            return Token { Token::Type::InterpolatedStringSymbolKey, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::InterpolatedStringSymbolKey);
         } else if (c == '"') {
             advance();
             return consume_double_quoted_string('"', '"', Token::Type::InterpolatedSymbolBegin, Token::Type::InterpolatedSymbolEnd);
         } else if (c == '\'') {
             advance();
             auto string = consume_single_quoted_string('\'', '\'');
-            return Token { Token::Type::Symbol, string.literal(), m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        } else if (isspace(c) || c == 0) {
+            return make_token(Token::Type::Symbol, string.literal());
+        } else if (is_space_char(c) || c == 0) {
             m_open_ternary = false;
-            auto token = Token { Token::Type::TernaryColon, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            auto token = make_token(Token::Type::TernaryColon);
             return token;
         } else {
             return consume_symbol();
@@ -559,11 +869,10 @@ Token Lexer::build_next_token() {
     case '@':
         switch (peek()) {
         case '@': {
-            // kinda janky, but we gotta trick consume_word and then prepend the '@' back on the front
+            auto start = m_index;
             advance();
-            auto token = consume_word(Token::Type::ClassVariable);
-            token.set_literal(String::format("@{}", token.literal()));
-            return token;
+            consume_word();
+            return name_token(Token::Type::ClassVariable, start);
         }
         default:
             return consume_word(Token::Type::InstanceVariable);
@@ -571,7 +880,7 @@ Token Lexer::build_next_token() {
     case '$':
         if (peek() == '&') {
             advance(2);
-            return Token { Token::Type::BackRef, '&', m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::BackRef, '&');
         } else if (peek() >= '1' && peek() <= '9') {
             return consume_nth_ref();
         } else {
@@ -585,16 +894,16 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '.':
                 advance();
-                return Token { Token::Type::DotDotDot, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::DotDotDot);
             default:
-                return Token { Token::Type::DotDot, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::DotDot);
             }
         default:
-            return Token { Token::Type::Dot, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Dot);
         }
     case '{':
         advance();
-        return Token { Token::Type::LCurlyBrace, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::LCurlyBrace);
     case '[': {
         advance();
         switch (current_char()) {
@@ -603,47 +912,47 @@ Token Lexer::build_next_token() {
             switch (current_char()) {
             case '=':
                 advance();
-                return Token { Token::Type::LBracketRBracketEqual, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::LBracketRBracketEqual);
             default:
-                auto token = Token { Token::Type::LBracketRBracket, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                auto token = make_token(Token::Type::LBracketRBracket);
                 return token;
             }
         default:
-            auto token = Token { Token::Type::LBracket, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            auto token = make_token(Token::Type::LBracket);
             return token;
         }
     }
     case '(': {
         advance();
-        auto token = Token { Token::Type::LParen, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        auto token = make_token(Token::Type::LParen);
         return token;
     }
     case '}':
         advance();
-        return Token { Token::Type::RCurlyBrace, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::RCurlyBrace);
     case ']':
         advance();
-        return Token { Token::Type::RBracket, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::RBracket);
     case ')':
         advance();
-        return Token { Token::Type::RParen, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::RParen);
     case '\n': {
         advance();
-        auto token = Token { Token::Type::Newline, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        auto token = make_token(Token::Type::Newline);
         if (!m_heredoc_stack.is_empty()) {
             auto new_index = m_heredoc_stack.last();
-            while (m_index < new_index)
-                advance();
+            if (m_index < new_index)
+                advance(new_index - m_index);
             m_heredoc_stack.clear();
         }
         return token;
     }
     case ';':
         advance();
-        return Token { Token::Type::Semicolon, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::Semicolon);
     case ',':
         advance();
-        return Token { Token::Type::Comma, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::Comma);
     case '"':
         advance();
         return consume_interpolated_string('"', '"');
@@ -654,37 +963,40 @@ Token Lexer::build_next_token() {
         advance();
         if (m_remaining_method_names > 0) {
             SharedPtr<String> lit = new String("`");
-            return Token { Token::Type::OperatorName, lit, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::OperatorName, lit);
         } else {
             return consume_interpolated_shell('`', '`');
         }
     }
     case '#':
         if (token_is_first_on_line()) {
-            SharedPtr<String> doc = new String();
+            SharedPtr<String> doc = m_keep_doc_comments ? new String() : nullptr;
             bool found_comment_marker = true;
             char c = current_char();
             while (c) {
                 if (!found_comment_marker) {
                     if (c == '#')
                         found_comment_marker = true;
-                    else if (!isspace(c))
+                    else if (!is_space_char(c))
                         break;
                 }
                 if (c == '\n' || c == '\r') {
-                    doc->append_char(c);
+                    if (doc)
+                        doc->append_char(c);
                     found_comment_marker = false;
-                } else if (found_comment_marker)
+                } else if (found_comment_marker && doc)
                     doc->append_char(c);
                 c = next();
             }
-            return Token { Token::Type::Doc, doc, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            if (!doc)
+                return make_token(Token::Type::Comment);
+            return make_token(Token::Type::Doc, doc);
         } else {
             char c;
             do {
                 c = next();
             } while (c && c != '\n' && c != '\r');
-            return Token { Token::Type::Comment, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Comment);
         }
     case '0':
     case '1':
@@ -700,19 +1012,19 @@ Token Lexer::build_next_token() {
         return token;
     }
     case 'i':
-        if (m_last_token.can_be_complex_or_rational() && !isalnum(peek())) {
+        if (m_last_token.can_be_complex_or_rational() && !is_alnum_char(peek())) {
             advance();
-            return Token { Token::Type::Complex, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Complex);
         }
         break;
     case 'r':
         if (m_last_token.can_be_complex_or_rational()) {
             if (peek() == 'i') {
                 advance(2);
-                return Token { Token::Type::RationalComplex, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-            } else if (!isalnum(peek())) {
+                return make_token(Token::Type::RationalComplex);
+            } else if (!is_alnum_char(peek())) {
                 advance();
-                return Token { Token::Type::Rational, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::Rational);
             }
         }
         break;
@@ -722,101 +1034,22 @@ Token Lexer::build_next_token() {
 
     if (!m_last_token.is_dot() && !m_last_token.is_constant_resolution() && match(4, "self")) {
         if (current_char() == '.' || (current_char() == ':' && peek() == ':'))
-            keyword_token = { Token::Type::SelfKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            keyword_token = make_token(Token::Type::SelfKeyword);
         else
             rewind(4);
     }
 
     if (m_remaining_method_names == 0) {
-        if (match(12, "__ENCODING__"))
-            keyword_token = { Token::Type::ENCODINGKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(8, "__LINE__"))
-            keyword_token = { Token::Type::LINEKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(8, "__FILE__"))
-            keyword_token = { Token::Type::FILEKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "BEGIN"))
-            keyword_token = { Token::Type::BEGINKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "END"))
-            keyword_token = { Token::Type::ENDKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "alias"))
-            keyword_token = { Token::Type::AliasKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "and"))
-            keyword_token = { Token::Type::AndKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "begin"))
-            keyword_token = { Token::Type::BeginKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "break"))
-            keyword_token = { Token::Type::BreakKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "case"))
-            keyword_token = { Token::Type::CaseKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "class"))
-            keyword_token = { Token::Type::ClassKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(8, "defined?"))
-            keyword_token = { Token::Type::DefinedKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "def"))
-            keyword_token = { Token::Type::DefKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(2, "do"))
-            keyword_token = { Token::Type::DoKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "else"))
-            keyword_token = { Token::Type::ElseKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "elsif"))
-            keyword_token = { Token::Type::ElsifKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "end"))
-            keyword_token = { Token::Type::EndKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(6, "ensure"))
-            keyword_token = { Token::Type::EnsureKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "false"))
-            keyword_token = { Token::Type::FalseKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "for"))
-            keyword_token = { Token::Type::ForKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(2, "if"))
-            keyword_token = { Token::Type::IfKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(2, "in"))
-            keyword_token = { Token::Type::InKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(6, "module"))
-            keyword_token = { Token::Type::ModuleKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "next"))
-            keyword_token = { Token::Type::NextKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "nil"))
-            keyword_token = { Token::Type::NilKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(3, "not"))
-            keyword_token = { Token::Type::NotKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(2, "or"))
-            keyword_token = { Token::Type::OrKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "redo"))
-            keyword_token = { Token::Type::RedoKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(6, "rescue"))
-            keyword_token = { Token::Type::RescueKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "retry"))
-            keyword_token = { Token::Type::RetryKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(6, "return"))
-            keyword_token = { Token::Type::ReturnKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "self"))
-            keyword_token = { Token::Type::SelfKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "super"))
-            keyword_token = { Token::Type::SuperKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "then"))
-            keyword_token = { Token::Type::ThenKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "true"))
-            keyword_token = { Token::Type::TrueKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "undef"))
-            keyword_token = { Token::Type::UndefKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(6, "unless"))
-            keyword_token = { Token::Type::UnlessKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "until"))
-            keyword_token = { Token::Type::UntilKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(4, "when"))
-            keyword_token = { Token::Type::WhenKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "while"))
-            keyword_token = { Token::Type::WhileKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        else if (match(5, "yield"))
-            keyword_token = { Token::Type::YieldKeyword, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        auto type = match_keyword();
+        if (type != Token::Type::Invalid)
+            keyword_token = make_token(type);
     }
 
     // if a colon comes next, it's not a keyword -- it's a symbol!
     if (keyword_token && current_char() == ':' && peek() != ':' && !m_open_ternary) {
         advance(); // :
         auto name = keyword_token.type_value();
-        return Token { Token::Type::SymbolKey, name, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::SymbolKey, name);
     } else if (keyword_token) {
         return keyword_token;
     }
@@ -828,7 +1061,7 @@ Token Lexer::build_next_token() {
         return consume_bare_name_or_constant(Token::Type::Constant);
     } else {
         auto buf = consume_non_whitespace();
-        auto token = Token { Token::Type::Invalid, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        auto token = make_token(Token::Type::Invalid, buf);
         return token;
     }
 
@@ -837,8 +1070,8 @@ Token Lexer::build_next_token() {
 
 Token Lexer::consume_symbol() {
     char c = current_char();
-    SharedPtr<String> buf = new String("");
-    auto gobble = [&buf, this](char c) -> char { buf->append_char(c); return next(); };
+    auto start = m_index;
+    auto gobble = [this](char) -> char { return next(); };
     switch (c) {
     case '@':
         c = gobble(c);
@@ -855,7 +1088,10 @@ Token Lexer::consume_symbol() {
         break;
     case '~':
         c = gobble(c);
-        if (c == '@') advance();
+        if (c == '@') {
+            advance();
+            return make_token(Token::Type::Symbol, "~");
+        }
         break;
     case '+':
     case '-': {
@@ -888,7 +1124,7 @@ Token Lexer::consume_symbol() {
             gobble(c);
             break;
         default:
-            return Token { Token::Type::Invalid, c, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Invalid, c);
         }
         break;
     case '!':
@@ -931,7 +1167,7 @@ Token Lexer::consume_symbol() {
             c = gobble(c);
             if (c == '=') gobble(c);
         } else {
-            return Token { Token::Type::Invalid, c, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Invalid, c);
         }
         break;
     default:
@@ -952,25 +1188,88 @@ Token Lexer::consume_symbol() {
             break;
         }
     }
-    return Token { Token::Type::Symbol, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return name_token(Token::Type::Symbol, start);
 }
 
-SharedPtr<String> Lexer::consume_word() {
-    char c = current_char();
-    SharedPtr<String> buf = new String("");
+SharedPtr<String> Lexer::slice_input(size_t start) const {
+    return new String(m_input->c_str() + start, m_index - start);
+}
+
+// Names never contain escapes, so a name token is just a span of the input
+// (see Source), and nothing is copied unless the parser asks for the name.
+// A heredoc body is lexed from a copy that the Source doesn't know about,
+// so names in there are interned right away.
+Token Lexer::name_token(Token::Type type, size_t start, size_t length) {
+    auto prefix = start - m_token_index;
+    if (reads_source() && start >= m_token_index && prefix <= Token::MAX_SPAN_PREFIX && length <= Token::MAX_SPAN_LENGTH)
+        return Token { type, m_source.ptr(), start, length, prefix, m_whitespace_precedes };
+    Source::TokenValue value;
+    value.symbol_id = m_symbols->intern(m_input->c_str() + start, length);
+    value.literal = m_symbols->string(value.symbol_id);
+    return make_token(type, value);
+}
+
+// Heredoc bodies aren't part of the Source's code, so tokens in there keep
+// their line and column in a Source::TokenValue instead of an offset.
+Token Lexer::make_token_at(size_t index, Token::Type type) const {
+    if (reads_source())
+        return Token { type, m_source.ptr(), index, m_whitespace_precedes };
+    return make_token_at(index, type, Source::TokenValue {});
+}
+
+Token Lexer::make_token_at(size_t index, Token::Type type, Source::TokenValue value) const {
+    value.line = m_first_line + m_line_index->line(index);
+    value.column = m_line_index->column(index);
+    return Token { type, m_source.ptr(), value, m_whitespace_precedes };
+}
+
+Token Lexer::make_token_at(size_t index, Token::Type type, SharedPtr<String> literal) const {
+    Source::TokenValue value;
+    value.literal = literal;
+    return make_token_at(index, type, value);
+}
+
+Token Lexer::make_token_at(size_t index, Token::Type type, const char *literal) const {
+    return make_token_at(index, type, SharedPtr<String>(new String(literal)));
+}
+
+Token Lexer::make_token_at(size_t index, Token::Type type, char literal) const {
+    return make_token_at(index, type, SharedPtr<String>(new String(literal)));
+}
+
+Token Lexer::make_token_at(size_t index, Token::Type type, long long fixnum) const {
+    Source::TokenValue value;
+    value.fixnum = fixnum;
+    return make_token_at(index, type, value);
+}
+
+Token Lexer::make_token_at(size_t index, Token::Type type, double dbl) const {
+    Source::TokenValue value;
+    value.dbl = dbl;
+    return make_token_at(index, type, value);
+}
+
+Token Lexer::name_token(Token::Type type, size_t start) {
+    return name_token(type, start, m_index - start);
+}
+
+void Lexer::consume_word() {
+    char c;
     do {
-        buf->append_char(c);
         c = next();
     } while (is_identifier_char(c));
-    return buf;
 }
 
 Token Lexer::consume_word(Token::Type type) {
-    return Token { type, consume_word(), m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    auto start = m_index;
+    consume_word();
+    return name_token(type, start);
 }
 
 Token Lexer::consume_bare_name_or_constant(Token::Type type) {
-    auto buf = consume_word();
+    auto start = m_index;
+    consume_word();
+    auto length = m_index - start;
     auto c = current_char();
     switch (c) {
     case '?':
@@ -980,12 +1279,12 @@ Token Lexer::consume_bare_name_or_constant(Token::Type type) {
             type = Token::Type::SymbolKey;
         }
         advance();
-        buf->append_char(c);
+        length++;
         break;
     case '=':
         if (m_allow_assignment_method || (!m_last_token.is_dot() && m_remaining_method_names > 0)) {
             advance();
-            buf->append_char(c);
+            length++;
         }
         break;
     case ':':
@@ -997,7 +1296,7 @@ Token Lexer::consume_bare_name_or_constant(Token::Type type) {
     default:
         break;
     }
-    return Token { type, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return name_token(type, start, length);
 }
 
 Token Lexer::consume_global_variable() {
@@ -1022,18 +1321,14 @@ Token Lexer::consume_global_variable() {
     case ',':
     case ':':
     case '~': {
-        advance();
-        SharedPtr<String> buf = new String("$");
-        buf->append_char(current_char());
-        advance();
-        return Token { Token::Type::GlobalVariable, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        auto start = m_index;
+        advance(2);
+        return name_token(Token::Type::GlobalVariable, start);
     }
     case '-': {
-        SharedPtr<String> buf = new String("$-");
-        advance(2);
-        buf->append_char(current_char());
-        advance();
-        return Token { Token::Type::GlobalVariable, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        auto start = m_index;
+        advance(3);
+        return name_token(Token::Type::GlobalVariable, start);
     }
     default: {
         return consume_word(Token::Type::GlobalVariable);
@@ -1041,55 +1336,25 @@ Token Lexer::consume_global_variable() {
     }
 }
 
-bool is_valid_heredoc(bool with_dash, SharedPtr<String> doc, String heredoc_name) {
-    if (!doc->ends_with(heredoc_name))
+// The line that ends a heredoc is the name on its own (if << was used), or
+// whitespace followed by the name (if <<- or <<~ was used).
+static bool is_heredoc_delimiter(bool with_dash, const char *line, size_t length, const String &heredoc_name) {
+    if (length < heredoc_name.length())
+        return false;
+    if (memcmp(line + length - heredoc_name.length(), heredoc_name.c_str(), heredoc_name.length()) != 0)
         return false;
-    if (doc->length() - heredoc_name.length() == 0)
+    if (length == heredoc_name.length())
         return true;
-    auto prefix = (*doc)[doc->length() - heredoc_name.length() - 1];
-    return with_dash ? isspace(prefix) : prefix == '\n';
-}
-
-size_t get_heredoc_indent(SharedPtr<String> doc) {
-    if (doc->is_empty())
-        return 0;
-    size_t heredoc_indent = std::numeric_limits<size_t>::max();
-    size_t line_indent = 0;
-    bool maybe_blank_line = true;
-    for (size_t i = 0; i < doc->length(); i++) {
-        char c = (*doc)[i];
-        if (c == '\n') {
-            if (!maybe_blank_line && line_indent < heredoc_indent)
-                heredoc_indent = line_indent;
-            line_indent = 0;
-            maybe_blank_line = true;
-        } else if (isspace(c)) {
-            if (maybe_blank_line)
-                line_indent++;
-        } else {
-            maybe_blank_line = false;
-        }
-    }
-    return heredoc_indent;
+    return with_dash && is_space_char(line[length - heredoc_name.length() - 1]);
 }
 
-void dedent_heredoc(SharedPtr<String> &doc) {
-    size_t heredoc_indent = get_heredoc_indent(doc);
-    if (heredoc_indent == 0)
-        return;
-    SharedPtr<String> new_doc = new String("");
-    size_t line_begin = 0;
-    for (size_t i = 0; i < doc->length(); i++) {
-        char c = (*doc)[i];
-        if (c == '\n') {
-            line_begin += heredoc_indent;
-            if (line_begin < i)
-                new_doc->append(doc->substring(line_begin, i - line_begin));
-            new_doc->append_char('\n');
-            line_begin = i + 1;
-        }
+// Leading whitespace of the line, or max size_t if the line is blank.
+static size_t heredoc_line_indent(const char *line, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (!is_space_char(line[i]))
+            return i;
     }
-    doc = new_doc;
+    return std::numeric_limits<size_t>::max();
 }
 
 Token Lexer::consume_heredoc() {
@@ -1136,7 +1401,7 @@ Token Lexer::consume_heredoc() {
             case '\n':
             case '\r':
             case 0:
-                return Token { Token::Type::UnterminatedString, "heredoc identifier", m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::UnterminatedString, "heredoc identifier");
             default:
                 heredoc_name.append_char(c);
                 c = next();
@@ -1144,80 +1409,100 @@ Token Lexer::consume_heredoc() {
         }
         advance();
     } else {
-        heredoc_name = *consume_word();
+        auto start = m_index;
+        consume_word();
+        heredoc_name = *slice_input(start);
     }
 
-    SharedPtr<String> doc = new String("");
+    auto input = m_input->c_str();
     size_t heredoc_index = m_index;
-    auto get_char = [&heredoc_index, this]() { return (heredoc_index >= m_size) ? 0 : m_input->at(heredoc_index); };
 
     if (m_heredoc_stack.is_empty()) {
         // start consuming the heredoc on the next line
-        while (get_char() != '\n') {
-            if (heredoc_index >= m_size)
-                return Token { Token::Type::UnterminatedString, "heredoc", m_file, m_token_line, m_token_column, m_whitespace_precedes };
-            heredoc_index++;
-        }
-        heredoc_index++;
+        auto newline = static_cast<const char *>(memchr(input + heredoc_index, '\n', m_size - heredoc_index));
+        if (!newline)
+            return make_token(Token::Type::UnterminatedString, "heredoc");
+        heredoc_index = newline - input + 1;
     } else {
         // start consuming the heredoc right after the last one
         heredoc_index = m_heredoc_stack.last();
     }
 
-    // consume the heredoc until we find the delimiter, either '\n' (if << was used) or any whitespace (if <<- was used) followed by "DELIM\n"
+    // consume the heredoc a line at a time until we find the delimiter line,
+    // keeping track of where the lines start and how far they are indented
+    // for <<~
+    size_t body_start = heredoc_index;
+    size_t body_end; // start of the delimiter line
+    size_t doc_end;
+    Vector<size_t> line_starts {};
+    size_t indent = std::numeric_limits<size_t>::max();
     for (;;) {
-        if (heredoc_index >= m_size) {
-            if (is_valid_heredoc(with_dash, doc, heredoc_name))
-                break;
-            return Token { Token::Type::UnterminatedString, doc, m_file, m_token_line, m_token_column, m_whitespace_precedes };
-        }
-        char c = get_char();
-        heredoc_index++;
-        if (c == '\n' && is_valid_heredoc(with_dash, doc, heredoc_name))
+        auto line_start = heredoc_index;
+        auto newline = static_cast<const char *>(memchr(input + line_start, '\n', m_size - line_start));
+        size_t line_end = newline ? newline - input : m_size;
+        if (is_heredoc_delimiter(with_dash, input + line_start, line_end - line_start, heredoc_name)) {
+            body_end = line_start;
+            doc_end = line_end - heredoc_name.length();
+            heredoc_index = newline ? line_end + 1 : m_size;
             break;
-        doc->append_char(c);
+        }
+        if (!newline) {
+            SharedPtr<String> doc = new String(input + body_start, m_size - body_start);
+            return make_token(Token::Type::UnterminatedString, doc);
+        }
+        if (should_dedent) {
+            line_starts.push(line_start);
+            auto line_indent = heredoc_line_indent(input + line_start, line_end - line_start);
+            if (line_indent < indent)
+                indent = line_indent;
+        }
+        heredoc_index = line_end + 1;
     }
 
-    // chop the delimiter and any trailing space off the string
-    doc->truncate(doc->length() - heredoc_name.length());
-    doc->strip_trailing_spaces();
-
-    if (should_dedent)
-        dedent_heredoc(doc);
+    SharedPtr<String> doc;
+    if (should_dedent && indent > 0) {
+        // Take the indentation off every line; blank lines may be shorter
+        // than that. Whatever came before the delimiter on its line goes.
+        doc = new String;
+        for (size_t i = 0; i < line_starts.size(); i++) {
+            auto line_start = line_starts[i];
+            auto line_end = (i + 1 < line_starts.size() ? line_starts[i + 1] : body_end) - 1;
+            auto length = line_end - line_start;
+            if (length > indent)
+                doc->append(input + line_start + indent, length - indent);
+            doc->append_char('\n');
+        }
+    } else {
+        doc = new String(input + body_start, doc_end - body_start);
+        // chop any trailing space off the string
+        doc->strip_trailing_spaces();
+    }
 
     // We have to keep tokenizing on the line where the heredoc was started, and then jump to the line after the heredoc.
     // This index is used to jump to the end of the heredoc later.
     m_heredoc_stack.push(heredoc_index);
 
-    auto token = Token { Token::Type::String, doc, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    auto token = make_token(Token::Type::String, doc);
 
     if (should_interpolate) {
-        m_nested_lexer = new InterpolatedStringLexer { *this, token, end_type };
-        return Token { begin_type, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        start_nested_lexer<InterpolatedStringLexer>(*this, token, end_type);
+        return make_token(begin_type);
     }
 
     return token;
 }
 
 Token Lexer::consume_numeric() {
-    SharedPtr<String> chars = new String;
+    auto start_index = m_index;
 
     auto consume_decimal_digits_and_build_token = [&]() {
+        auto token = consume_integer(10, "");
         char c = current_char();
-        do {
-            chars->append_char(c);
-            c = next();
-            if (c == '_')
-                c = next();
-        } while (isdigit(c));
-        if ((c == '.' && isdigit(peek())) || (c == 'e' || c == 'E'))
-            return consume_numeric_as_float(chars);
-        else
-            return chars_to_fixnum_or_bignum_token(chars, 10, 0);
+        if ((c == '.' && is_decimal_digit(peek())) || (c == 'e' || c == 'E'))
+            return consume_numeric_as_float(start_index);
+        return token;
     };
 
-    Token token;
-
     if (current_char() == '0') {
         // special-prefixed literals 0d, 0x, etc.
         switch (peek()) {
@@ -1225,138 +1510,155 @@ Token Lexer::consume_numeric() {
         case 'D': {
             advance();
             char c = next();
-            if (!isdigit(c))
-                return Token { Token::Type::Invalid, c, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
-            do {
-                chars->append_char(c);
-                c = next();
-                if (c == '_')
-                    c = next();
-            } while (isdigit(c));
-            token = chars_to_fixnum_or_bignum_token(chars, 10, 0);
-            break;
+            if (!is_decimal_digit(c))
+                return make_token_at(m_index, Token::Type::Invalid, c);
+            return consume_integer(10, "");
         }
         case 'o':
         case 'O': {
-            chars->append_char('0');
-            chars->append_char('o');
             advance();
             char c = next();
             if (!(c >= '0' && c <= '7'))
-                return Token { Token::Type::Invalid, c, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
-            do {
-                chars->append_char(c);
-                c = next();
-                if (c == '_')
-                    c = next();
-            } while (c >= '0' && c <= '7');
-            token = chars_to_fixnum_or_bignum_token(chars, 8, 2);
-            break;
+                return make_token_at(m_index, Token::Type::Invalid, c);
+            return consume_integer(8, "0o");
         }
         case 'x':
         case 'X': {
-            chars->append_char('0');
-            chars->append_char('x');
             advance();
             char c = next();
-            if (!isxdigit(c))
-                return Token { Token::Type::Invalid, c, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
-            do {
-                chars->append_char(c);
-                c = next();
-                if (c == '_')
-                    c = next();
-            } while (isxdigit(c));
-            token = chars_to_fixnum_or_bignum_token(chars, 16, 2);
-            break;
+            if (!is_hex_digit(c))
+                return make_token_at(m_index, Token::Type::Invalid, c);
+            return consume_integer(16, "0x");
         }
         case 'b':
         case 'B': {
-            chars->append_char('0');
-            chars->append_char('b');
             advance();
             char c = next();
             if (c != '0' && c != '1')
-                return Token { Token::Type::Invalid, c, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
-            do {
-                chars->append_char(c);
-                c = next();
-                if (c == '_')
-                    c = next();
-            } while (c == '0' || c == '1');
-            token = chars_to_fixnum_or_bignum_token(chars, 2, 2);
-            break;
+                return make_token_at(m_index, Token::Type::Invalid, c);
+            return consume_integer(2, "0b");
         }
         default:
             char c = peek();
 
-            if (isdigit(c)) {
+            if (is_decimal_digit(c)) {
                 // bare octal case, e.g. 0777.
                 // If starts with a 0 but next number is not 0..7 then that's an error.
                 if (!(c >= '0' && c <= '7'))
-                    return Token { Token::Type::Invalid, c, m_file, m_cursor_line,
-                        m_cursor_column, m_whitespace_precedes };
-                chars->append_char(c);
-                c = next();
-                do {
-                    chars->append_char(c);
-                    c = next();
-                    if (c == '_')
-                        c = next();
-                } while (c >= '0' && c <= '7');
-                token = chars_to_fixnum_or_bignum_token(chars, 8, 1);
-            } else {
-                token = consume_decimal_digits_and_build_token();
+                    return make_token_at(m_index, Token::Type::Invalid, c);
+                advance();
+                return consume_integer(8, "0o");
             }
+            return consume_decimal_digits_and_build_token();
         }
-    } else {
-        token = consume_decimal_digits_and_build_token();
     }
 
-    return token;
+    return consume_decimal_digits_and_build_token();
 }
 
 const long long max_fixnum = std::numeric_limits<long long>::max() / 2; // 63 bits for MRI
 
-Token Lexer::chars_to_fixnum_or_bignum_token(SharedPtr<String> chars, int base, int offset) {
-    errno = 0;
-    auto fixnum = strtoll(chars->c_str() + offset, nullptr, base);
-    if (errno != 0 || fixnum > max_fixnum)
-        return Token { Token::Type::Bignum, chars, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+static inline int digit_value(char c, int base) {
+    int value;
+    if (is_decimal_digit(c))
+        value = c - '0';
+    else if (base == 16 && is_hex_digit(c))
+        value = (c | 0x20) - 'a' + 10;
     else
-        return Token { Token::Type::Fixnum, fixnum, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return -1;
+    return value < base ? value : -1;
 }
 
-Token Lexer::consume_numeric_as_float(SharedPtr<String> chars) {
+// Consumes the digits of an integer literal (the cursor is on the first one),
+// skipping an underscore between digits, and accumulates the value as it goes.
+// Only when the number outgrows a Fixnum do we copy the digits into a String
+// for a Bignum token.
+Token Lexer::consume_integer(int base, const char *bignum_prefix) {
+    auto digits_start = m_index;
+    long long fixnum = 0;
+    bool overflowed = false;
+    char c = current_char();
+    int digit = digit_value(c, base);
+    do {
+        if (!overflowed) {
+            if (fixnum > (max_fixnum - digit) / base)
+                overflowed = true;
+            else
+                fixnum = fixnum * base + digit;
+        }
+        c = next();
+        if (c == '_')
+            c = next();
+    } while ((digit = digit_value(c, base)) >= 0);
+
+    if (!overflowed)
+        return make_token(Token::Type::Fixnum, fixnum);
+
+    SharedPtr<String> chars = new String(bignum_prefix);
+    for (auto i = digits_start; i < m_index; i++) {
+        c = m_input->at(i);
+        if (c != '_')
+            chars->append_char(c);
+    }
+    return make_token(Token::Type::Bignum, chars);
+}
+
+// The cursor is just past the integer part of the float, which started at start_index.
+Token Lexer::consume_numeric_as_float(size_t start_index) {
     char c = current_char();
     if (c == '.') {
-        chars->append_char('.');
         c = next();
         do {
-            chars->append_char(c);
             c = next();
             if (c == '_')
                 c = next();
-        } while (isdigit(c));
+        } while (is_decimal_digit(c));
     }
     if (c == 'e' || c == 'E') {
-        chars->append_char('e');
         c = next();
-        if (c == '-' || c == '+') {
-            chars->append_char(c);
+        if (c == '-' || c == '+')
             c = next();
-        }
-        if (!isdigit(c))
-            return Token { Token::Type::Invalid, c, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        if (!is_decimal_digit(c))
+            return make_token_at(m_index, Token::Type::Invalid, c);
         do {
-            chars->append_char(c);
             c = next();
             if (c == '_')
                 c = next();
-        } while (isdigit(c));
+        } while (is_decimal_digit(c));
     }
-    double dbl = atof(chars->c_str());
-    return Token { Token::Type::Float, dbl, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+
+    // copy the literal without its underscores; nearly always fits on the stack
+    char stack_buffer[64];
+    String long_literal;
+    const char *buffer = stack_buffer;
+    size_t size = 0;
+    if (m_index - start_index < sizeof(stack_buffer)) {
+        for (auto i = start_index; i < m_index; i++) {
+            c = m_input->at(i);
+            if (c != '_')
+                stack_buffer[size++] = c;
+        }
+        stack_buffer[size] = '\0';
+    } else {
+        for (auto i = start_index; i < m_index; i++) {
+            c = m_input->at(i);
+            if (c != '_')
+                long_literal.append_char(c);
+        }
+        buffer = long_literal.c_str();
+        size = long_literal.length();
+    }
+
+    double dbl;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    // correctly rounded, and no locale lookup like strtod
+    auto result = std::from_chars(buffer, buffer + size, dbl);
+    if (result.ec != std::errc {})
+        dbl = strtod(buffer, nullptr); // out of range: Infinity or 0.0, same as Ruby
+#else
+    dbl = strtod(buffer, nullptr);
+#endif
+    return make_token(Token::Type::Float, dbl);
 }
 
 Token Lexer::consume_nth_ref() {
@@ -1366,8 +1668,8 @@ Token Lexer::consume_nth_ref() {
         num *= 10;
         num += c - '0';
         c = next();
-    } while (isdigit(c));
-    return Token { Token::Type::NthRef, num, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    } while (is_decimal_digit(c));
+    return make_token(Token::Type::NthRef, num);
 }
 
 long long Lexer::consume_hex_number(int max_length, bool allow_underscore) {
@@ -1385,7 +1687,7 @@ long long Lexer::consume_hex_number(int max_length, bool allow_underscore) {
         c = next();
         if (allow_underscore && c == '_')
             c = next();
-    } while (isxdigit(c) && (max_length == 0 || ++length < max_length));
+    } while (is_hex_digit(c) && (max_length == 0 || ++length < max_length));
     return number;
 }
 
@@ -1467,7 +1769,7 @@ std::pair<bool, Token::Type> Lexer::consume_escaped_byte(String &buf) {
             c = next();
             // unicode characters, space separated, 1-6 hex digits
             while (c != '}') {
-                if (!isxdigit(c))
+                if (!is_hex_digit(c))
                     return { false, Token::Type::InvalidUnicodeEscape };
                 auto codepoint = consume_hex_number(6);
                 utf32_codepoint_to_utf8(buf, codepoint);
@@ -1550,8 +1852,8 @@ bool Lexer::token_is_first_on_line() const {
 }
 
 Token Lexer::consume_double_quoted_string(char start_char, char stop_char, Token::Type begin_type, Token::Type end_type) {
-    m_nested_lexer = new InterpolatedStringLexer { *this, start_char, stop_char, end_type };
-    return Token { begin_type, start_char, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    start_nested_lexer<InterpolatedStringLexer>(*this, start_char, stop_char, end_type);
+    return make_token(begin_type, start_char);
 }
 
 Token Lexer::consume_single_quoted_string(char start_char, char stop_char) {
@@ -1578,9 +1880,9 @@ Token Lexer::consume_single_quoted_string(char start_char, char stop_char) {
                 advance(); // '
                 if (current_char() == ':' && !m_open_ternary) {
                     advance(); // :
-                    return Token { Token::Type::SymbolKey, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(Token::Type::SymbolKey, buf);
                 } else {
-                    return Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                    return make_token(Token::Type::String, buf);
                 }
             }
         } else {
@@ -1588,22 +1890,22 @@ Token Lexer::consume_single_quoted_string(char start_char, char stop_char) {
         }
         c = next();
     }
-    return Token { Token::Type::UnterminatedString, start_char, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::UnterminatedString, start_char);
 }
 
 Token Lexer::consume_quoted_array_without_interpolation(char start_char, char stop_char, Token::Type type) {
-    m_nested_lexer = new WordArrayLexer { *this, start_char, stop_char, false };
-    return Token { type, start_char, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    start_nested_lexer<WordArrayLexer>(*this, start_char, stop_char, false);
+    return make_token(type, start_char);
 }
 
 Token Lexer::consume_quoted_array_with_interpolation(char start_char, char stop_char, Token::Type type) {
-    m_nested_lexer = new WordArrayLexer { *this, start_char, stop_char, true };
-    return Token { type, start_char, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    start_nested_lexer<WordArrayLexer>(*this, start_char, stop_char, true);
+    return make_token(type, start_char);
 }
 
 Token Lexer::consume_regexp(char start_char, char stop_char) {
-    m_nested_lexer = new RegexpLexer { *this, start_char, stop_char };
-    return Token { Token::Type::InterpolatedRegexpBegin, start_char, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    start_nested_lexer<RegexpLexer>(*this, start_char, stop_char);
+    return make_token(Token::Type::InterpolatedRegexpBegin, start_char);
 }
 
 Token Lexer::consume_percent_symbol(char start_char, char stop_char) {
@@ -1638,7 +1940,7 @@ Token Lexer::consume_percent_upper_i(char start_char, char stop_char) {
 
 Token Lexer::consume_percent_string(Token (Lexer::*consumer)(char start_char, char stop_char), bool is_lettered) {
     if (m_remaining_method_names > 0) {
-        return Token { Token::Type::Percent, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::Percent);
     }
     char c = is_lettered ? peek() : current_char();
     size_t bytes = is_lettered ? 2 : 1;
@@ -1656,11 +1958,11 @@ Token Lexer::consume_percent_string(Token (Lexer::*consumer)(char start_char, ch
         advance(bytes);
         return (this->*consumer)('(', ')');
     default:
-        if (char_can_be_string_or_regexp_delimiter(c)) {
+        if (char_is(c, CharClass::Delimiter)) {
             advance(bytes);
             return (this->*consumer)(c, c);
         } else {
-            return Token { Token::Type::Percent, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            return make_token(Token::Type::Percent);
         }
     }
 }
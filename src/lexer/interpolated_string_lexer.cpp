@@ -1,8 +1,54 @@
 #include "natalie_parser/lexer/interpolated_string_lexer.hpp"
 #include "natalie_parser/token.hpp"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace NatalieParser {
 
+// Returns how many bytes at the start of str need no special handling in
+// consume_string(): anything but a backslash, '#', newline, NUL, or the
+// start/stop delimiters. (Either delimiter may be 0, which is harmless.)
+static size_t plain_run_length(const char *str, size_t size, char start_char, char stop_char) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto hash = _mm_set1_epi8('#');
+    const auto newline = _mm_set1_epi8('\n');
+    const auto nul = _mm_setzero_si128();
+    const auto start = _mm_set1_epi8(start_char);
+    const auto stop = _mm_set1_epi8(stop_char);
+    for (; i + 16 <= size; i += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        auto special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, hash)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, nul)));
+        special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(chunk, start), _mm_cmpeq_epi8(chunk, stop)));
+        auto mask = _mm_movemask_epi8(special);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < size; i++) {
+        auto c = str[i];
+        if (c == '\\' || c == '#' || c == '\n' || c == 0 || c == start_char || c == stop_char)
+            return i;
+    }
+    return size;
+}
+
+void InterpolatedStringLexer::consume_plain_run(String &buf) {
+    if (m_index >= m_size)
+        return;
+    auto str = m_input->c_str() + m_index;
+    auto length = plain_run_length(str, m_size - m_index, m_start_char, m_stop_char);
+    if (length == 0)
+        return;
+    buf.append(str, length);
+    m_index += length;
+}
+
 Token InterpolatedStringLexer::build_next_token() {
     switch (m_state) {
     case State::InProgress:
@@ -14,25 +60,29 @@ Token InterpolatedStringLexer::build_next_token() {
     case State::EndToken:
         return finish();
     case State::Done:
-        return Token { Token::Type::Eof, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::Eof);
     }
     TM_UNREACHABLE();
 }
 
 Token InterpolatedStringLexer::consume_string() {
     SharedPtr<String> buf = new String;
-    while (auto c = current_char()) {
+    for (;;) {
+        consume_plain_run(*buf);
+        auto c = current_char();
+        if (!c)
+            break;
         if (c == '\\' && m_stop_char != '\\') {
             advance(); // backslash
             auto result = consume_escaped_byte(*buf);
             if (!result.first)
-                return Token { result.second, current_char(), m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+                return make_token_at(m_index, result.second, current_char());
         } else if (c == '#' && peek() == '{') {
             if (buf->is_empty()) {
                 advance(2);
                 return start_evaluation();
             }
-            auto token = Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            auto token = make_token(Token::Type::String, buf);
             advance(2);
             m_state = State::EvaluateBegin;
             return token;
@@ -49,7 +99,7 @@ Token InterpolatedStringLexer::consume_string() {
                 return finish();
             } else {
                 m_state = State::EndToken;
-                return Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::String, buf);
             }
         } else {
             buf->append_char(c);
@@ -62,27 +112,27 @@ Token InterpolatedStringLexer::consume_string() {
     if (m_stop_char == 0) {
         advance();
         m_state = State::EndToken;
-        return Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::String, buf);
     }
 
-    return Token { Token::Type::UnterminatedString, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::UnterminatedString, buf);
 }
 
 Token InterpolatedStringLexer::start_evaluation() {
-    m_nested_lexer = new Lexer { *this, '{', '}' };
+    start_nested_lexer<Lexer>(*this, '{', '}');
     m_state = State::EvaluateEnd;
-    return Token { Token::Type::EvaluateToStringBegin, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::EvaluateToStringBegin);
 }
 
 Token InterpolatedStringLexer::stop_evaluation() {
     advance(); // }
     m_state = State::InProgress;
-    return Token { Token::Type::EvaluateToStringEnd, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::EvaluateToStringEnd);
 }
 
 Token InterpolatedStringLexer::finish() {
     m_state = State::Done;
-    return Token { m_end_type, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+    return make_token_at(m_index, m_end_type);
 }
 
 };
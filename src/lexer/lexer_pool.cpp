@@ -0,0 +1,17 @@
+#include "natalie_parser/lexer/lexer_pool.hpp"
+#include "natalie_parser/lexer.hpp"
+
+namespace NatalieParser {
+
+LexerPool::~LexerPool() {
+    for (auto &lexers : m_free) {
+        for (auto lexer : lexers)
+            delete lexer;
+    }
+}
+
+void LexerPool::release(Lexer *lexer) {
+    m_free[static_cast<size_t>(lexer->kind())].push(lexer);
+}
+
+}
@@ -1,3 +1,4 @@
+#include "natalie_parser/lexer/char_class.hpp"
 #include "natalie_parser/lexer/regexp_lexer.hpp"
 #include "natalie_parser/token.hpp"
 
@@ -8,10 +9,10 @@ Token RegexpLexer::build_next_token() {
     case State::InProgress:
         return consume_regexp();
     case State::EvaluateBegin:
-        m_nested_lexer = new Lexer { *this };
+        start_nested_lexer<Lexer>(*this);
         m_nested_lexer->set_stop_char('}');
         m_state = State::EvaluateEnd;
-        return Token { Token::Type::EvaluateToStringBegin, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::EvaluateToStringBegin);
     case State::EvaluateEnd:
         advance(); // }
         if (current_char() == m_stop_char) {
@@ -21,16 +22,16 @@ Token RegexpLexer::build_next_token() {
         } else {
             m_state = State::InProgress;
         }
-        return Token { Token::Type::EvaluateToStringEnd, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::EvaluateToStringEnd);
     case State::EndToken: {
         m_state = State::Done;
-        auto token = Token { Token::Type::InterpolatedRegexpEnd, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        auto token = make_token_at(m_index, Token::Type::InterpolatedRegexpEnd);
         if (m_options && !m_options->is_empty())
             token.set_literal(m_options);
         return token;
     }
     case State::Done:
-        return Token { Token::Type::Eof, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::Eof);
     }
     TM_UNREACHABLE();
 }
@@ -55,7 +56,7 @@ Token RegexpLexer::consume_regexp() {
             }
             advance();
         } else if (c == '#' && peek() == '{') {
-            auto token = Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+            auto token = make_token(Token::Type::String, buf);
             buf = new String;
             advance(2);
             m_state = State::EvaluateBegin;
@@ -72,20 +73,20 @@ Token RegexpLexer::consume_regexp() {
             } else {
                 m_options = consume_options();
                 m_state = State::EndToken;
-                return Token { Token::Type::String, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+                return make_token(Token::Type::String, buf);
             }
         } else {
             buf->append_char(c);
             advance();
         }
     }
-    return Token { Token::Type::UnterminatedRegexp, buf, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::UnterminatedRegexp, buf);
 }
 
 String *RegexpLexer::consume_options() {
     char c = current_char();
     auto options = new String;
-    while (c == 'i' || c == 'm' || c == 'x' || c == 'o' || c == 'u' || c == 'e' || c == 's' || c == 'n') {
+    while (is_regexp_option(c)) {
         options->append_char(c);
         c = next();
     }
@@ -1,3 +1,4 @@
+#include "natalie_parser/lexer/char_class.hpp"
 #include "natalie_parser/lexer/word_array_lexer.hpp"
 #include "natalie_parser/token.hpp"
 
@@ -11,7 +12,7 @@ Token WordArrayLexer::build_next_token() {
         return consume_array();
     case State::DynamicStringBegin:
         m_state = State::EvaluateBegin;
-        return Token { Token::Type::String, m_buffer, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::String, m_buffer);
     case State::DynamicStringEnd:
         if (current_char() == m_stop_char) {
             advance();
@@ -19,18 +20,18 @@ Token WordArrayLexer::build_next_token() {
         } else {
             m_state = State::InProgress;
         }
-        return Token { Token::Type::InterpolatedStringEnd, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::InterpolatedStringEnd);
     case State::EvaluateBegin:
         return start_evaluation();
     case State::EvaluateEnd:
         advance(); // }
         m_state = State::DynamicStringInProgress;
-        return Token { Token::Type::EvaluateToStringEnd, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+        return make_token(Token::Type::EvaluateToStringEnd);
     case State::EndToken:
         m_state = State::Done;
-        return Token { Token::Type::RBracket, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::RBracket);
     case State::Done:
-        return Token { Token::Type::Eof, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::Eof);
     }
     TM_UNREACHABLE();
 }
@@ -57,20 +58,20 @@ Token WordArrayLexer::consume_array() {
                     break;
                 }
             } else {
-                if (isspace(c)) {
+                if (is_space_char(c)) {
                     m_buffer->append_char(c);
                 } else {
                     m_buffer->append_char('\\');
                     m_buffer->append_char(c);
                 }
             }
-        } else if (isspace(c)) {
+        } else if (is_space_char(c)) {
             if (m_state == State::DynamicStringInProgress) {
                 advance();
                 return dynamic_string_finish();
             }
             if (!m_buffer->is_empty()) {
-                auto token = Token { Token::Type::String, m_buffer, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+                auto token = make_token_at(m_index, Token::Type::String, m_buffer);
                 advance();
                 return token;
             }
@@ -97,38 +98,38 @@ Token WordArrayLexer::consume_array() {
         }
     }
 
-    return Token { Token::Type::UnterminatedWordArray, m_buffer, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::UnterminatedWordArray, m_buffer);
 }
 
 Token WordArrayLexer::in_progress_start_dynamic_string() {
     advance(2); // #{
     m_state = State::DynamicStringBegin;
-    return Token { Token::Type::InterpolatedStringBegin, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+    return make_token_at(m_index, Token::Type::InterpolatedStringBegin);
 }
 
 Token WordArrayLexer::start_evaluation() {
-    m_nested_lexer = new Lexer { *this, '{', '}' };
+    start_nested_lexer<Lexer>(*this, '{', '}');
     m_state = State::EvaluateEnd;
-    return Token { Token::Type::EvaluateToStringBegin, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::EvaluateToStringBegin);
 }
 
 Token WordArrayLexer::dynamic_string_finish() {
     if (!m_buffer->is_empty()) {
         m_state = State::DynamicStringEnd;
-        return Token { Token::Type::String, m_buffer, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::String, m_buffer);
     }
     m_state = State::InProgress;
-    return Token { Token::Type::InterpolatedStringEnd, m_file, m_token_line, m_token_column, m_whitespace_precedes };
+    return make_token(Token::Type::InterpolatedStringEnd);
 }
 
 Token WordArrayLexer::in_progress_finish() {
     advance(); // ) or ] or } or whatever
     if (!m_buffer->is_empty()) {
         m_state = State::EndToken;
-        return Token { Token::Type::String, m_buffer, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+        return make_token_at(m_index, Token::Type::String, m_buffer);
     }
     m_state = State::Done;
-    return Token { Token::Type::RBracket, m_file, m_cursor_line, m_cursor_column, m_whitespace_precedes };
+    return make_token_at(m_index, Token::Type::RBracket);
 }
 
 };
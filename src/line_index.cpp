@@ -0,0 +1,63 @@
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "natalie_parser/line_index.hpp"
+
+namespace NatalieParser {
+
+LineIndex::LineIndex(const String &source)
+    : m_source_size { source.length() } {
+    m_line_starts.push(0);
+    auto str = source.c_str();
+    auto size = source.length();
+    size_t i = 0;
+#ifdef __SSE2__
+    const auto newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        while (mask) {
+            m_line_starts.push(i + __builtin_ctz(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    while (i < size) {
+        auto found = static_cast<const char *>(memchr(str + i, '\n', size - i));
+        if (!found)
+            break;
+        i = found - str + 1;
+        m_line_starts.push(i);
+    }
+}
+
+size_t LineIndex::line(size_t offset) const {
+    auto in_line = [&](size_t line) {
+        return m_line_starts[line] <= offset && (line + 1 == m_line_starts.size() || offset < m_line_starts[line + 1]);
+    };
+    auto last_line = m_last_line.load(std::memory_order_relaxed);
+    if (in_line(last_line))
+        return last_line;
+    if (last_line + 1 < m_line_starts.size() && in_line(last_line + 1)) {
+        m_last_line.store(last_line + 1, std::memory_order_relaxed);
+        return last_line + 1;
+    }
+
+    // binary search for the last line starting at or before offset
+    size_t low = 0;
+    size_t high = m_line_starts.size();
+    while (high - low > 1) {
+        auto middle = low + (high - low) / 2;
+        if (m_line_starts[middle] <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    m_last_line.store(low, std::memory_order_relaxed);
+    return low;
+}
+
+}
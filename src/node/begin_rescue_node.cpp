@@ -5,14 +5,15 @@
 
 namespace NatalieParser {
 
-SharedPtr<Node> BeginRescueNode::name_to_assignment() const {
-    assert(m_name);
-    return new AssignmentNode {
+void BeginRescueNode::set_exception_name(NodePtr<Node> name) {
+    m_name = name;
+    auto error_token = Token { Token::Type::GlobalVariable, token() };
+    error_token.set_literal("$!");
+    error_token.set_whitespace_precedes(false);
+    m_name_assignment = new AssignmentNode {
         token(),
         m_name,
-        new IdentifierNode {
-            Token { Token::Type::GlobalVariable, "$!", file(), line(), column(), false },
-            false },
+        new IdentifierNode { error_token, false },
     };
 }
 
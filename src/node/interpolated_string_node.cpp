@@ -4,8 +4,8 @@
 
 namespace NatalieParser {
 
-SharedPtr<Node> InterpolatedStringNode::append_string_node(SharedPtr<Node> string2) const {
-    SharedPtr<InterpolatedStringNode> copy = new InterpolatedStringNode { *this };
+NodePtr<Node> InterpolatedStringNode::append_string_node(NodePtr<Node> string2) const {
+    NodePtr<InterpolatedStringNode> copy = new InterpolatedStringNode { *this };
     switch (string2->type()) {
     case Node::Type::String: {
         auto string2_node = string2.static_cast_as<StringNode>();
@@ -92,7 +92,6 @@ void InterpolatedStringNode::transform(Creator *creator) const {
                 if (evstr->node() && evstr->node()->type() == Node::Type::InterpolatedString) {
                     auto dstr = evstr->node().static_cast_as<InterpolatedStringNode>();
                     if (dstr->nodes().size() == 1 && dstr->nodes().first()->type() == Node::Type::EvaluateToString) {
-                        auto n1 = dstr->nodes().first().static_cast_as<EvaluateToStringNode>();
                         creator->append(dstr->nodes().first());
                         continue;
                     }
@@ -3,7 +3,7 @@
 
 namespace NatalieParser {
 
-SharedPtr<Node> StringNode::append_string_node(SharedPtr<Node> string2) const {
+NodePtr<Node> StringNode::append_string_node(NodePtr<Node> string2) const {
     switch (string2->type()) {
     case Node::Type::String: {
         auto string2_node = string2.static_cast_as<StringNode>();
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "natalie_parser/creator/binary_creator.hpp"
+#include "natalie_parser/parse_cache.hpp"
+#include "natalie_parser/parser.hpp"
+
+namespace NatalieParser {
+
+// Each entry is this header followed by the BinaryAst:
+//
+//     "NPCE", u32 EntryVersion, u64 key high, u64 key low,
+//     u64 checksum of the BinaryAst, u64 size of the BinaryAst
+static constexpr char EntryMagic[] = "NPCE";
+static constexpr uint32_t EntryVersion = 1;
+static constexpr size_t EntryHeaderSize = 40;
+static constexpr const char *EntryExtension = ".npab";
+
+// One store in this many (those whose key is a multiple of it) also cleans
+// up, so no one process has to keep count.
+static constexpr uint64_t EvictInterval = 64;
+
+// Temporary files older than this were left by a process that died.
+static constexpr time_t StaleTemporaryAge = 60 * 60;
+
+// MurmurHash64A: a few multiplies per 8 bytes, so hashing the code costs
+// next to nothing next to parsing it.
+static uint64_t hash_bytes(const char *data, size_t length, uint64_t seed) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t hash = seed ^ (length * m);
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t k;
+        memcpy(&k, data + i, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        hash ^= k;
+        hash *= m;
+    }
+    if (i < length) {
+        uint64_t k = 0;
+        for (size_t j = 0; i + j < length; j++)
+            k |= static_cast<uint64_t>(static_cast<unsigned char>(data[i + j])) << (j * 8);
+        hash ^= k;
+        hash *= m;
+    }
+    hash ^= hash >> r;
+    hash *= m;
+    hash ^= hash >> r;
+    return hash;
+}
+
+static void write_u64(unsigned char *out, uint64_t value) {
+    for (int i = 0; i < 8; i++)
+        out[i] = (value >> (i * 8)) & 0xff;
+}
+
+static uint64_t read_u64(const unsigned char *data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(data[i]) << (i * 8);
+    return value;
+}
+
+static bool write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        auto written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool ends_with(const char *name, const char *suffix) {
+    auto length = strlen(name);
+    auto suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(name + length - suffix_length, suffix) == 0;
+}
+
+ParseCache::Entry::~Entry() {
+    if (m_mapping)
+        munmap(m_mapping, m_mapping_size);
+}
+
+ParseCache::ParseCache(String directory, String version, size_t max_size)
+    : m_directory { directory }
+    , m_version { version }
+    , m_max_size { max_size } { }
+
+SharedPtr<ParseCache::Entry> ParseCache::fetch(SharedPtr<String> code, SharedPtr<String> file, uint16_t flags, const std::atomic<bool> *cancel_flag) {
+    auto key = this->key(*code, *file, flags);
+    auto entry = lookup(key);
+    if (entry)
+        return entry;
+    Parser parser { code, file };
+    parser.set_cancel_flag(cancel_flag);
+    parser.set_keep_doc_comments(flags & BinaryAst::Comments);
+    return store(key, BinaryCreator::serialize(*parser.tree(), flags));
+}
+
+ParseCache::Key ParseCache::key(const String &code, const String &file, uint16_t flags) const {
+    char format[8];
+    snprintf(format, sizeof(format), "%u:%u", BinaryAst::Version, flags);
+    Key key { 0x6e61746c69650001ULL, 0x6e61746c69650002ULL };
+    for (auto *part : { &m_version, &file, &code }) {
+        key.high = hash_bytes(part->c_str(), part->length(), key.high);
+        key.low = hash_bytes(part->c_str(), part->length(), key.low);
+    }
+    key.high = hash_bytes(format, strlen(format), key.high);
+    key.low = hash_bytes(format, strlen(format), key.low);
+    return key;
+}
+
+SharedPtr<ParseCache::Entry> ParseCache::lookup(Key key) {
+    auto entry_path = path(key);
+    int fd = open(entry_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        m_misses++;
+        return {};
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        m_misses++;
+        return {};
+    }
+    size_t size = info.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        m_misses++;
+        return {};
+    }
+    SharedPtr<Entry> entry = new Entry;
+    entry->m_mapping = mapping;
+    entry->m_mapping_size = size;
+
+    auto bytes = static_cast<const unsigned char *>(mapping);
+    auto payload = reinterpret_cast<const char *>(bytes) + EntryHeaderSize;
+    bool good = size >= EntryHeaderSize
+        && memcmp(bytes, EntryMagic, 4) == 0
+        && (bytes[4] | bytes[5] << 8 | bytes[6] << 16 | static_cast<uint32_t>(bytes[7]) << 24) == EntryVersion
+        && read_u64(bytes + 8) == key.high
+        && read_u64(bytes + 16) == key.low
+        && read_u64(bytes + 32) == size - EntryHeaderSize
+        && read_u64(bytes + 24) == hash_bytes(payload, size - EntryHeaderSize, 0);
+    if (good) {
+        try {
+            entry->m_ast = BinaryAst { payload, size - EntryHeaderSize };
+        } catch (BinaryAst::FormatError &) {
+            good = false;
+        }
+    }
+    if (!good) {
+        unlink(entry_path.c_str());
+        m_rejected++;
+        m_misses++;
+        return {};
+    }
+
+    // for evict(), which goes by modification time
+    utimensat(AT_FDCWD, entry_path.c_str(), nullptr, 0);
+    m_hits++;
+    return entry;
+}
+
+SharedPtr<ParseCache::Entry> ParseCache::store(Key key, String binary) {
+    SharedPtr<Entry> entry = new Entry;
+    entry->m_binary = std::move(binary);
+    entry->m_ast = BinaryAst { entry->m_binary };
+    auto &bytes = entry->m_binary;
+
+    if (!make_directory())
+        return entry;
+
+    unsigned char header[EntryHeaderSize];
+    memcpy(header, EntryMagic, 4);
+    for (int i = 0; i < 4; i++)
+        header[4 + i] = (EntryVersion >> (i * 8)) & 0xff;
+    write_u64(header + 8, key.high);
+    write_u64(header + 16, key.low);
+    write_u64(header + 24, hash_bytes(bytes.c_str(), bytes.length(), 0));
+    write_u64(header + 32, bytes.length());
+
+    static std::atomic<unsigned> temporary_count { 0 };
+    auto entry_path = path(key);
+    auto temporary_path = String::format("{}.{}.{}.tmp", entry_path, String((long long)getpid()), String((long long)temporary_count++));
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return entry;
+    bool written = write_all(fd, reinterpret_cast<const char *>(header), EntryHeaderSize)
+        && write_all(fd, bytes.c_str(), bytes.length());
+    if (close(fd) != 0 || !written || rename(temporary_path.c_str(), entry_path.c_str()) != 0) {
+        unlink(temporary_path.c_str());
+        return entry;
+    }
+
+    if ((key.low & (EvictInterval - 1)) == 0)
+        evict();
+    return entry;
+}
+
+void ParseCache::evict() {
+    struct File {
+        String path;
+        time_t modified;
+        size_t size;
+    };
+    DIR *dir = opendir(m_directory.c_str());
+    if (!dir)
+        return;
+    std::vector<File> entries {};
+    size_t total = 0;
+    auto now = time(nullptr);
+    while (auto item = readdir(dir)) {
+        bool is_entry = ends_with(item->d_name, EntryExtension);
+        bool is_temporary = ends_with(item->d_name, ".tmp");
+        if (!is_entry && !is_temporary)
+            continue;
+        auto file_path = String::format("{}/{}", m_directory, item->d_name);
+        struct stat info;
+        if (stat(file_path.c_str(), &info) != 0)
+            continue;
+        if (is_temporary) {
+            if (now - info.st_mtime > StaleTemporaryAge)
+                unlink(file_path.c_str());
+            continue;
+        }
+        entries.push_back(File { file_path, info.st_mtime, static_cast<size_t>(info.st_size) });
+        total += info.st_size;
+    }
+    closedir(dir);
+    if (total <= m_max_size)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const File &a, const File &b) {
+        return a.modified < b.modified;
+    });
+    for (auto &file : entries) {
+        if (total <= m_max_size)
+            break;
+        if (unlink(file.path.c_str()) == 0 || errno == ENOENT)
+            total -= file.size;
+    }
+}
+
+String ParseCache::path(Key key) const {
+    char name[40];
+    snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)key.high, (unsigned long long)key.low);
+    return String::format("{}/{}{}", m_directory, name, EntryExtension);
+}
+
+// like mkdir -p
+bool ParseCache::make_directory() const {
+    struct stat info;
+    if (stat(m_directory.c_str(), &info) == 0)
+        return S_ISDIR(info.st_mode);
+    for (size_t i = 1; i <= m_directory.length(); i++) {
+        if (i < m_directory.length() && m_directory[i] != '/')
+            continue;
+        auto parent = m_directory.substring(0, i);
+        if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    }
+    return stat(m_directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+}
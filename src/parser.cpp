@@ -46,7 +46,7 @@ enum class Parser::Precedence {
     REF, // foo[1] / foo[1] = 2
 };
 
-bool Parser::higher_precedence(Token &token, SharedPtr<Node> left, Precedence current_precedence, IterAllow iter_allow) {
+bool Parser::higher_precedence(Token &token, NodePtr<Node> left, Precedence current_precedence, IterAllow iter_allow) {
     auto next_precedence = get_precedence(token, left);
 
     // printf("token %d, left %d, current_precedence %d, next_precedence %d\n", (int)token.type(), (int)left->type(), (int)current_precedence, (int)next_precedence);
@@ -92,7 +92,7 @@ bool Parser::higher_precedence(Token &token, SharedPtr<Node> left, Precedence cu
     return next_precedence > current_precedence;
 }
 
-Parser::Precedence Parser::get_precedence(Token &token, SharedPtr<Node> left) {
+Parser::Precedence Parser::get_precedence(Token &token, NodePtr<Node> left) {
     switch (token.type()) {
     case Token::Type::Plus:
         return left ? Precedence::SUM : Precedence::UNARY_PLUS;
@@ -198,7 +198,7 @@ Parser::Precedence Parser::get_precedence(Token &token, SharedPtr<Node> left) {
     return Precedence::LOWEST;
 }
 
-SharedPtr<Node> Parser::parse_expression(Parser::Precedence precedence, LocalsHashmap &locals, IterAllow iter_allow) {
+NodePtr<Node> Parser::parse_expression(Parser::Precedence precedence, LocalsHashmap &locals, IterAllow iter_allow) {
     skip_newlines();
 
     m_precedence_stack.push(precedence);
@@ -226,11 +226,12 @@ SharedPtr<Node> Parser::parse_expression(Parser::Precedence precedence, LocalsHa
     return left;
 }
 
-SharedPtr<Node> Parser::tree() {
+Tree Parser::tree() {
+    Arena::Scope arena_scope { *m_arena };
     skip_newlines();
-    SharedPtr<Node> tree = new BlockNode { current_token() };
+    NodePtr<Node> tree = new BlockNode { current_token() };
     validate_current_token();
-    LocalsHashmap locals { TM::HashType::TMString };
+    LocalsHashmap locals { m_symbols };
     skip_newlines();
     while (!current_token().is_eof()) {
         auto exp = parse_expression(Precedence::LOWEST, locals);
@@ -240,18 +241,65 @@ SharedPtr<Node> Parser::tree() {
     }
     if (tree->as_block_node().has_one_node())
         tree = tree->as_block_node().take_first_node();
-    return tree;
+    return Tree { tree, m_arena };
 }
 
-SharedPtr<BlockNode> Parser::parse_body(LocalsHashmap &locals, Precedence precedence, std::function<bool(Token::Type)> is_end, bool allow_rescue) {
+void Parser::check() {
+    skip_newlines();
+    validate_current_token();
+    LocalsHashmap locals { m_symbols };
+    skip_newlines();
+    while (!current_token().is_eof()) {
+        // each expression's nodes go as soon as it is parsed
+        Arena expression_arena;
+        Arena::Scope expression_scope { expression_arena };
+        parse_expression(Precedence::LOWEST, locals);
+        validate_current_token();
+        next_expression();
+    }
+}
+
+Vector<Parser::Statement> Parser::parse_statements(size_t start, const Vector<SharedPtr<String>> &names, std::function<bool(size_t, const Vector<Statement> &)> should_stop) {
+    Arena::Scope arena_scope { *m_arena };
+    if (start > 0)
+        m_lexer.seek(start);
+    LocalsHashmap locals { m_symbols };
+    for (auto &name : names)
+        locals.set(*name);
+    Vector<Statement> statements {};
+    skip_newlines();
+    validate_current_token();
+    while (!current_token().is_eof()) {
+        auto token = current_token();
+        auto line_index = m_lexer.line_index();
+        auto offset = line_index->line_start(token.line()) + token.column();
+        if (should_stop(offset, statements))
+            break;
+        Statement statement { offset, token, m_arena };
+        locals.record_new_names(&statement.new_locals);
+        statement.node = parse_expression(Precedence::LOWEST, locals);
+        locals.record_new_names(nullptr);
+        statements.push(statement);
+        validate_current_token();
+        next_expression();
+    }
+    return statements;
+}
+
+FlatAst Parser::flat_tree() {
+    auto node = tree();
+    return FlatAst { *node, m_symbols };
+}
+
+NodePtr<BlockNode> Parser::parse_body(LocalsHashmap &locals, Precedence precedence, std::function<bool(Token::Type)> is_end, bool allow_rescue) {
     m_call_depth.push(0);
-    SharedPtr<BlockNode> body = new BlockNode { current_token() };
+    NodePtr<BlockNode> body = new BlockNode { current_token() };
     validate_current_token();
     skip_newlines();
     while (!current_token().is_eof() && !is_end(current_token().type())) {
         if (allow_rescue && (current_token().is_rescue() || current_token().is_ensure())) {
             auto token = body->token();
-            SharedPtr<BeginNode> begin_node = new BeginNode { body->token(), body };
+            NodePtr<BeginNode> begin_node = new BeginNode { body->token(), body };
             parse_rest_of_begin(begin_node.ref(), locals);
             rewind(); // so the 'end' keyword can be consumed by our caller
             return new BlockNode { token, begin_node.static_cast_as<Node>() };
@@ -266,7 +314,7 @@ SharedPtr<BlockNode> Parser::parse_body(LocalsHashmap &locals, Precedence preced
     return body;
 }
 
-SharedPtr<BlockNode> Parser::parse_body(LocalsHashmap &locals, Precedence precedence, Token::Type end_token_type, bool allow_rescue) {
+NodePtr<BlockNode> Parser::parse_body(LocalsHashmap &locals, Precedence precedence, Token::Type end_token_type, bool allow_rescue) {
     return parse_body(
         locals,
         precedence,
@@ -274,7 +322,7 @@ SharedPtr<BlockNode> Parser::parse_body(LocalsHashmap &locals, Precedence preced
         allow_rescue);
 }
 
-SharedPtr<BlockNode> Parser::parse_def_body(LocalsHashmap &locals) {
+NodePtr<BlockNode> Parser::parse_def_body(LocalsHashmap &locals) {
     return parse_body(locals, Precedence::LOWEST, Token::Type::EndKeyword, true);
 }
 
@@ -292,11 +340,11 @@ void Parser::reinsert_collapsed_newline() {
         //     def bar; end
         //
         // So, we'll put the newline back.
-        m_tokens->insert(m_index, Token { Token::Type::Newline, token.file(), token.line(), token.column(), token.whitespace_precedes() });
+        insert_token(Token { Token::Type::Newline, token });
     }
 }
 
-SharedPtr<Node> Parser::parse_alias(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_alias(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto toktype = current_token().type();
@@ -337,7 +385,7 @@ SharedPtr<String> Parser::parse_valias_arg(bool allow_number, const char *expect
     }
 }
 
-SharedPtr<SymbolNode> Parser::parse_alias_arg(LocalsHashmap &locals, const char *expected_message) {
+NodePtr<SymbolNode> Parser::parse_alias_arg(LocalsHashmap &locals, const char *expected_message) {
     auto token = current_token();
     switch (token.type()) {
     case Token::Type::BareName:
@@ -357,15 +405,15 @@ SharedPtr<SymbolNode> Parser::parse_alias_arg(LocalsHashmap &locals, const char
     }
 }
 
-SharedPtr<Node> Parser::parse_array(LocalsHashmap &locals) {
-    SharedPtr<ArrayNode> array = new ArrayNode { current_token() };
+NodePtr<Node> Parser::parse_array(LocalsHashmap &locals) {
+    NodePtr<ArrayNode> array = new ArrayNode { current_token() };
     if (current_token().type() == Token::Type::LBracketRBracket) {
         advance();
         return array.static_cast_as<Node>();
     }
     advance(); // [
     m_call_depth.push(0);
-    auto add_node = [&]() -> SharedPtr<Node> {
+    auto add_node = [&]() -> NodePtr<Node> {
         auto token = current_token();
         if (token.is_rbracket()) {
             advance();
@@ -415,13 +463,13 @@ void Parser::parse_comma_separated_expressions(ArrayNode &array, LocalsHashmap &
     }
 }
 
-SharedPtr<Node> Parser::parse_back_ref(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_back_ref(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new BackRefNode { token, token.literal_string()->at(0) };
 }
 
-SharedPtr<Node> Parser::parse_begin(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_begin(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     next_expression();
@@ -430,7 +478,7 @@ SharedPtr<Node> Parser::parse_begin(LocalsHashmap &locals) {
     if (!is_end(current_token().type()))
         throw_unexpected("begin: rescue, else, ensure, or end");
 
-    SharedPtr<BeginNode> begin_node = new BeginNode { token, body };
+    NodePtr<BeginNode> begin_node = new BeginNode { token, body };
     parse_rest_of_begin(begin_node.ref(), locals);
 
     // a begin/end with nothing else just becomes a BlockNode
@@ -453,7 +501,7 @@ void Parser::parse_rest_of_begin(BeginNode &begin_node, LocalsHashmap &locals) {
     while (!current_token().is_eof() && !current_token().is_end_keyword()) {
         switch (current_token().type()) {
         case Token::Type::RescueKeyword: {
-            SharedPtr<BeginRescueNode> rescue_node = new BeginRescueNode { current_token() };
+            NodePtr<BeginRescueNode> rescue_node = new BeginRescueNode { current_token() };
             advance();
             if (!current_token().is_end_of_line() && current_token().type() != Token::Type::HashRocket) {
                 auto name = parse_expression(Precedence::BARE_CALL_ARG, locals);
@@ -502,7 +550,7 @@ void Parser::parse_rest_of_begin(BeginNode &begin_node, LocalsHashmap &locals) {
     advance();
 }
 
-SharedPtr<Node> Parser::parse_begin_block(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_begin_block(LocalsHashmap &locals) {
     bool is_top_level = m_precedence_stack.size() == 1;
     if (!is_top_level)
         throw SyntaxError { "BEGIN is permitted only at toplevel" };
@@ -513,7 +561,7 @@ SharedPtr<Node> Parser::parse_begin_block(LocalsHashmap &locals) {
     return parse_iter_expression(node, locals);
 }
 
-SharedPtr<Node> Parser::parse_beginless_range(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_beginless_range(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto end_node = parse_expression(Precedence::LOWEST, locals);
@@ -525,14 +573,14 @@ SharedPtr<Node> Parser::parse_beginless_range(LocalsHashmap &locals) {
     };
 }
 
-SharedPtr<Node> Parser::parse_block_pass(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_block_pass(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto value = parse_expression(Precedence::LOWEST, locals);
     return new BlockPassNode { token, value };
 }
 
-SharedPtr<Node> Parser::parse_bool(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_bool(LocalsHashmap &) {
     auto token = current_token();
     switch (current_token().type()) {
     case Token::Type::TrueKeyword:
@@ -546,7 +594,7 @@ SharedPtr<Node> Parser::parse_bool(LocalsHashmap &) {
     }
 }
 
-SharedPtr<Node> Parser::parse_break(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_break(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     if (current_token().is_lparen()) {
@@ -563,7 +611,7 @@ SharedPtr<Node> Parser::parse_break(LocalsHashmap &locals) {
     } else if (current_token().can_be_first_arg_of_implicit_call()) {
         auto value = parse_expression(Precedence::BARE_CALL_ARG, locals);
         if (current_token().is_comma()) {
-            SharedPtr<ArrayNode> array = new ArrayNode { token };
+            NodePtr<ArrayNode> array = new ArrayNode { token };
             array->add_node(value);
             while (current_token().is_comma()) {
                 advance();
@@ -576,10 +624,10 @@ SharedPtr<Node> Parser::parse_break(LocalsHashmap &locals) {
     return new BreakNode { token };
 }
 
-SharedPtr<Node> Parser::parse_case(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_case(LocalsHashmap &locals) {
     auto case_token = current_token();
     advance(); // case
-    SharedPtr<Node> subject;
+    NodePtr<Node> subject;
     switch (current_token().type()) {
     case Token::Type::WhenKeyword:
         subject = new NilNode { case_token };
@@ -593,13 +641,13 @@ SharedPtr<Node> Parser::parse_case(LocalsHashmap &locals) {
         subject = parse_expression(Precedence::CASE, locals);
         next_expression();
     }
-    SharedPtr<CaseNode> node = new CaseNode { case_token, subject };
+    NodePtr<CaseNode> node = new CaseNode { case_token, subject };
     while (!current_token().is_end_keyword()) {
         auto token = current_token();
         switch (token.type()) {
         case Token::Type::WhenKeyword: {
             advance();
-            SharedPtr<ArrayNode> condition_array = new ArrayNode { token };
+            NodePtr<ArrayNode> condition_array = new ArrayNode { token };
             parse_comma_separated_expressions(condition_array.ref(), locals);
             if (current_token().type() == Token::Type::ThenKeyword) {
                 advance();
@@ -614,7 +662,7 @@ SharedPtr<Node> Parser::parse_case(LocalsHashmap &locals) {
         }
         case Token::Type::InKeyword: {
             advance();
-            SharedPtr<Node> pattern = parse_case_in_patterns(locals);
+            NodePtr<Node> pattern = parse_case_in_patterns(locals);
             if (current_token().type() == Token::Type::ThenKeyword) {
                 advance();
                 skip_newlines();
@@ -631,7 +679,7 @@ SharedPtr<Node> Parser::parse_case(LocalsHashmap &locals) {
                 throw_unexpected("case 'when' or 'in'");
             advance();
             skip_newlines();
-            SharedPtr<BlockNode> body = parse_body(locals, Precedence::LOWEST);
+            NodePtr<BlockNode> body = parse_body(locals, Precedence::LOWEST);
             node->set_else_node(body);
             expect(Token::Type::EndKeyword, "case end");
             break;
@@ -645,9 +693,9 @@ SharedPtr<Node> Parser::parse_case(LocalsHashmap &locals) {
     return node.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_case_in_pattern(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_case_in_pattern(LocalsHashmap &locals) {
     auto token = current_token();
-    SharedPtr<Node> node;
+    NodePtr<Node> node;
     switch (token.type()) {
     case Token::Type::BareName: {
         advance();
@@ -683,7 +731,7 @@ SharedPtr<Node> Parser::parse_case_in_pattern(LocalsHashmap &locals) {
         break;
     case Token::Type::LBracket: {
         advance();
-        SharedPtr<ArrayPatternNode> array = new ArrayPatternNode { token };
+        NodePtr<ArrayPatternNode> array = new ArrayPatternNode { token };
         if (current_token().is_rbracket()) {
             advance();
             node = array.static_cast_as<Node>();
@@ -704,7 +752,7 @@ SharedPtr<Node> Parser::parse_case_in_pattern(LocalsHashmap &locals) {
     }
     case Token::Type::LCurlyBrace: {
         advance();
-        SharedPtr<HashPatternNode> hash = new HashPatternNode { token };
+        NodePtr<HashPatternNode> hash = new HashPatternNode { token };
         node = hash.static_cast_as<Node>();
         if (current_token().type() == Token::Type::RCurlyBrace) {
             advance();
@@ -766,7 +814,7 @@ SharedPtr<Node> Parser::parse_case_in_pattern(LocalsHashmap &locals) {
         break;
     }
     case Token::Type::StarStar: {
-        SharedPtr<HashPatternNode> hash = new HashPatternNode { token };
+        NodePtr<HashPatternNode> hash = new HashPatternNode { token };
         auto key = parse_case_in_pattern_hash_symbol_key(locals);
         hash->add_node(key);
         node = hash.static_cast_as<Node>();
@@ -798,8 +846,8 @@ SharedPtr<Node> Parser::parse_case_in_pattern(LocalsHashmap &locals) {
     return node;
 }
 
-SharedPtr<Node> Parser::parse_case_in_pattern_alternation(LocalsHashmap &locals) {
-    SharedPtr<ArrayPatternNode> array_pattern = new ArrayPatternNode { current_token() };
+NodePtr<Node> Parser::parse_case_in_pattern_alternation(LocalsHashmap &locals) {
+    NodePtr<ArrayPatternNode> array_pattern = new ArrayPatternNode { current_token() };
     array_pattern->add_node(parse_case_in_pattern(locals));
     while (current_token().is_comma()) {
         advance();
@@ -810,9 +858,9 @@ SharedPtr<Node> Parser::parse_case_in_pattern_alternation(LocalsHashmap &locals)
     return array_pattern.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_case_in_pattern_hash_symbol_key(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_case_in_pattern_hash_symbol_key(LocalsHashmap &locals) {
     auto token = current_token();
-    SharedPtr<Node> node;
+    NodePtr<Node> node;
     switch (token.type()) {
     case Token::Type::InterpolatedStringBegin:
         node = parse_interpolated_string(locals);
@@ -847,8 +895,8 @@ SharedPtr<Node> Parser::parse_case_in_pattern_hash_symbol_key(LocalsHashmap &loc
     return node;
 }
 
-SharedPtr<Node> Parser::parse_case_in_patterns(LocalsHashmap &locals) {
-    Vector<SharedPtr<Node>> patterns;
+NodePtr<Node> Parser::parse_case_in_patterns(LocalsHashmap &locals) {
+    ArenaVector<NodePtr<Node>> patterns;
     auto pattern = parse_case_in_pattern_alternation(locals);
     if (pattern->type() == Node::Type::Splat)
         pattern = new ArrayPatternNode { pattern->token(), pattern };
@@ -875,8 +923,8 @@ SharedPtr<Node> Parser::parse_case_in_patterns(LocalsHashmap &locals) {
     }
 }
 
-SharedPtr<BlockNode> Parser::parse_case_body(LocalsHashmap &locals, Token::Type type) {
-    SharedPtr<BlockNode> body = new BlockNode { current_token() };
+NodePtr<BlockNode> Parser::parse_case_body(LocalsHashmap &locals, Token::Type type) {
+    NodePtr<BlockNode> body = new BlockNode { current_token() };
     validate_current_token();
     skip_newlines();
     while (!current_token().is_eof() && current_token().type() != type && !current_token().is_else_keyword() && !current_token().is_end_keyword()) {
@@ -898,7 +946,7 @@ SharedPtr<BlockNode> Parser::parse_case_body(LocalsHashmap &locals, Token::Type
     return body;
 }
 
-SharedPtr<Node> Parser::parse_class_or_module_name(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_class_or_module_name(LocalsHashmap &locals) {
     auto name_token = current_token();
     auto exp = parse_expression(Precedence::LESS_GREATER, locals);
     switch (exp->type()) {
@@ -914,30 +962,30 @@ SharedPtr<Node> Parser::parse_class_or_module_name(LocalsHashmap &locals) {
     }
 }
 
-SharedPtr<Node> Parser::parse_class(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_class(LocalsHashmap &locals) {
     auto token = current_token();
     if (peek_token().type() == Token::Type::LeftShift)
         return parse_sclass(locals);
     advance();
-    LocalsHashmap our_locals { TM::HashType::TMString };
-    SharedPtr<Node> name = parse_class_or_module_name(our_locals);
-    SharedPtr<Node> superclass;
+    LocalsHashmap our_locals { m_symbols };
+    NodePtr<Node> name = parse_class_or_module_name(our_locals);
+    NodePtr<Node> superclass;
     if (current_token().type() == Token::Type::LessThan) {
         advance();
         superclass = parse_expression(Precedence::LOWEST, our_locals);
     } else {
         superclass = new NilNode { token };
     }
-    SharedPtr<BlockNode> body = parse_body(our_locals, Precedence::LOWEST, Token::Type::EndKeyword, true);
+    NodePtr<BlockNode> body = parse_body(our_locals, Precedence::LOWEST, Token::Type::EndKeyword, true);
     expect(Token::Type::EndKeyword, "class end");
     advance();
     return new ClassNode { token, name, superclass, body };
 };
 
-SharedPtr<Node> Parser::parse_multiple_assignment_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_multiple_assignment_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     if (!left->is_assignable())
         throw_unexpected("assignment =");
-    SharedPtr<MultipleAssignmentNode> list = new MultipleAssignmentNode { left->token() };
+    NodePtr<MultipleAssignmentNode> list = new MultipleAssignmentNode { left->token() };
     list->add_node(left);
     while (current_token().is_comma()) {
         advance();
@@ -951,9 +999,9 @@ SharedPtr<Node> Parser::parse_multiple_assignment_expression(SharedPtr<Node> lef
     return list.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_assignment_identifier(bool allow_splat, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_assignment_identifier(bool allow_splat, LocalsHashmap &locals) {
     auto token = current_token();
-    SharedPtr<Node> node;
+    NodePtr<Node> node;
     switch (token.type()) {
     case Token::Type::BareName:
     case Token::Type::ClassVariable:
@@ -1014,17 +1062,17 @@ SharedPtr<Node> Parser::parse_assignment_identifier(bool allow_splat, LocalsHash
     return node;
 }
 
-SharedPtr<Node> Parser::parse_constant(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_constant(LocalsHashmap &) {
     auto node = new ConstantNode { current_token() };
     advance();
     return node;
 };
 
-SharedPtr<Node> Parser::parse_def(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_def(LocalsHashmap &locals) {
     auto def_token = current_token();
     advance();
-    LocalsHashmap our_locals { TM::HashType::TMString };
-    SharedPtr<Node> self_node;
+    LocalsHashmap our_locals { m_symbols };
+    NodePtr<Node> self_node;
     SharedPtr<String> name = new String("");
     auto token = current_token();
     switch (token.type()) {
@@ -1064,7 +1112,7 @@ SharedPtr<Node> Parser::parse_def(LocalsHashmap &locals) {
         }
     }
     }
-    auto args = Vector<SharedPtr<Node>> {};
+    auto args = ArenaVector<NodePtr<Node>> {};
     if (current_token().is_lparen()) {
         advance();
         if (current_token().is_rparen()) {
@@ -1077,7 +1125,7 @@ SharedPtr<Node> Parser::parse_def(LocalsHashmap &locals) {
     } else if (current_token().can_be_first_arg_of_def()) {
         parse_def_args(args, our_locals);
     }
-    SharedPtr<BlockNode> body;
+    NodePtr<BlockNode> body;
     if (current_token().is_equal()) { // one-line method def
         advance(); // =
         if (name->ends_with("=") && !name->ends_with("=="))
@@ -1098,7 +1146,7 @@ SharedPtr<Node> Parser::parse_def(LocalsHashmap &locals) {
     };
 };
 
-SharedPtr<Node> Parser::parse_defined(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_defined(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     bool bare = true;
@@ -1114,7 +1162,7 @@ SharedPtr<Node> Parser::parse_defined(LocalsHashmap &locals) {
     return new DefinedNode { token, arg };
 }
 
-void Parser::parse_def_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &locals) {
+void Parser::parse_def_args(ArenaVector<NodePtr<Node>> &args, LocalsHashmap &locals) {
     parse_def_single_arg(args, locals, ArgsContext::Method);
     while (current_token().is_comma()) {
         advance();
@@ -1122,10 +1170,10 @@ void Parser::parse_def_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &locals
     }
 }
 
-SharedPtr<Node> Parser::parse_arg_default_value(LocalsHashmap &locals, IterAllow iter_allow) {
+NodePtr<Node> Parser::parse_arg_default_value(LocalsHashmap &locals, IterAllow iter_allow) {
     auto token = current_token();
     if (token.is_bare_name() && peek_token().is_equal()) {
-        SharedPtr<ArgNode> arg = new ArgNode { token, token.literal_string() };
+        NodePtr<ArgNode> arg = new ArgNode { token, token.literal_string() };
         advance();
         advance(); // =
         arg->add_to_locals(locals);
@@ -1136,7 +1184,7 @@ SharedPtr<Node> Parser::parse_arg_default_value(LocalsHashmap &locals, IterAllow
     }
 }
 
-void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &locals, ArgsContext context, IterAllow iter_allow) {
+void Parser::parse_def_single_arg(ArenaVector<NodePtr<Node>> &args, LocalsHashmap &locals, ArgsContext context, IterAllow iter_allow) {
     auto args_have_any_splat = [&]() { return !args.is_empty() && args.last()->type() == Node::Type::Arg && args.last().static_cast_as<ArgNode>()->splat_or_kwsplat(); };
     auto args_have_keyword = [&]() { return !args.is_empty() && args.last()->type() == Node::Type::KeywordArg; };
 
@@ -1149,7 +1197,7 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
     case Token::Type::BareName: {
         if (args_have_keyword())
             throw_error(token, "normal arg after keyword arg");
-        SharedPtr<ArgNode> arg = new ArgNode { token, token.literal_string() };
+        NodePtr<ArgNode> arg = new ArgNode { token, token.literal_string() };
         advance();
         arg->add_to_locals(locals);
         if (current_token().is_equal()) {
@@ -1163,7 +1211,7 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
     }
     case Token::Type::LParen: {
         advance();
-        auto sub_args = Vector<SharedPtr<Node>> {};
+        auto sub_args = ArenaVector<NodePtr<Node>> {};
         parse_def_args(sub_args, locals);
         expect(Token::Type::RParen, "nested args closing paren");
         advance();
@@ -1178,7 +1226,7 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
         if (args_have_any_splat())
             throw_error(token, "splat after keyword splat");
         advance();
-        SharedPtr<ArgNode> arg;
+        NodePtr<ArgNode> arg;
         if (current_token().is_bare_name()) {
             arg = new ArgNode { token, current_token().literal_string() };
             advance();
@@ -1192,7 +1240,7 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
     }
     case Token::Type::StarStar: {
         advance();
-        SharedPtr<ArgNode> arg;
+        NodePtr<ArgNode> arg;
         if (current_token().is_bare_name()) {
             arg = new ArgNode { token, current_token().literal_string() };
             advance();
@@ -1218,7 +1266,7 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
         return;
     }
     case Token::Type::SymbolKey: {
-        SharedPtr<KeywordArgNode> arg = new KeywordArgNode { token, current_token().literal_string() };
+        NodePtr<KeywordArgNode> arg = new KeywordArgNode { token, current_token().literal_string() };
         advance();
         switch (current_token().type()) {
         case Token::Type::Comma:
@@ -1241,7 +1289,7 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
     case Token::Type::DotDotDot: {
         if (context == ArgsContext::Block)
             throw_error(token, "arg forwarding (...) shorthand not allowed in block");
-        SharedPtr<ForwardArgsNode> arg = new ForwardArgsNode { token };
+        NodePtr<ForwardArgsNode> arg = new ForwardArgsNode { token };
         advance();
         arg->add_to_locals(locals);
         args.push(arg.static_cast_as<Node>());
@@ -1252,13 +1300,13 @@ void Parser::parse_def_single_arg(Vector<SharedPtr<Node>> &args, LocalsHashmap &
     }
 }
 
-SharedPtr<Node> Parser::parse_encoding(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_encoding(LocalsHashmap &) {
     auto token = current_token();
     advance(); // __ENCODING__
     return new EncodingNode { token };
 }
 
-SharedPtr<Node> Parser::parse_end_block(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_end_block(LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // END
     expect(Token::Type::LCurlyBrace, "END {}");
@@ -1266,7 +1314,7 @@ SharedPtr<Node> Parser::parse_end_block(LocalsHashmap &locals) {
     return parse_iter_expression(node, locals);
 }
 
-SharedPtr<Node> Parser::parse_modifier_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_modifier_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     switch (token.type()) {
     case Token::Type::IfKeyword: {
@@ -1282,7 +1330,7 @@ SharedPtr<Node> Parser::parse_modifier_expression(SharedPtr<Node> left, LocalsHa
     case Token::Type::UntilKeyword: {
         advance();
         auto condition = parse_expression(Precedence::LOWEST, locals);
-        SharedPtr<BlockNode> body;
+        NodePtr<BlockNode> body;
         bool pre = true;
         if (left->type() == Node::Type::Block) {
             body = left.static_cast_as<BlockNode>();
@@ -1296,7 +1344,7 @@ SharedPtr<Node> Parser::parse_modifier_expression(SharedPtr<Node> left, LocalsHa
     case Token::Type::WhileKeyword: {
         advance();
         auto condition = parse_expression(Precedence::LOWEST, locals);
-        SharedPtr<BlockNode> body;
+        NodePtr<BlockNode> body;
         bool pre = true;
         if (left->type() == Node::Type::Block) {
             body = left.static_cast_as<BlockNode>();
@@ -1312,19 +1360,19 @@ SharedPtr<Node> Parser::parse_modifier_expression(SharedPtr<Node> left, LocalsHa
     }
 }
 
-SharedPtr<Node> Parser::parse_file_constant(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_file_constant(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new StringNode { token, token.file() };
 }
 
-SharedPtr<Node> Parser::parse_line_constant(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_line_constant(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new FixnumNode { token, static_cast<long long>(token.line() + 1) };
 }
 
-SharedPtr<Node> Parser::parse_for(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_for(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto vars = parse_assignment_identifier(true, locals);
@@ -1346,16 +1394,16 @@ SharedPtr<Node> Parser::parse_for(LocalsHashmap &locals) {
     return new ForNode { token, expr, vars, body };
 }
 
-SharedPtr<Node> Parser::parse_forward_args(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_forward_args(LocalsHashmap &locals) {
     auto token = current_token();
     if (!locals.get("..."))
         throw_error(token, "forwarding args without ... shorthand in method definition");
     advance(); // ...
-    SharedPtr<ForwardArgsNode> node = new ForwardArgsNode { token };
+    NodePtr<ForwardArgsNode> node = new ForwardArgsNode { token };
     return node.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_group(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_group(LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // (
 
@@ -1365,7 +1413,7 @@ SharedPtr<Node> Parser::parse_group(LocalsHashmap &locals) {
     }
 
     auto body = parse_body(locals, Precedence::LOWEST, Token::Type::RParen, false);
-    SharedPtr<Node> exp;
+    NodePtr<Node> exp;
     if (body->has_one_node())
         exp = body->take_first_node();
     else
@@ -1391,11 +1439,11 @@ SharedPtr<Node> Parser::parse_group(LocalsHashmap &locals) {
     return exp;
 };
 
-SharedPtr<Node> Parser::parse_hash(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_hash(LocalsHashmap &locals) {
     expect(Token::Type::LCurlyBrace, "hash opening curly brace");
     auto token = current_token();
     advance();
-    SharedPtr<Node> hash;
+    NodePtr<Node> hash;
     if (current_token().type() == Token::Type::RCurlyBrace)
         hash = new HashNode { token, false };
     else
@@ -1405,11 +1453,11 @@ SharedPtr<Node> Parser::parse_hash(LocalsHashmap &locals) {
     return hash;
 }
 
-SharedPtr<Node> Parser::parse_hash_inner(LocalsHashmap &locals, Precedence precedence, Token::Type closing_token_type, bool bare, SharedPtr<Node> first_key) {
+NodePtr<Node> Parser::parse_hash_inner(LocalsHashmap &locals, Precedence precedence, Token::Type closing_token_type, bool bare, NodePtr<Node> first_key) {
     auto token = current_token();
-    SharedPtr<HashNode> hash = new HashNode { token, bare };
+    NodePtr<HashNode> hash = new HashNode { token, bare };
 
-    auto add_value = [&](SharedPtr<Node> key) {
+    auto add_value = [&](NodePtr<Node> key) {
         if (key->is_symbol_key()) {
             hash->add_node(parse_expression(precedence, locals));
         } else if (key->type() == Node::Type::KeywordSplat) {
@@ -1440,23 +1488,22 @@ SharedPtr<Node> Parser::parse_hash_inner(LocalsHashmap &locals, Precedence prece
     return hash.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_identifier(LocalsHashmap &locals) {
-    auto name = current_token().literal();
-    assert(name);
-    bool is_lvar = !!locals.get(name);
+NodePtr<Node> Parser::parse_identifier(LocalsHashmap &locals) {
+    assert(current_token().has_literal());
+    bool is_lvar = locals.get(current_token());
     auto identifier = new IdentifierNode { current_token(), is_lvar };
     advance();
     return identifier;
 };
 
-SharedPtr<Node> Parser::parse_if(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_if(LocalsHashmap &locals) {
     return parse_if_branch(locals, true);
 }
 
-SharedPtr<Node> Parser::parse_if_branch(LocalsHashmap &locals, bool parse_match_condition) {
+NodePtr<Node> Parser::parse_if_branch(LocalsHashmap &locals, bool parse_match_condition) {
     auto token = current_token();
     advance();
-    SharedPtr<Node> condition = parse_expression(Precedence::LOWEST, locals);
+    NodePtr<Node> condition = parse_expression(Precedence::LOWEST, locals);
     if (parse_match_condition && condition->type() == Node::Type::Regexp) {
         condition = new MatchNode { condition->token(), condition.static_cast_as<RegexpNode>() };
     }
@@ -1465,8 +1512,8 @@ SharedPtr<Node> Parser::parse_if_branch(LocalsHashmap &locals, bool parse_match_
     } else {
         next_expression();
     }
-    SharedPtr<Node> true_expr = parse_if_body(locals);
-    SharedPtr<Node> false_expr;
+    NodePtr<Node> true_expr = parse_if_body(locals);
+    NodePtr<Node> false_expr;
     if (current_token().is_elsif_keyword()) {
         false_expr = parse_if_branch(locals, false);
         return new IfNode { current_token(), condition, true_expr, false_expr };
@@ -1483,9 +1530,9 @@ SharedPtr<Node> Parser::parse_if_branch(LocalsHashmap &locals, bool parse_match_
     }
 }
 
-SharedPtr<Node> Parser::parse_if_body(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_if_body(LocalsHashmap &locals) {
     skip_newlines();
-    SharedPtr<BlockNode> body = new BlockNode { current_token() };
+    NodePtr<BlockNode> body = new BlockNode { current_token() };
     validate_current_token();
     skip_newlines();
     auto is_divider = [&]() {
@@ -1515,7 +1562,7 @@ void Parser::parse_interpolated_body(LocalsHashmap &locals, InterpolatedNode &no
         case Token::Type::EvaluateToStringBegin: {
             advance(); // #{
             skip_newlines();
-            SharedPtr<BlockNode> block = new BlockNode { current_token() };
+            NodePtr<BlockNode> block = new BlockNode { current_token() };
             while (current_token().type() != Token::Type::EvaluateToStringEnd) {
                 block->add_node(parse_expression(Precedence::LOWEST, locals));
                 skip_newlines();
@@ -1557,7 +1604,7 @@ void Parser::parse_interpolated_body(LocalsHashmap &locals, InterpolatedNode &no
     }
 };
 
-SharedPtr<Node> Parser::parse_interpolated_regexp(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_interpolated_regexp(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     if (current_token().type() == Token::Type::InterpolatedRegexpEnd) {
@@ -1580,7 +1627,7 @@ SharedPtr<Node> Parser::parse_interpolated_regexp(LocalsHashmap &locals) {
         advance();
         return regexp_node;
     } else {
-        SharedPtr<InterpolatedRegexpNode> interpolated_regexp = new InterpolatedRegexpNode { token };
+        NodePtr<InterpolatedRegexpNode> interpolated_regexp = new InterpolatedRegexpNode { token };
         parse_interpolated_body(locals, interpolated_regexp.ref(), Token::Type::InterpolatedRegexpEnd);
         if (current_token().has_literal()) {
             auto str = current_token().literal_string().ref();
@@ -1620,7 +1667,7 @@ int Parser::parse_regexp_options(String &options_string) {
     return options;
 }
 
-SharedPtr<Node> Parser::parse_interpolated_shell(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_interpolated_shell(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     if (current_token().type() == Token::Type::InterpolatedShellEnd) {
@@ -1633,14 +1680,14 @@ SharedPtr<Node> Parser::parse_interpolated_shell(LocalsHashmap &locals) {
         advance();
         return shell;
     } else {
-        SharedPtr<InterpolatedNode> interpolated_shell = new InterpolatedShellNode { token };
+        NodePtr<InterpolatedNode> interpolated_shell = new InterpolatedShellNode { token };
         parse_interpolated_body(locals, interpolated_shell.ref(), Token::Type::InterpolatedShellEnd);
         advance();
         return interpolated_shell.static_cast_as<Node>();
     }
 };
 
-static SharedPtr<Node> convert_string_to_symbol_key(SharedPtr<Node> string) {
+static NodePtr<Node> convert_string_to_symbol_key(NodePtr<Node> string) {
     switch (string->type()) {
     case Node::Type::String: {
         auto token = string->token();
@@ -1648,7 +1695,6 @@ static SharedPtr<Node> convert_string_to_symbol_key(SharedPtr<Node> string) {
         return new SymbolKeyNode { token, name };
     }
     case Node::Type::InterpolatedString: {
-        auto token = string->token();
         auto node = new InterpolatedSymbolKeyNode { *string.static_cast_as<InterpolatedStringNode>() };
         return node;
     }
@@ -1657,10 +1703,10 @@ static SharedPtr<Node> convert_string_to_symbol_key(SharedPtr<Node> string) {
     }
 }
 
-SharedPtr<Node> Parser::parse_interpolated_string(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_interpolated_string(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
-    SharedPtr<Node> string;
+    NodePtr<Node> string;
     if (current_token().type() == Token::Type::InterpolatedStringEnd) {
         string = new StringNode { token, new String };
         advance();
@@ -1669,7 +1715,7 @@ SharedPtr<Node> Parser::parse_interpolated_string(LocalsHashmap &locals) {
         advance();
         advance();
     } else {
-        SharedPtr<InterpolatedNode> interpolated_string = new InterpolatedStringNode { token };
+        NodePtr<InterpolatedNode> interpolated_string = new InterpolatedStringNode { token };
         parse_interpolated_body(locals, interpolated_string.ref(), Token::Type::InterpolatedStringEnd);
         advance();
         string = interpolated_string.static_cast_as<Node>();
@@ -1687,7 +1733,7 @@ SharedPtr<Node> Parser::parse_interpolated_string(LocalsHashmap &locals) {
     return string;
 };
 
-SharedPtr<Node> Parser::parse_interpolated_symbol(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_interpolated_symbol(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     if (current_token().type() == Token::Type::InterpolatedSymbolEnd) {
@@ -1700,16 +1746,16 @@ SharedPtr<Node> Parser::parse_interpolated_symbol(LocalsHashmap &locals) {
         advance();
         return symbol;
     } else {
-        SharedPtr<InterpolatedNode> interpolated_symbol = new InterpolatedSymbolNode { token };
+        NodePtr<InterpolatedNode> interpolated_symbol = new InterpolatedSymbolNode { token };
         parse_interpolated_body(locals, interpolated_symbol.ref(), Token::Type::InterpolatedSymbolEnd);
         advance();
         return interpolated_symbol.static_cast_as<Node>();
     }
 };
 
-SharedPtr<Node> Parser::parse_lit(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_lit(LocalsHashmap &) {
     auto token = current_token();
-    SharedPtr<Node> node;
+    NodePtr<Node> node;
     switch (token.type()) {
     case Token::Type::Bignum:
         advance();
@@ -1745,7 +1791,7 @@ SharedPtr<Node> Parser::parse_lit(LocalsHashmap &) {
     return node;
 };
 
-SharedPtr<Node> Parser::parse_keyword_splat(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_keyword_splat(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     return new KeywordSplatNode { token, parse_expression(Precedence::SPLAT, locals) };
@@ -1771,18 +1817,18 @@ SharedPtr<String> Parser::parse_method_name(LocalsHashmap &) {
     return name;
 }
 
-SharedPtr<Node> Parser::parse_module(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_module(LocalsHashmap &) {
     auto token = current_token();
     advance();
-    LocalsHashmap our_locals { TM::HashType::TMString };
-    SharedPtr<Node> name = parse_class_or_module_name(our_locals);
-    SharedPtr<BlockNode> body = parse_body(our_locals, Precedence::LOWEST, Token::Type::EndKeyword, true);
+    LocalsHashmap our_locals { m_symbols };
+    NodePtr<Node> name = parse_class_or_module_name(our_locals);
+    NodePtr<BlockNode> body = parse_body(our_locals, Precedence::LOWEST, Token::Type::EndKeyword, true);
     expect(Token::Type::EndKeyword, "module end");
     advance();
     return new ModuleNode { token, name, body };
 }
 
-SharedPtr<Node> Parser::parse_next(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_next(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     if (current_token().is_lparen()) {
@@ -1791,7 +1837,7 @@ SharedPtr<Node> Parser::parse_next(LocalsHashmap &locals) {
             advance();
             return new NextNode { token, new NilSexpNode { token } };
         } else {
-            SharedPtr<Node> arg = parse_expression(Precedence::BARE_CALL_ARG, locals);
+            NodePtr<Node> arg = parse_expression(Precedence::BARE_CALL_ARG, locals);
             expect(Token::Type::RParen, "break closing paren");
             advance();
             return new NextNode { token, arg };
@@ -1799,7 +1845,7 @@ SharedPtr<Node> Parser::parse_next(LocalsHashmap &locals) {
     } else if (current_token().can_be_first_arg_of_implicit_call()) {
         auto value = parse_expression(Precedence::BARE_CALL_ARG, locals);
         if (current_token().is_comma()) {
-            SharedPtr<ArrayNode> array = new ArrayNode { token };
+            NodePtr<ArrayNode> array = new ArrayNode { token };
             array->add_node(value);
             while (current_token().is_comma()) {
                 advance();
@@ -1812,13 +1858,13 @@ SharedPtr<Node> Parser::parse_next(LocalsHashmap &locals) {
     return new NextNode { token };
 }
 
-SharedPtr<Node> Parser::parse_nil(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_nil(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new NilSexpNode { token };
 }
 
-SharedPtr<Node> Parser::parse_not(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_not(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto precedence = get_precedence(token);
@@ -1829,13 +1875,13 @@ SharedPtr<Node> Parser::parse_not(LocalsHashmap &locals) {
     return node;
 }
 
-SharedPtr<Node> Parser::parse_nth_ref(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_nth_ref(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new NthRefNode { token, token.get_fixnum() };
 }
 
-void Parser::parse_proc_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &locals, IterAllow iter_allow) {
+void Parser::parse_proc_args(ArenaVector<NodePtr<Node>> &args, LocalsHashmap &locals, IterAllow iter_allow) {
     if (current_token().is_semicolon()) {
         parse_shadow_variables_in_args(args, locals);
         return;
@@ -1851,22 +1897,22 @@ void Parser::parse_proc_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &local
     }
 }
 
-SharedPtr<Node> Parser::parse_redo(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_redo(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new RedoNode { token };
 }
 
-SharedPtr<Node> Parser::parse_retry(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_retry(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new RetryNode { token };
 }
 
-SharedPtr<Node> Parser::parse_return(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_return(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
-    SharedPtr<Node> value;
+    NodePtr<Node> value;
     if (current_token().is_end_of_expression()) {
         value = new NilNode { token };
     } else {
@@ -1877,7 +1923,7 @@ SharedPtr<Node> Parser::parse_return(LocalsHashmap &locals) {
     if (current_token().is_hash_rocket()) {
         value = parse_call_hash_args(locals, true, Token::Type::RParen, value);
     } else if (current_token().is_comma()) {
-        SharedPtr<ArrayNode> array = new ArrayNode { current_token() };
+        NodePtr<ArrayNode> array = new ArrayNode { current_token() };
         array->add_node(value);
         while (current_token().is_comma()) {
             advance();
@@ -1893,27 +1939,27 @@ SharedPtr<Node> Parser::parse_return(LocalsHashmap &locals) {
     return new ReturnNode { token, value };
 };
 
-SharedPtr<Node> Parser::parse_sclass(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_sclass(LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // class
     advance(); // <<
-    SharedPtr<Node> klass = parse_expression(Precedence::BARE_CALL_ARG, locals);
-    SharedPtr<BlockNode> body = parse_body(locals, Precedence::LOWEST);
+    NodePtr<Node> klass = parse_expression(Precedence::BARE_CALL_ARG, locals);
+    NodePtr<BlockNode> body = parse_body(locals, Precedence::LOWEST);
     expect(Token::Type::EndKeyword, "sclass end");
     advance();
     return new SclassNode { token, klass, body };
 }
 
-SharedPtr<Node> Parser::parse_self(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_self(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new SelfNode { token };
 }
 
-void Parser::parse_shadow_variables_in_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &locals) {
+void Parser::parse_shadow_variables_in_args(ArenaVector<NodePtr<Node>> &args, LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // ;
-    SharedPtr<ShadowArgNode> shadow_arg = new ShadowArgNode { token };
+    NodePtr<ShadowArgNode> shadow_arg = new ShadowArgNode { token };
     shadow_arg->add_name(parse_shadow_variable_single_arg());
     while (current_token().is_comma()) {
         advance(); // ,
@@ -1936,7 +1982,7 @@ SharedPtr<String> Parser::parse_shadow_variable_single_arg() {
     }
 }
 
-SharedPtr<Node> Parser::parse_splat(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_splat(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     if (current_token().is_comma() || current_token().is_equal())
@@ -1945,11 +1991,11 @@ SharedPtr<Node> Parser::parse_splat(LocalsHashmap &locals) {
     return new SplatNode { token, parse_expression(Precedence::SPLAT, locals) };
 };
 
-SharedPtr<Node> Parser::parse_stabby_proc(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_stabby_proc(LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // ->
     bool has_args = false;
-    auto args = Vector<SharedPtr<Node>> {};
+    auto args = ArenaVector<NodePtr<Node>> {};
     if (current_token().is_lparen()) {
         has_args = true;
         advance(); // (
@@ -1974,9 +2020,9 @@ SharedPtr<Node> Parser::parse_stabby_proc(LocalsHashmap &locals) {
     return parse_iter_expression(proc, locals);
 };
 
-SharedPtr<Node> Parser::parse_string(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_string(LocalsHashmap &locals) {
     auto string_token = current_token();
-    SharedPtr<Node> string = new StringNode { string_token, string_token.literal_string() };
+    NodePtr<Node> string = new StringNode { string_token, string_token.literal_string() };
     advance();
 
     bool adjacent_strings_were_appended = false;
@@ -1991,7 +2037,7 @@ SharedPtr<Node> Parser::parse_string(LocalsHashmap &locals) {
     return string;
 };
 
-SharedPtr<Node> Parser::concat_adjacent_strings(SharedPtr<Node> string, LocalsHashmap &locals, bool &strings_were_appended) {
+NodePtr<Node> Parser::concat_adjacent_strings(NodePtr<Node> string, LocalsHashmap &locals, bool &strings_were_appended) {
     auto token = current_token();
     while (token.type() == Token::Type::String || token.type() == Token::Type::InterpolatedStringBegin) {
         switch (token.type()) {
@@ -2014,7 +2060,7 @@ SharedPtr<Node> Parser::concat_adjacent_strings(SharedPtr<Node> string, LocalsHa
     return string;
 }
 
-SharedPtr<Node> Parser::append_string_nodes(SharedPtr<Node> string1, SharedPtr<Node> string2) {
+NodePtr<Node> Parser::append_string_nodes(NodePtr<Node> string1, NodePtr<Node> string2) {
     if (!string2->can_be_concatenated_to_a_string())
         throw_unexpected("another string");
     switch (string1->type()) {
@@ -2032,7 +2078,7 @@ SharedPtr<Node> Parser::append_string_nodes(SharedPtr<Node> string1, SharedPtr<N
     return string1;
 }
 
-SharedPtr<Node> Parser::parse_super(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_super(LocalsHashmap &) {
     auto token = current_token();
     advance();
     auto node = new SuperNode { token };
@@ -2041,21 +2087,21 @@ SharedPtr<Node> Parser::parse_super(LocalsHashmap &) {
     return node;
 };
 
-SharedPtr<Node> Parser::parse_symbol(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_symbol(LocalsHashmap &) {
     auto token = current_token();
     auto symbol = new SymbolNode { token, current_token().literal_string() };
     advance();
     return symbol;
 };
 
-SharedPtr<Node> Parser::parse_symbol_key(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_symbol_key(LocalsHashmap &) {
     auto token = current_token();
     auto symbol = new SymbolKeyNode { token, current_token().literal_string() };
     advance();
     return symbol;
 };
 
-SharedPtr<Node> Parser::parse_top_level_constant(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_top_level_constant(LocalsHashmap &) {
     auto token = current_token();
     advance();
     auto name_token = current_token();
@@ -2072,7 +2118,7 @@ SharedPtr<Node> Parser::parse_top_level_constant(LocalsHashmap &) {
     return new Colon3Node { token, name };
 }
 
-SharedPtr<Node> Parser::parse_unary_operator(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_unary_operator(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto precedence = get_precedence(token);
@@ -2131,18 +2177,18 @@ SharedPtr<Node> Parser::parse_unary_operator(LocalsHashmap &locals) {
     return new UnaryOpNode { token, message, receiver };
 }
 
-SharedPtr<Node> Parser::parse_undef(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_undef(LocalsHashmap &locals) {
     auto undef_token = current_token();
     advance();
-    SharedPtr<UndefNode> undef_node = new UndefNode { undef_token };
+    NodePtr<UndefNode> undef_node = new UndefNode { undef_token };
     auto arg = parse_alias_arg(locals, "method name for undef");
     undef_node->add_arg(arg.static_cast_as<Node>());
     if (current_token().is_comma()) {
-        SharedPtr<BlockNode> block = new BlockNode { undef_token };
+        NodePtr<BlockNode> block = new BlockNode { undef_token };
         block->add_node(undef_node.static_cast_as<Node>());
         while (current_token().is_comma()) {
             advance();
-            SharedPtr<UndefNode> undef_node = new UndefNode { undef_token };
+            NodePtr<UndefNode> undef_node = new UndefNode { undef_token };
             auto arg = parse_alias_arg(locals, "method name for undef");
             undef_node->add_arg(arg.static_cast_as<Node>());
             block->add_node(undef_node.static_cast_as<Node>());
@@ -2154,9 +2200,9 @@ SharedPtr<Node> Parser::parse_undef(LocalsHashmap &locals) {
     return undef_node.static_cast_as<Node>();
 };
 
-SharedPtr<Node> Parser::parse_word_array(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_word_array(LocalsHashmap &locals) {
     auto token = current_token();
-    SharedPtr<ArrayNode> array = new ArrayNode { token };
+    NodePtr<ArrayNode> array = new ArrayNode { token };
     advance();
     while (!current_token().is_eof() && !current_token().is_rbracket()) {
         if (current_token().type() == Token::Type::UnterminatedWordArray)
@@ -2168,13 +2214,13 @@ SharedPtr<Node> Parser::parse_word_array(LocalsHashmap &locals) {
     return array.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_word_symbol_array(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_word_symbol_array(LocalsHashmap &locals) {
     auto token = current_token();
-    SharedPtr<ArrayNode> array = new ArrayNode { token };
+    NodePtr<ArrayNode> array = new ArrayNode { token };
     advance();
     while (!current_token().is_eof() && !current_token().is_rbracket()) {
         auto string = parse_expression(Precedence::WORD_ARRAY, locals);
-        SharedPtr<Node> symbol_node;
+        NodePtr<Node> symbol_node;
         switch (string->type()) {
         case Node::Type::String:
             symbol_node = string.static_cast_as<StringNode>()->to_symbol_node().static_cast_as<Node>();
@@ -2192,21 +2238,21 @@ SharedPtr<Node> Parser::parse_word_symbol_array(LocalsHashmap &locals) {
     return array.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_yield(LocalsHashmap &) {
+NodePtr<Node> Parser::parse_yield(LocalsHashmap &) {
     auto token = current_token();
     advance();
     return new YieldNode { token };
 };
 
-SharedPtr<Node> Parser::parse_assignment_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_assignment_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     return parse_assignment_expression(left, locals, true);
 }
 
-SharedPtr<Node> Parser::parse_assignment_expression_without_multiple_values(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_assignment_expression_without_multiple_values(NodePtr<Node> left, LocalsHashmap &locals) {
     return parse_assignment_expression(left, locals, false);
 }
 
-SharedPtr<Node> Parser::parse_assignment_expression(SharedPtr<Node> left, LocalsHashmap &locals, bool allow_multiple) {
+NodePtr<Node> Parser::parse_assignment_expression(NodePtr<Node> left, LocalsHashmap &locals, bool allow_multiple) {
     auto token = current_token();
     if (left->type() == Node::Type::Splat) {
         return parse_multiple_assignment_expression(left, locals);
@@ -2218,7 +2264,7 @@ SharedPtr<Node> Parser::parse_assignment_expression(SharedPtr<Node> left, Locals
     return new AssignmentNode { token, left, value };
 }
 
-void Parser::add_assignment_locals(SharedPtr<Node> left, LocalsHashmap &locals) {
+void Parser::add_assignment_locals(NodePtr<Node> left, LocalsHashmap &locals) {
     switch (left->type()) {
     case Node::Type::Identifier: {
         auto left_identifier = left.static_cast_as<IdentifierNode>();
@@ -2240,13 +2286,13 @@ void Parser::add_assignment_locals(SharedPtr<Node> left, LocalsHashmap &locals)
     }
 }
 
-SharedPtr<Node> Parser::parse_assignment_expression_value(bool to_array, LocalsHashmap &locals, bool allow_multiple) {
+NodePtr<Node> Parser::parse_assignment_expression_value(bool to_array, LocalsHashmap &locals, bool allow_multiple) {
     auto token = current_token();
     auto value = parse_expression(Precedence::ASSIGNMENT_RHS, locals);
     bool is_splat;
 
     if (allow_multiple && current_token().type() == Token::Type::Comma) {
-        SharedPtr<ArrayNode> array = new ArrayNode { token };
+        NodePtr<ArrayNode> array = new ArrayNode { token };
         array->add_node(value);
         while (current_token().type() == Token::Type::Comma) {
             advance();
@@ -2281,12 +2327,12 @@ SharedPtr<Node> Parser::parse_assignment_expression_value(bool to_array, LocalsH
     }
 }
 
-SharedPtr<Node> Parser::parse_iter_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_iter_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
-    LocalsHashmap our_locals { locals }; // copy!
+    LocalsHashmap our_locals { &locals };
     bool curly_brace = current_token().type() == Token::Type::LCurlyBrace;
     bool has_args = false;
-    auto args = Vector<SharedPtr<Node>> {};
+    auto args = ArenaVector<NodePtr<Node>> {};
 
     if (curly_brace) {
         if (left->type() == Node::Type::Call && !left.static_cast_as<CallNode>()->args().is_empty() && !previous_token().is_rparen())
@@ -2320,7 +2366,7 @@ SharedPtr<Node> Parser::parse_iter_expression(SharedPtr<Node> left, LocalsHashma
     } else {
         throw_unexpected(left->token(), "call to accept block");
     }
-    SharedPtr<BlockNode> body = parse_iter_body(our_locals, curly_brace);
+    NodePtr<BlockNode> body = parse_iter_body(our_locals, curly_brace);
     auto end_token_type = curly_brace ? Token::Type::RCurlyBrace : Token::Type::EndKeyword;
     expect(end_token_type, curly_brace ? "}" : "end");
     advance();
@@ -2333,7 +2379,7 @@ SharedPtr<Node> Parser::parse_iter_expression(SharedPtr<Node> left, LocalsHashma
     };
 }
 
-void Parser::parse_iter_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &locals) {
+void Parser::parse_iter_args(ArenaVector<NodePtr<Node>> &args, LocalsHashmap &locals) {
     if (current_token().is_semicolon()) {
         parse_shadow_variables_in_args(args, locals);
         return;
@@ -2354,14 +2400,14 @@ void Parser::parse_iter_args(Vector<SharedPtr<Node>> &args, LocalsHashmap &local
     }
 }
 
-SharedPtr<BlockNode> Parser::parse_iter_body(LocalsHashmap &locals, bool curly_brace) {
+NodePtr<BlockNode> Parser::parse_iter_body(LocalsHashmap &locals, bool curly_brace) {
     auto end_token_type = curly_brace ? Token::Type::RCurlyBrace : Token::Type::EndKeyword;
     return parse_body(locals, Precedence::LOWEST, end_token_type, true); // FIXME: allow_rescue only for do/end
 }
 
-SharedPtr<Node> Parser::parse_call_expression_with_parens(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_call_expression_with_parens(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token(); // (
-    SharedPtr<NodeWithArgs> call_node = to_node_with_args(left);
+    NodePtr<NodeWithArgs> call_node = to_node_with_args(left);
     advance();
     if (current_token().is_rparen()) {
         // foo () vs foo()
@@ -2375,7 +2421,7 @@ SharedPtr<Node> Parser::parse_call_expression_with_parens(SharedPtr<Node> left,
     return call_node.static_cast_as<Node>();
 }
 
-SharedPtr<NodeWithArgs> Parser::to_node_with_args(SharedPtr<Node> node) {
+NodePtr<NodeWithArgs> Parser::to_node_with_args(NodePtr<Node> node) {
     switch (node->type()) {
     case Node::Type::Identifier: {
         auto identifier = node.static_cast_as<IdentifierNode>();
@@ -2437,9 +2483,9 @@ void Parser::parse_call_args(NodeWithArgs &node, LocalsHashmap &locals, bool bar
         m_call_depth.last()--;
 }
 
-SharedPtr<Node> Parser::parse_call_hash_args(LocalsHashmap &locals, bool bare_call, Token::Type closing_token_type, SharedPtr<Node> first_arg) {
+NodePtr<Node> Parser::parse_call_hash_args(LocalsHashmap &locals, bool bare_call, Token::Type closing_token_type, NodePtr<Node> first_arg) {
     bool bare_hash = true; // we got here via foo(1, a: 'b') so it's always a "bare" hash
-    SharedPtr<Node> hash;
+    NodePtr<Node> hash;
     if (bare_call)
         hash = parse_hash_inner(locals, Precedence::BARE_CALL_ARG, closing_token_type, bare_hash, first_arg);
     else
@@ -2449,9 +2495,9 @@ SharedPtr<Node> Parser::parse_call_hash_args(LocalsHashmap &locals, bool bare_ca
     return hash;
 }
 
-SharedPtr<Node> Parser::parse_call_expression_without_parens(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_call_expression_without_parens(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
-    SharedPtr<NodeWithArgs> call_node = to_node_with_args(left);
+    NodePtr<NodeWithArgs> call_node = to_node_with_args(left);
     switch (token.type()) {
     case Token::Type::Comma:
     case Token::Type::Eof:
@@ -2467,11 +2513,10 @@ SharedPtr<Node> Parser::parse_call_expression_without_parens(SharedPtr<Node> lef
     return call_node.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_constant_resolution_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
-    auto token = current_token();
+NodePtr<Node> Parser::parse_constant_resolution_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     advance();
     auto name_token = current_token();
-    SharedPtr<Node> node;
+    NodePtr<Node> node;
     switch (name_token.type()) {
     case Token::Type::BareName:
     case Token::Type::OperatorName:
@@ -2484,7 +2529,7 @@ SharedPtr<Node> Parser::parse_constant_resolution_expression(SharedPtr<Node> lef
         break;
     case Token::Type::LParen: {
         advance();
-        SharedPtr<CallNode> call_node = new CallNode { name_token, left, new String("call") };
+        NodePtr<CallNode> call_node = new CallNode { name_token, left, new String("call") };
         if (!current_token().is_rparen())
             parse_call_args(call_node.ref(), locals, false);
         expect(Token::Type::RParen, "::() call right paren");
@@ -2503,7 +2548,7 @@ SharedPtr<Node> Parser::parse_constant_resolution_expression(SharedPtr<Node> lef
     return node;
 }
 
-SharedPtr<Node> Parser::parse_infix_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_infix_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     auto op = current_token();
     auto precedence = get_precedence(token, left);
@@ -2518,7 +2563,7 @@ SharedPtr<Node> Parser::parse_infix_expression(SharedPtr<Node> left, LocalsHashm
     return node;
 };
 
-SharedPtr<Node> Parser::parse_logical_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_logical_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     switch (token.type()) {
     case Token::Type::AmpersandAmpersand: {
@@ -2562,7 +2607,7 @@ SharedPtr<Node> Parser::parse_logical_expression(SharedPtr<Node> left, LocalsHas
     }
 }
 
-SharedPtr<Node> Parser::parse_match_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_match_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     advance();
     auto arg = parse_expression(Precedence::EQUALITY, locals);
@@ -2581,13 +2626,13 @@ SharedPtr<Node> Parser::parse_match_expression(SharedPtr<Node> left, LocalsHashm
     }
 }
 
-SharedPtr<Node> Parser::parse_not_match_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_not_match_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     left = parse_match_expression(left, locals);
     return new NotMatchNode { token, left };
 }
 
-SharedPtr<Node> Parser::parse_op_assign_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_op_assign_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     if (left->type() == Node::Type::Call || left->type() == Node::Type::SafeCall)
         return parse_op_attr_assign_expression(left, locals);
     switch (left->type()) {
@@ -2631,7 +2676,7 @@ SharedPtr<Node> Parser::parse_op_assign_expression(SharedPtr<Node> left, LocalsH
     }
 }
 
-SharedPtr<Node> Parser::parse_op_attr_assign_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_op_attr_assign_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     if (left->type() != Node::Type::Call && left->type() != Node::Type::SafeCall)
         throw_unexpected(left->token(), "call");
     auto left_call = left.static_cast_as<CallNode>();
@@ -2671,10 +2716,10 @@ SharedPtr<Node> Parser::parse_op_attr_assign_expression(SharedPtr<Node> left, Lo
     return op_node;
 }
 
-SharedPtr<Node> Parser::parse_proc_call_expression(SharedPtr<Node> left, LocalsHashmap &) {
+NodePtr<Node> Parser::parse_proc_call_expression(NodePtr<Node> left, LocalsHashmap &) {
     auto token = current_token();
     advance(); // .
-    SharedPtr<Node> call_node = new CallNode {
+    NodePtr<Node> call_node = new CallNode {
         token,
         left,
         new String("call"),
@@ -2682,28 +2727,30 @@ SharedPtr<Node> Parser::parse_proc_call_expression(SharedPtr<Node> left, LocalsH
     return call_node.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_range_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_range_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // .. or ...
     skip_newlines();
-    SharedPtr<Node> right;
+    NodePtr<Node> right;
     if (current_token().can_be_range_arg_token()) {
         right = parse_expression(Precedence::RANGE, locals);
     } else {
         // endless range
         right = new NilNode { token };
         // HACK: insert a newline here so subsequent expressions parse ok
-        if (!current_token().can_follow_collapsible_newline())
-            m_tokens->insert(m_index, Token { Token::Type::Newline, current_token().file(), current_token().line(), current_token().column(), current_token().whitespace_precedes() });
+        if (!current_token().can_follow_collapsible_newline()) {
+            auto current = current_token();
+            insert_token(Token { Token::Type::Newline, current });
+        }
     }
 
     return new RangeNode { token, left, right, token.type() == Token::Type::DotDotDot };
 }
 
-SharedPtr<Node> Parser::parse_ref_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_ref_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     advance();
-    SharedPtr<CallNode> call_node = new CallNode {
+    NodePtr<CallNode> call_node = new CallNode {
         token,
         left,
         new String("[]"),
@@ -2718,7 +2765,7 @@ SharedPtr<Node> Parser::parse_ref_expression(SharedPtr<Node> left, LocalsHashmap
     return call_node.static_cast_as<Node>();
 }
 
-SharedPtr<Node> Parser::parse_rescue_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_rescue_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     advance(); // rescue
     auto value = parse_expression(Precedence::LOWEST, locals);
@@ -2730,7 +2777,7 @@ SharedPtr<Node> Parser::parse_rescue_expression(SharedPtr<Node> left, LocalsHash
     return begin_node;
 }
 
-SharedPtr<Node> Parser::parse_safe_send_expression(SharedPtr<Node> left, LocalsHashmap &) {
+NodePtr<Node> Parser::parse_safe_send_expression(NodePtr<Node> left, LocalsHashmap &) {
     auto token = current_token();
     advance(); // &.
     auto name_token = current_token();
@@ -2760,7 +2807,7 @@ SharedPtr<Node> Parser::parse_safe_send_expression(SharedPtr<Node> left, LocalsH
     };
 }
 
-SharedPtr<Node> Parser::parse_send_expression(SharedPtr<Node> left, LocalsHashmap &) {
+NodePtr<Node> Parser::parse_send_expression(NodePtr<Node> left, LocalsHashmap &) {
     auto dot_token = current_token();
     advance();
     auto name_token = current_token();
@@ -2787,27 +2834,27 @@ SharedPtr<Node> Parser::parse_send_expression(SharedPtr<Node> left, LocalsHashma
     };
 }
 
-SharedPtr<Node> Parser::parse_ternary_expression(SharedPtr<Node> left, LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_ternary_expression(NodePtr<Node> left, LocalsHashmap &locals) {
     auto token = current_token();
     expect(Token::Type::TernaryQuestion, "ternary question");
     advance();
-    SharedPtr<Node> true_expr = parse_expression(Precedence::TERNARY_TRUE, locals);
+    NodePtr<Node> true_expr = parse_expression(Precedence::TERNARY_TRUE, locals);
     expect(Token::Type::TernaryColon, "ternary colon");
     advance();
     auto false_expr = parse_expression(Precedence::TERNARY_FALSE, locals);
     return new IfNode { token, left, true_expr, false_expr };
 }
 
-SharedPtr<Node> Parser::parse_triple_dot(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_triple_dot(LocalsHashmap &locals) {
     if (peek_token().is_rparen())
         return parse_forward_args(locals);
     return parse_beginless_range(locals);
 }
 
-SharedPtr<Node> Parser::parse_unless(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_unless(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
-    SharedPtr<Node> condition = parse_expression(Precedence::LOWEST, locals);
+    NodePtr<Node> condition = parse_expression(Precedence::LOWEST, locals);
     if (condition->type() == Node::Type::Regexp) {
         condition = new MatchNode { condition->token(), condition.static_cast_as<RegexpNode>() };
     }
@@ -2816,8 +2863,8 @@ SharedPtr<Node> Parser::parse_unless(LocalsHashmap &locals) {
     } else {
         next_expression();
     }
-    SharedPtr<Node> false_expr = parse_if_body(locals);
-    SharedPtr<Node> true_expr;
+    NodePtr<Node> false_expr = parse_if_body(locals);
+    NodePtr<Node> true_expr;
     if (current_token().is_else_keyword()) {
         advance();
         true_expr = parse_if_body(locals);
@@ -2829,10 +2876,10 @@ SharedPtr<Node> Parser::parse_unless(LocalsHashmap &locals) {
     return new IfNode { token, condition, true_expr, false_expr };
 }
 
-SharedPtr<Node> Parser::parse_while(LocalsHashmap &locals) {
+NodePtr<Node> Parser::parse_while(LocalsHashmap &locals) {
     auto token = current_token();
     advance();
-    SharedPtr<Node> condition = parse_expression(Precedence::LOWEST, locals, IterAllow::CURLY_ONLY);
+    NodePtr<Node> condition = parse_expression(Precedence::LOWEST, locals, IterAllow::CURLY_ONLY);
     if (condition->type() == Node::Type::Regexp) {
         condition = new MatchNode { condition->token(), condition.static_cast_as<RegexpNode>() };
     }
@@ -2841,7 +2888,7 @@ SharedPtr<Node> Parser::parse_while(LocalsHashmap &locals) {
     } else {
         next_expression();
     }
-    SharedPtr<BlockNode> body = parse_body(locals, Precedence::LOWEST);
+    NodePtr<BlockNode> body = parse_body(locals, Precedence::LOWEST);
     expect(Token::Type::EndKeyword, "while end");
     advance();
     switch (token.type()) {
@@ -2979,7 +3026,7 @@ Parser::parse_null_fn Parser::null_denotation(Token::Type type) {
     }
 }
 
-Parser::parse_left_fn Parser::left_denotation(Token &token, SharedPtr<Node> left, Precedence precedence) {
+Parser::parse_left_fn Parser::left_denotation(Token &token, NodePtr<Node> left, Precedence precedence) {
     using Type = Token::Type;
     switch (token.type()) {
     case Type::Equal:
@@ -3080,28 +3127,62 @@ Parser::parse_left_fn Parser::left_denotation(Token &token, SharedPtr<Node> left
     return {};
 }
 
-bool Parser::is_first_arg_of_call_without_parens(SharedPtr<Node> left, Token &token) {
+bool Parser::is_first_arg_of_call_without_parens(NodePtr<Node> left, Token &token) {
     return left->is_callable() && token.can_be_first_arg_of_implicit_call();
 }
 
-Token &Parser::previous_token() const {
+Token &Parser::previous_token() {
     if (m_index > 0)
-        return (*m_tokens)[m_index - 1];
+        return token_at(m_index - 1);
     return Token::invalid();
 }
 
-Token &Parser::current_token() const {
-    if (m_index < m_tokens->size())
-        return m_tokens->at(m_index);
-    return Token::invalid();
+Token &Parser::current_token() {
+    return token_at(m_index);
+}
+
+Token &Parser::peek_token() {
+    return token_at(m_index + 1);
 }
 
-Token &Parser::peek_token() const {
-    if (m_index + 1 < m_tokens->size())
-        return (*m_tokens)[m_index + 1];
+Token &Parser::token_at(size_t index) {
+    assert(index >= m_window_start);
+    while (index >= m_window_start + m_tokens.size() && !m_lexer_finished) {
+        retire_consumed_tokens();
+        auto token = m_lexer.next_significant_token();
+        if (token.is_eof() || !token.is_valid())
+            m_lexer_finished = true;
+        m_tokens.push(token);
+    }
+    if (index < m_window_start + m_tokens.size())
+        return m_tokens[index - m_window_start];
     return Token::invalid();
 }
 
+void Parser::insert_token(Token token) {
+    current_token(); // make sure the window reaches the insertion point
+    auto position = m_index - m_window_start;
+    if (position < m_tokens.size())
+        m_tokens.insert(position, token);
+    else
+        m_tokens.push(token);
+}
+
+// Drop tokens the parser has moved past, keeping a few behind the current
+// one so previous_token() and rewind() keep working.
+void Parser::retire_consumed_tokens() {
+    const size_t keep_behind = 4;
+    const size_t retire_batch = 64;
+    if (m_index < m_window_start + keep_behind + retire_batch)
+        return;
+    auto retire_count = m_index - keep_behind - m_window_start;
+    Vector<Token> window {};
+    for (size_t i = retire_count; i < m_tokens.size(); i++)
+        window.push(m_tokens[i]);
+    m_tokens = window;
+    m_window_start += retire_count;
+}
+
 void Parser::next_expression() {
     auto token = current_token();
     if (!token.is_end_of_expression())
@@ -3230,18 +3311,11 @@ void Parser::throw_unterminated_thing(Token token, Token start_token) {
 }
 
 String Parser::code_line(size_t number) {
-    size_t line = 0;
-    String buf;
-    for (size_t i = 0; i < m_code->size(); ++i) {
-        char c = (*m_code)[i];
-        if (line == number && c != '\n')
-            buf.append_char(c);
-        else if (line > number)
-            break;
-        if (c == '\n')
-            line++;
-    }
-    return buf;
+    auto line_index = m_lexer.line_index();
+    if (number >= line_index->line_count())
+        return {};
+    auto start = line_index->line_start(number);
+    return String(m_code->c_str() + start, line_index->line_end(number) - start);
 }
 
 String Parser::current_line() {
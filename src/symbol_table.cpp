@@ -0,0 +1,111 @@
+#include "natalie_parser/symbol_table.hpp"
+
+namespace NatalieParser {
+
+static uint32_t hash_name(const char *name, size_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t hash_pointer(const String *string) {
+    auto bits = (uintptr_t)string;
+    bits ^= bits >> 17;
+    bits *= 0xed5ad4bbu;
+    bits ^= bits >> 11;
+    return (uint32_t)bits;
+}
+
+SymbolTable::SymbolTable() {
+    for (size_t i = 0; i < 256; i++) {
+        m_by_name.push(0);
+        m_by_pointer.push(0);
+    }
+    intern("private", 7);
+    intern("protected", 9);
+    intern("public", 6);
+    assert(lookup("public") == Public);
+}
+
+SymbolTable::Id SymbolTable::intern(const char *name, size_t length) {
+    auto hash = hash_name(name, length);
+    auto id = lookup(name, length, hash);
+    if (id)
+        return id;
+
+    if ((m_strings.size() + 1) * 2 > m_by_name.size())
+        grow();
+
+    SharedPtr<String> string = new String(name, length);
+    m_strings.push(string);
+    m_hashes.push(hash);
+    id = m_strings.size();
+
+    auto mask = m_by_name.size() - 1;
+    size_t slot = hash & mask;
+    while (m_by_name[slot])
+        slot = (slot + 1) & mask;
+    m_by_name[slot] = id;
+
+    slot = hash_pointer(string.ptr()) & mask;
+    while (m_by_pointer[slot])
+        slot = (slot + 1) & mask;
+    m_by_pointer[slot] = id;
+
+    return id;
+}
+
+SymbolTable::Id SymbolTable::lookup(const char *name, size_t length) const {
+    return lookup(name, length, hash_name(name, length));
+}
+
+SymbolTable::Id SymbolTable::lookup(const char *name, size_t length, size_t hash) const {
+    auto mask = m_by_name.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        auto id = m_by_name[slot];
+        if (!id)
+            return 0;
+        auto &candidate = *m_strings[id - 1];
+        if (m_hashes[id - 1] == (uint32_t)hash && candidate.length() == length && memcmp(candidate.c_str(), name, length) == 0)
+            return id;
+    }
+}
+
+SymbolTable::Id SymbolTable::find(const String *string) const {
+    auto mask = m_by_pointer.size() - 1;
+    for (size_t slot = hash_pointer(string) & mask;; slot = (slot + 1) & mask) {
+        auto id = m_by_pointer[slot];
+        if (!id)
+            return 0;
+        if (m_strings[id - 1].ptr() == string)
+            return id;
+    }
+}
+
+void SymbolTable::grow() {
+    auto capacity = m_by_name.size() * 2;
+    auto mask = capacity - 1;
+    m_by_name.clear();
+    m_by_pointer.clear();
+    for (size_t i = 0; i < capacity; i++) {
+        m_by_name.push(0);
+        m_by_pointer.push(0);
+    }
+    for (Id id = 1; id <= m_strings.size(); id++) {
+        size_t slot = m_hashes[id - 1] & mask;
+        while (m_by_name[slot])
+            slot = (slot + 1) & mask;
+        m_by_name[slot] = id;
+
+        slot = hash_pointer(m_strings[id - 1].ptr()) & mask;
+        while (m_by_pointer[slot])
+            slot = (slot + 1) & mask;
+        m_by_pointer[slot] = id;
+    }
+}
+
+}
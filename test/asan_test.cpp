@@ -1,7 +1,14 @@
+#include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "fragments.hpp"
+#include "natalie_parser/batch_parser.hpp"
+#include "natalie_parser/creator/binary_creator.hpp"
 #include "natalie_parser/creator/debug_creator.hpp"
+#include "natalie_parser/incremental_parser.hpp"
+#include "natalie_parser/line_index.hpp"
+#include "natalie_parser/parse_cache.hpp"
 #include "natalie_parser/parser.hpp"
 
 using namespace NatalieParser;
@@ -31,6 +38,50 @@ TM::String test_code(TM::String code, TM::String path = "(string)") {
     return result;
 }
 
+void test_flat_ast(TM::String code) {
+    TM::SharedPtr<TM::String> code_ptr = new String { code };
+    auto parser = Parser { code_ptr, new String { "(string)" } };
+    auto tree = parser.tree();
+    auto creator = DebugCreator {};
+    tree->transform(&creator);
+    auto expected = creator.to_string();
+    auto actual = FlatAst { *tree }.to_string();
+    if (actual != expected) {
+        printf("\nExpected flat AST for `%s' to be:\n%s\nbut it was:\n%s\n", code.c_str(), expected.c_str(), actual.c_str());
+        abort();
+    }
+}
+
+// Reads back the binary form of the tree, then the same with one byte
+// changed and with bytes cut off the end, which should either be rejected
+// or read without going out of bounds.
+void test_binary_ast(TM::String code) {
+    TM::SharedPtr<TM::String> code_ptr = new String { code };
+    auto parser = Parser { code_ptr, new String { "(string)" } };
+    auto tree = parser.tree();
+    auto creator = DebugCreator {};
+    tree->transform(&creator);
+    auto expected = creator.to_string();
+    auto binary = BinaryCreator::serialize(*tree);
+    auto ast = BinaryAst { binary };
+    auto actual = ast.root().to_string();
+    if (actual != expected || !(ast.file() == "(string)")) {
+        printf("\nExpected binary AST for `%s' to be:\n%s\nbut it was:\n%s\n", code.c_str(), expected.c_str(), actual.c_str());
+        abort();
+    }
+
+    auto damaged = binary.clone();
+    damaged[rand() % damaged.length()] ^= 1 << (rand() % 8);
+    try {
+        BinaryAst { damaged }.root().to_string();
+    } catch (BinaryAst::FormatError &) { }
+    try {
+        BinaryAst { binary.c_str(), binary.length() - 1 - rand() % binary.length() };
+        printf("\nExpected truncated binary AST for `%s' to be rejected\n", code.c_str());
+        abort();
+    } catch (BinaryAst::FormatError &) { }
+}
+
 void test_code_with_syntax_error(TM::String code) {
     try {
         test_code(code);
@@ -65,6 +116,389 @@ void test_file(TM::String path, size_t expected_output_size) {
     printf("\n");
 }
 
+void test_line_index() {
+    printf("testing LineIndex\n");
+    TM::String sources[] = { "", "\n", "a", "foo\nbar\n\nbaz", "0123456789abcdef\n0123456789abcdef0123456789\n\n\nx\n" };
+    for (auto &source : sources) {
+        LineIndex index { source };
+        TM::Vector<size_t> lines {};
+        TM::Vector<size_t> columns {};
+        size_t line = 0;
+        size_t column = 0;
+        for (size_t offset = 0; offset <= source.length(); offset++) {
+            lines.push(line);
+            columns.push(column);
+            if (offset < source.length() && source[offset] == '\n') {
+                line++;
+                column = 0;
+            } else {
+                column++;
+            }
+        }
+        assert(index.line_count() == line + 1);
+        // backwards too, since that skips the fast path
+        for (size_t i = 0; i < 2 * lines.size(); i++) {
+            auto offset = i < lines.size() ? i : 2 * lines.size() - i - 1;
+            if (index.line(offset) != lines[offset] || index.column(offset) != columns[offset]) {
+                printf("\nExpected offset %zu of %s to be at %zu:%zu\n", offset, source.c_str(), lines[offset], columns[offset]);
+                abort();
+            }
+        }
+        printf(".");
+    }
+    printf("\n");
+}
+
+void test_batch_parser() {
+    printf("testing BatchParser for memory errors\n");
+    TM::String path = "test/support/boardslam.rb";
+    auto expected = test_code(read_file(path), path);
+    TM::Vector<TM::String> paths {};
+    for (size_t i = 0; i < 8; i++)
+        paths.push(path);
+    paths.push("test/support/does_not_exist.rb");
+    auto results = BatchParser::parse_files(paths, 4);
+    assert(results.size() == paths.size());
+    for (size_t i = 0; i < 8; i++) {
+        assert(results[i].status == BatchParser::Result::Status::Ok);
+        auto creator = DebugCreator {};
+        results[i].tree->transform(&creator);
+        if (creator.to_string() != expected) {
+            printf("\nExpected batch result %zu to match parsing %s on its own\n", i, path.c_str());
+            abort();
+        }
+        printf(".");
+    }
+    assert(results[8].status == BatchParser::Result::Status::ReadError);
+    assert(results[8].error_number == ENOENT);
+    printf(".\n");
+}
+
+// Fetches the same code from a fresh cache twice (a miss, then a mapped
+// hit), then damages the entry, which should be rejected and parsed again,
+// and finally shrinks the cache with evict().
+void test_parse_cache() {
+    printf("testing ParseCache for memory errors\n");
+    char directory[] = "/tmp/natalie_parser_cache_XXXXXX";
+    auto made = mkdtemp(directory);
+    assert(made);
+    TM::String path = "test/support/boardslam.rb";
+    auto code = read_file(path);
+    auto expected = test_code(code, path);
+    TM::SharedPtr<TM::String> code_ptr = new String { code };
+    TM::SharedPtr<TM::String> file = new String { path };
+
+    auto cache = ParseCache { directory, "test" };
+    auto entry = cache.fetch(code_ptr, file);
+    assert(!entry->is_mapped());
+    assert(entry->ast().root().to_string() == expected);
+    entry = cache.fetch(code_ptr, file);
+    assert(entry->is_mapped());
+    assert(entry->ast().root().to_string() == expected);
+    assert(cache.hits() == 1 && cache.misses() == 1);
+    printf(".");
+
+    auto key = cache.key(*code_ptr, *file, BinaryAst::Locations | BinaryAst::Comments);
+    char name[40];
+    snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)key.high, (unsigned long long)key.low);
+    auto entry_path = String::format("{}/{}.npab", directory, name);
+    FILE *fp = fopen(entry_path.c_str(), "r+b");
+    assert(fp);
+    fseek(fp, 100, SEEK_SET);
+    int byte = fgetc(fp);
+    fseek(fp, 100, SEEK_SET);
+    fputc(byte ^ 0xff, fp);
+    fclose(fp);
+    entry = cache.fetch(code_ptr, file);
+    assert(!entry->is_mapped());
+    assert(entry->ast().root().to_string() == expected);
+    assert(cache.rejected() == 1);
+    entry = cache.fetch(code_ptr, file);
+    assert(entry->is_mapped());
+    printf(".");
+
+    for (int i = 0; i < 4; i++)
+        cache.fetch(new String { String::format("x = {}", String((long long)i)) }, file);
+    auto small_cache = ParseCache { directory, "test", 0 };
+    small_cache.evict();
+    auto evicted = small_cache.lookup(key);
+    assert(!evicted);
+    assert(entry->ast().root().to_string() == expected);
+    auto removed = rmdir(directory);
+    assert(removed == 0);
+    printf(".\n");
+}
+
+// Nested lexers are pooled and reset for each new literal, so lexing the
+// same code a second time, after the pool is warm, should give the same
+// tokens as the first time.
+void test_nested_lexers() {
+    printf("testing nested lexers\n");
+    TM::String snippets[] = {
+        "\"a#{b}c#{\"d#{e}\"}f\"",
+        "/a#{b}c/i =~ %W[x#{y} z] && `echo #{1}`",
+        "%w[a b] + %I[c#{d} e] + [:\"f#{g}\"]",
+        "x = <<~A + \"#{<<-B}\"\n  a#{b}\n  A\n  b#{\"c#{d}\"}\n  B\ny",
+        "foo(\"#{[1, \"#{2 + /#{3}/.source.size}\"].join}\")",
+    };
+    for (auto &snippet : snippets) {
+        auto code = TM::String::format("{}\n{}\n", snippet, snippet);
+        auto lexer = Lexer { new TM::String { code }, new TM::String { "(string)" } };
+        auto tokens = lexer.tokens();
+        assert(tokens->last().is_eof());
+        auto count = (tokens->size() - 1) / 2;
+        auto first_line = tokens->at(0).line();
+        auto second_line = tokens->at(count).line();
+        for (size_t i = 0; i < count; i++) {
+            auto &first = tokens->at(i);
+            auto &second = tokens->at(count + i);
+            if (first.type() != second.type() || strcmp(first.literal_or_blank(), second.literal_or_blank()) != 0 || first.line() - first_line != second.line() - second_line) {
+                printf("\nExpected token %zu of %s to be lexed the same way twice\n", i, snippet.c_str());
+                abort();
+            }
+        }
+        printf(".");
+    }
+    printf("\n");
+}
+
+// Saving the lexer's state before every token and resuming from it, in a
+// new lexer, should give the same tokens as lexing straight through.
+void test_lexer_state() {
+    printf("testing lexer state\n");
+    TM::String snippets[] = {
+        "\"a#{b}c#{\"d#{e}\"}f\"\nx ? y : z",
+        "/a#{b}c/i =~ %W[x#{y} z] && `echo #{1}`",
+        "%w[a (b) c] + %I[c#{d} e] + [:\"f#{g}\"]",
+        "x = <<~A + \"#{<<-B}\"\n  a#{b}\n  A\n  b#{\"c#{d}\"}\n  B\ny",
+        "# one\n;\n# two\ndef foo=(x)\n  alias bar baz\nend\n\nfoo.\n  bar",
+    };
+    for (auto &snippet : snippets) {
+        TM::SharedPtr<TM::String> code = new TM::String { snippet };
+        TM::SharedPtr<TM::String> file = new TM::String { "(string)" };
+        auto lexer = Lexer { code, file };
+        TM::Vector<Token> tokens {};
+        TM::Vector<LexerState> states {};
+        for (;;) {
+            states.push(lexer.state());
+            auto token = lexer.next_significant_token();
+            tokens.push(token);
+            if (token.is_eof())
+                break;
+        }
+        for (size_t i = 0; i < states.size(); i++) {
+            auto resumed = Lexer { code, file, states[i] };
+            for (size_t j = i; j < tokens.size(); j++) {
+                auto token = resumed.next_significant_token();
+                auto &expected = tokens[j];
+                auto doc = token.doc() ? token.doc().value() : TM::SharedPtr<TM::String> {};
+                auto expected_doc = expected.doc() ? expected.doc().value() : TM::SharedPtr<TM::String> {};
+                if (token.type() != expected.type() || strcmp(token.literal_or_blank(), expected.literal_or_blank()) != 0 || token.line() != expected.line() || token.column() != expected.column() || !doc != !expected_doc || (doc && *doc != *expected_doc)) {
+                    printf("\nExpected token %zu of %s, resumed from before token %zu, to be %s but it was %s\n", j, snippet.c_str(), i, expected.type_value(), token.type_value());
+                    abort();
+                }
+            }
+        }
+        printf(".");
+    }
+
+    // After <<A, the heredoc body has already been read, so the input may
+    // only be edited after it.
+    TM::SharedPtr<TM::String> code = new TM::String { "x = <<A + y\nbody\nA\nz\n" };
+    TM::SharedPtr<TM::String> file = new TM::String { "(string)" };
+    auto lexer = Lexer { code, file };
+    for (int i = 0; i < 5; i++) // up to the end of the heredoc's string
+        lexer.next_significant_token();
+    auto state = lexer.state();
+    assert(state.index == 7);
+    assert(state.lexed_end() == 19);
+    auto resumed = Lexer { new TM::String { "x = <<A + y\nbody\nA\nzz\n" }, file, state };
+    const char *expected[] = { "+", "y", "\n", "zz" };
+    for (auto literal : expected) {
+        auto token = resumed.next_significant_token();
+        auto value = token.has_literal() ? token.literal_or_blank() : token.type_value();
+        if (strcmp(value, literal) != 0) {
+            printf("\nExpected token after editing past lexed_end() to be %s but it was %s\n", literal, value);
+            abort();
+        }
+    }
+    printf(".\n");
+}
+
+// Records the line and column of every node, and its doc comments, since
+// DebugCreator records neither.
+class LocationCreator : public Creator {
+public:
+    virtual void set_comments(const TM::String &comments) override {
+        m_locations.append("comments: ");
+        m_locations.append(comments);
+    }
+    virtual void set_type(const char *) override { }
+    virtual void append(const Node &node) override {
+        m_locations.append(TM::String::format("{}:{} ", (long long)node.line(), (long long)node.column()));
+        if (node.type() != Node::Type::Nil)
+            node.transform(this);
+    }
+    virtual void append_array(const ArrayNode &array) override {
+        m_locations.append(TM::String::format("{}:{} ", (long long)array.line(), (long long)array.column()));
+        array.ArrayNode::transform(this);
+    }
+    virtual void append_false() override { }
+    virtual void append_bignum(TM::String &) override { }
+    virtual void append_fixnum(long long) override { }
+    virtual void append_float(double) override { }
+    virtual void append_nil() override { }
+    virtual void append_range(long long, long long, bool) override { }
+    virtual void append_regexp(TM::String &, int) override { }
+    virtual void append_sexp(std::function<void(Creator *)> fn) override { fn(this); }
+    virtual void append_string(TM::String &) override { }
+    virtual void append_symbol(TM::String &) override { }
+    virtual void append_true() override { }
+    virtual void make_complex_number() override { }
+    virtual void make_rational_number() override { }
+    virtual void wrap(const char *) override { }
+
+    const TM::String &locations() const { return m_locations; }
+
+private:
+    TM::String m_locations {};
+};
+
+TM::String describe_tree(const Tree &tree) {
+    auto creator = DebugCreator {};
+    tree->transform(&creator);
+    auto locations = LocationCreator {};
+    tree->transform(&locations);
+    auto result = creator.to_string();
+    result.append("\n");
+    result.append(locations.locations());
+    return result;
+}
+
+void test_incremental_parser() {
+    printf("testing IncrementalParser\n");
+    TM::String code = "x = 1\n"
+                      "# the foo method\n"
+                      "def foo(a)\n"
+                      "  a + x\n"
+                      "end\n"
+                      "\n"
+                      "y = <<~DOC\n"
+                      "  heredoc #{x}\n"
+                      "DOC\n"
+                      "puts y\n"
+                      "z = [1, 2]\n"
+                      "  .map { |i| i * 2 }\n"
+                      "bar z, x\n"
+                      "baz\n";
+    struct Edit {
+        const char *find;
+        size_t removed_length;
+        const char *inserted;
+        size_t reparsed_count;
+    };
+    Edit edits[] = {
+        { "a + x", 1, "b", 2 }, // syntax is fine, but a is now b
+        { "b + x", 1, "a", 2 },
+        { "bar z", 0, "w = 2\n", 4 }, // adds a line, so the rest is parsed again
+        { "baz", 0, "w + ", 2 },
+        { "puts y", 4, "p", 2 },
+        { "# the foo", 0, "\n", 8 },
+        { "heredoc", 7, "here", 1 },
+        { "  .map", 2, "", 1 },
+        { "z = [1, 2]", 10, "z = [1, 2", 0 }, // syntax error
+        { "z = [1, 2", 9, "z = [1, 2]", 2 }, // picks up from before the error
+        { "x = 1", 0, "foo(1)\n", 9 },
+        { "baz", 3, "baz(\"#{w}\")", 1 },
+        { "w = 2\n", 6, "", 3 },
+        { "baz(", 4, "baz((", 0 }, // syntax error
+        { "bar z", 5, "bar(z", 0 }, // another one
+        { "baz((", 5, "baz(", 0 }, // still one left
+        { "bar(z", 5, "bar z", 3 }, // parses everything changed by the last four edits
+        { "bar z", 0, "  ", 2 }, // indents a line, which moves its columns
+        { "  bar z", 1, "", 2 }, // dedents it again
+        { " bar z", 1, "", 2 },
+    };
+    IncrementalParser parser { new TM::String { code }, new TM::String { "(string)" } };
+    for (auto &edit : edits) {
+        auto found = strstr(code.c_str(), edit.find);
+        assert(found);
+        size_t offset = found - code.c_str();
+        TM::String new_code { code.c_str(), offset };
+        new_code.append(edit.inserted);
+        new_code.append(code.c_str() + offset + edit.removed_length);
+        code = new_code;
+
+        TM::String expected;
+        bool expected_error = false;
+        try {
+            expected = describe_tree(Parser { new TM::String { code }, new TM::String { "(string)" } }.tree());
+        } catch (Parser::SyntaxError &) {
+            expected_error = true;
+        }
+        try {
+            auto actual = describe_tree(parser.edit(offset, edit.removed_length, edit.inserted));
+            assert(!expected_error);
+            if (actual != expected) {
+                printf("\nExpected incremental parse of:\n%s\nto be:\n%s\nbut got:\n%s\n", code.c_str(), expected.c_str(), actual.c_str());
+                abort();
+            }
+        } catch (Parser::SyntaxError &) {
+            assert(expected_error);
+        }
+        assert(*parser.code() == code);
+        assert(expected_error || parser.reparsed_count() == edit.reparsed_count);
+        printf(".");
+    }
+
+    // Dedenting the line right after the restart point can't reuse the
+    // statement on it, but the one after that is still in step.
+    TM::String dedent_code = "a = 1\n  b = 2\nc = 3\n";
+    IncrementalParser dedent_parser { new TM::String { dedent_code }, new TM::String { "(string)" } };
+    auto actual = describe_tree(dedent_parser.edit(6, 1, ""));
+    auto expected = describe_tree(Parser { new TM::String { "a = 1\n b = 2\nc = 3\n" }, new TM::String { "(string)" } }.tree());
+    if (actual != expected) {
+        printf("\nExpected dedented incremental parse to be:\n%s\nbut got:\n%s\n", expected.c_str(), actual.c_str());
+        abort();
+    }
+    assert(dedent_parser.reparsed_count() == 2);
+    printf(".");
+
+    // A statement whose doc comment was edited away can't be reused.
+    TM::String doc_code = "x = 1\n# doc\ndef foo\nend\n";
+    IncrementalParser doc_parser { new TM::String { doc_code }, new TM::String { "(string)" } };
+    actual = describe_tree(doc_parser.edit(6, 5, "bar 1"));
+    expected = describe_tree(Parser { new TM::String { "x = 1\nbar 1\ndef foo\nend\n" }, new TM::String { "(string)" } }.tree());
+    if (actual != expected) {
+        printf("\nExpected incremental parse without the doc comment to be:\n%s\nbut got:\n%s\n", expected.c_str(), actual.c_str());
+        abort();
+    }
+    assert(doc_parser.reparsed_count() == 3);
+    printf(".");
+
+    // Editing one line after another leaves each statement pointing into a
+    // different copy of the code, until everything is parsed again.
+    TM::String lines_code;
+    for (size_t i = 0; i < 20; i++)
+        lines_code.append(TM::String::format("a{} = {}\n", i, i));
+    IncrementalParser lines_parser { new TM::String { lines_code }, new TM::String { "(string)" } };
+    size_t full_parses = 0;
+    for (size_t i = 0; i < 20; i++) {
+        size_t offset = lines_code.find(TM::String::format(" = {}\n", i)) + 3;
+        TM::String new_code { lines_code.c_str(), offset };
+        new_code.append("x");
+        new_code.append(lines_code.c_str() + offset + 1);
+        lines_code = new_code;
+        actual = describe_tree(lines_parser.edit(offset, 1, "x"));
+        expected = describe_tree(Parser { new TM::String { lines_code }, new TM::String { "(string)" } }.tree());
+        assert(actual == expected);
+        if (lines_parser.reparsed_count() == 20)
+            full_parses++;
+    }
+    assert(full_parses > 0 && full_parses < 5);
+    printf(".\n");
+}
+
 void test_fragments() {
     printf("testing fragments for memory errors\n");
     auto fragments = build_fragments();
@@ -76,6 +510,50 @@ void test_fragments() {
     delete fragments;
 }
 
+// the doc comments in a flat tree, in order
+void collect_flat_comments(const FlatAst &ast, FlatAst::Index index, TM::String &result) {
+    if (auto comments = ast.comments(index))
+        result.append(*comments);
+    ast.each_child(index, [&](FlatAst::Index child) {
+        if (ast[child].kind == FlatAst::Kind::Sexp)
+            collect_flat_comments(ast, child, result);
+    });
+}
+
+void test_fragments_as_flat_ast() {
+    printf("testing flat AST conversion\n");
+    auto fragments = build_fragments();
+    for (auto fragment : *fragments) {
+        test_flat_ast(fragment);
+        printf(".");
+    }
+
+    TM::SharedPtr<TM::String> code = new TM::String { "# a\ndef foo; end\n# b\nclass Bar\n  # c\n  def baz; end\n  # d\n  module Qux; end\nend\nx ||= 1\n" };
+    auto parser = Parser { code, new TM::String { "(string)" } };
+    parser.set_keep_doc_comments(true);
+    auto ast = parser.flat_tree();
+    TM::String comments;
+    collect_flat_comments(ast, ast.root(), comments);
+    if (comments != "# a\n# b\n# c\n# d\n") {
+        printf("\nExpected the flat AST's comments to be in order, but they were:\n%s\n", comments.c_str());
+        abort();
+    }
+    printf(".\n");
+    delete fragments;
+}
+
+void test_fragments_as_binary_ast() {
+    printf("testing binary AST conversion\n");
+    auto fragments = build_fragments();
+    srand(1);
+    for (auto fragment : *fragments) {
+        test_binary_ast(fragment);
+        printf(".");
+    }
+    printf("\n");
+    delete fragments;
+}
+
 void test_fragments_with_syntax_errors() {
     printf("testing with intentional syntax errors for memory errors\n");
     auto fragments = build_fragments();
@@ -109,7 +587,15 @@ void test_fragments_with_fuzzing(int seed) {
 int main() {
     try {
         test_file("test/support/boardslam.rb", 4371);
+        test_line_index();
+        test_batch_parser();
+        test_parse_cache();
+        test_nested_lexers();
+        test_lexer_state();
+        test_incremental_parser();
         test_fragments();
+        test_fragments_as_flat_ast();
+        test_fragments_as_binary_ast();
     } catch (NatalieParser::Parser::SyntaxError &e) {
         printf("\nSyntaxError: %s\n", e.message());
         abort();
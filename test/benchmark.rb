@@ -47,4 +47,5 @@ Benchmark.bm(25) do |x|
   # and breaks RubyParser :-(
   require 'natalie_parser'
   x.report("NatalieParser #{NatalieParser::VERSION}") { iterations.times { NatalieParser.parse(source) } }
+  x.report('NatalieParser.check')                    { iterations.times { NatalieParser.check(source) } }
 end
@@ -0,0 +1,77 @@
+require_relative './test_helper'
+require 'tmpdir'
+
+describe 'NatalieParser' do
+  describe '.serialize' do
+    it 'reads back the same Sexp with deserialize and BinaryAst' do
+      support = File.expand_path('support/boardslam.rb', __dir__)
+      code = File.read(support)
+      expected = NatalieParser.parse(code, support)
+      binary = NatalieParser.serialize(code, support)
+      expect(binary.encoding).must_equal Encoding::ASCII_8BIT
+      expect_same_sexp(NatalieParser.deserialize(binary), expected)
+      expect_same_sexp(NatalieParser::BinaryAst.new(binary).to_sexp, expected)
+      expect(NatalieParser::BinaryAst.new(binary).file).must_equal support
+    end
+
+    it 'handles every kind of literal' do
+      code = "# doc\ndef foo\n  [1, -2, 2**64, 1.5, 2r, 1.5r, 3i, 1ri, 1..2, 1...2, nil, true, false, :sym, :\"\u00e9\", 'str', \"\\xff\", /re/mi]\nend\nx ||= 1"
+      expected = NatalieParser.parse(code)
+      binary = NatalieParser.serialize(code)
+      expect_same_sexp(NatalieParser.deserialize(binary), expected)
+      expect_same_sexp(NatalieParser::BinaryAst.new(binary).to_sexp, expected)
+    end
+
+    it 'leaves out locations and comments when asked' do
+      code = "# the foo method\ndef foo\n  bar / 2\nend\n"
+      binary = NatalieParser.serialize(code, 'foo.rb', locations: false, comments: false)
+      expect(binary.bytesize).must_be :<, NatalieParser.serialize(code, 'foo.rb').bytesize
+      [NatalieParser.deserialize(binary), NatalieParser::BinaryAst.new(binary).to_sexp].each do |ast|
+        expect_same_sexp(ast, NatalieParser.parse(code, 'foo.rb', locations: false, comments: false))
+        expect(ast.instance_variables).must_equal []
+      end
+      ast = NatalieParser::BinaryAst.new(NatalieParser.serialize(code, 'foo.rb', locations: false))
+      expect([ast.locations?, ast.comments?]).must_equal [false, true]
+      expect(ast.to_sexp.comments).must_equal "# the foo method\n"
+    end
+
+    it 'raises SyntaxError like parse' do
+      expect(-> { NatalieParser.serialize('def foo') }).must_raise SyntaxError
+    end
+  end
+
+  describe 'BinaryAst' do
+    it 'works without the C extension' do
+      Dir.mktmpdir do |dir|
+        path = File.join(dir, 'foo.ast')
+        File.binwrite(path, NatalieParser.serialize('foo(1, :bar)'))
+        script = 'p NatalieParser::BinaryAst.new(File.binread(ARGV[0])).to_sexp'
+        output = IO.popen([RbConfig.ruby, '-I', File.expand_path('../lib', __dir__), '-r', 'natalie_parser/binary_ast', '-e', script, path], &:read)
+        expect(output).must_equal NatalieParser.parse('foo(1, :bar)').inspect + "\n"
+      end
+    end
+  end
+
+  describe '.deserialize' do
+    it 'rejects anything else' do
+      binary = NatalieParser.serialize('foo(1, 2)')
+      error = expect(-> { NatalieParser.deserialize('foo') }).must_raise ArgumentError
+      expect(error.message).must_equal 'not a binary AST'
+      error = expect(-> { NatalieParser.deserialize(binary[0...-1]) }).must_raise ArgumentError
+      expect(error.message).must_equal 'binary AST is truncated'
+      other_version = binary.dup
+      other_version.setbyte(4, 99)
+      error = expect(-> { NatalieParser.deserialize(other_version) }).must_raise ArgumentError
+      expect(error.message).must_equal 'binary AST is from a different version'
+      expect(-> { NatalieParser::BinaryAst.new(other_version) }).must_raise NatalieParser::BinaryAst::FormatError
+      binary.bytesize.times do |index|
+        damaged = binary.dup
+        damaged.setbyte(index, damaged.getbyte(index) ^ 0x55)
+        begin
+          expect(NatalieParser.deserialize(damaged)).must_be_kind_of Sexp
+        rescue ArgumentError
+        end
+      end
+    end
+  end
+end
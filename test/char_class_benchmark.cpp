@@ -0,0 +1,116 @@
+#include <chrono>
+#include <ctype.h>
+
+#include "natalie_parser/lexer/char_class.hpp"
+#include "tm/string.hpp"
+
+using namespace NatalieParser;
+
+// Per-byte cost of classifying characters with the lexer's lookup table,
+// compared with the ctype calls and comparison chains it replaced.
+//
+//     build/char_class_benchmark [file.rb ...]
+
+namespace Before {
+
+bool is_identifier_char(char c) {
+    if (!c) return false;
+    return isalnum(c) || c == '_' || (unsigned int)c >= 128;
+}
+
+bool is_name_start_char(char c) {
+    if (!c) return false;
+    return (c >= 'a' && c <= 'z') || c == '_' || (unsigned int)c >= 128;
+}
+
+bool is_delimiter(char c) {
+    return (c >= '!' && c <= '/') || c == ':' || c == ';' || c == '=' || c == '?' || c == '@' || c == '\\' || c == '~' || c == '|' || (c >= '^' && c <= '`');
+}
+
+bool is_space(char c) { return isspace(c); }
+bool is_digit(char c) { return isdigit(c); }
+bool is_hex_digit(char c) { return isxdigit(c); }
+
+}
+
+TM::String build_mixed_code(size_t lines) {
+    const char *templates[] = {
+        "user_name = current_account.owner.display_name unless anonymous_request?\n",
+        "  total += line_item.price * 1_000 + 0x1F if quantity >= 10 && !gift\n",
+        "  %w[alpha beta gamma].each { |x| puts \"#{x}: #{values[x]}\" }\n",
+        "  héllo_wörld = { 'key' => :value, other: [1, 2.5, 3e10] }\n",
+    };
+    TM::String code;
+    for (size_t i = 0; i < lines; i++)
+        code.append(templates[i % 4]);
+    return code;
+}
+
+TM::String read_file(const char *path) {
+    auto buf = TM::String();
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "could not open %s\n", path);
+        exit(1);
+    }
+    char cbuf[4096];
+    size_t bytes;
+    while ((bytes = fread(cbuf, 1, sizeof(cbuf), fp)) > 0)
+        buf.append(cbuf, bytes);
+    fclose(fp);
+    return buf;
+}
+
+template <typename Fn>
+double nanoseconds_per_byte(const TM::String &code, size_t iterations, Fn fn, size_t *matches) {
+    auto str = code.c_str();
+    auto size = code.length();
+    size_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < size; j++)
+            count += fn(str[j]);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    *matches = count;
+    double nanoseconds = std::chrono::duration<double, std::nano>(finish - start).count();
+    return nanoseconds / (size * iterations);
+}
+
+template <typename Before, typename After>
+void compare(const char *name, const TM::String &code, size_t iterations, Before before, After after) {
+    size_t before_matches;
+    size_t after_matches;
+    auto before_cost = nanoseconds_per_byte(code, iterations, before, &before_matches);
+    auto after_cost = nanoseconds_per_byte(code, iterations, after, &after_matches);
+    if (before_matches != after_matches) {
+        fprintf(stderr, "%s: table disagrees with the old check (%zu vs %zu)\n", name, after_matches, before_matches);
+        exit(1);
+    }
+    printf("%-20s %10.3f ns/byte %10.3f ns/byte %8.2fx\n", name, before_cost, after_cost, before_cost / after_cost);
+}
+
+void benchmark(const char *label, const TM::String &code, size_t iterations) {
+    printf("%s (%zu bytes)\n", label, code.length());
+    printf("%-20s %18s %18s %9s\n", "class", "before", "table", "speedup");
+    compare("identifier", code, iterations, Before::is_identifier_char, is_identifier_char);
+    compare("name start", code, iterations, Before::is_name_start_char, is_name_start_char);
+    compare("delimiter", code, iterations, Before::is_delimiter, [](char c) { return char_is(c, CharClass::Delimiter); });
+    compare("space", code, iterations, Before::is_space, is_space_char);
+    compare("decimal digit", code, iterations, Before::is_digit, is_decimal_digit);
+    compare("hex digit", code, iterations, Before::is_hex_digit, is_hex_digit);
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 50;
+    if (getenv("ITERATIONS"))
+        iterations = strtoul(getenv("ITERATIONS"), nullptr, 10);
+
+    benchmark("mixed (generated)", build_mixed_code(20000), iterations);
+
+    for (int i = 1; i < argc; i++)
+        benchmark(argv[i], read_file(argv[i]), iterations);
+
+    return 0;
+}
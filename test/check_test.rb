@@ -0,0 +1,31 @@
+require_relative './test_helper'
+
+describe 'NatalieParser' do
+  describe '.check' do
+    it 'returns true for valid code' do
+      expect(NatalieParser.check('')).must_equal true
+      expect(NatalieParser.check("def foo(a, b = 1)\n  [a, b].each { |x| p x }\nend\nfoo(1)")).must_equal true
+    end
+
+    it 'raises the same SyntaxError as parse' do
+      code = "x = 1\nfoo(x y z)"
+      parse_error = expect(-> { NatalieParser.parse(code, 'foo.rb') }).must_raise SyntaxError
+      check_error = expect(-> { NatalieParser.check(code, 'foo.rb') }).must_raise SyntaxError
+      expect(check_error.message).must_equal parse_error.message
+      expect(-> { NatalieParser.check('"foo') }).must_raise SyntaxError
+    end
+
+    it 'works on an instance' do
+      expect(NatalieParser.new('foo.bar(1)').check).must_equal true
+      expect(-> { NatalieParser.new('foo.bar(1').check }).must_raise SyntaxError
+    end
+  end
+
+  describe '.valid?' do
+    it 'returns true or false' do
+      expect(NatalieParser.valid?('1 + 2')).must_equal true
+      expect(NatalieParser.valid?('1 +')).must_equal false
+      expect(NatalieParser.valid?('class Foo; def bar; end')).must_equal false
+    end
+  end
+end
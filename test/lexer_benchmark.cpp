@@ -0,0 +1,151 @@
+#include <chrono>
+
+#include "natalie_parser/lexer.hpp"
+
+using namespace NatalieParser;
+
+// Identifier-heavy input: mostly bare names, keywords, and method calls,
+// which is what dominates typical Ruby source.
+TM::String build_identifier_heavy_code(size_t lines) {
+    const char *templates[] = {
+        "user_name = current_account.owner.display_name unless anonymous_request?\n",
+        "def normalize_attributes(record, options)\n",
+        "  return record if record.nil? or options.empty?\n",
+        "  record.attributes.each do |attribute_name, attribute_value|\n",
+        "    next unless attribute_value.respond_to?(:strip)\n",
+        "    record.send(attribute_name, attribute_value.strip) if defined?(Rails)\n",
+        "  end\n",
+        "end\n",
+        "class AccountPolicy < ApplicationPolicy; self.default_scope = Account; end\n",
+        "while retry_count < max_retries and not finished; retry_count += 1; end\n",
+    };
+    size_t template_count = sizeof(templates) / sizeof(templates[0]);
+    TM::String code;
+    for (size_t i = 0; i < lines; i++)
+        code.append(templates[i % template_count]);
+    return code;
+}
+
+// Long string literals and heredocs, like templates and test fixtures.
+TM::String build_string_heavy_code(size_t count) {
+    TM::String code;
+    for (size_t i = 0; i < count; i++) {
+        code.append("message = \"Dear customer, thank you for your order of #{quantity} items. ");
+        code.append("It will ship from our warehouse within three to five business days.\\n\"\n");
+        code.append("template = <<~HTML\n");
+        for (size_t j = 0; j < 8; j++)
+            code.append("  <div class=\"order-line\"><span class=\"label\">Item</span> #{item_names[index]} and some more text</div>\n");
+        code.append("HTML\n");
+    }
+    return code;
+}
+
+// Tables of numbers, like seeds, fixtures and lookup tables.
+TM::String build_numeric_heavy_code(size_t rows) {
+    TM::String code;
+    code.append("TABLE = [\n");
+    char row[128];
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(row, sizeof(row), "  [%zu, %zu_%03zu, 0x7fff_ffff, %zu.%zu, %zu.%zue-%zu, 12345678901234567890123],\n",
+            i, i % 1000, i % 1000, i * 37 % 10000, 123456 + i, i % 9 + 1, 718281828 + i, i % 300);
+        code.append(row);
+    }
+    code.append("]\n");
+    return code;
+}
+
+TM::String read_file(const char *path) {
+    auto buf = TM::String();
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "could not open %s\n", path);
+        exit(1);
+    }
+    char cbuf[4096];
+    size_t bytes;
+    while ((bytes = fread(cbuf, 1, sizeof(cbuf), fp)) > 0)
+        buf.append(cbuf, bytes);
+    fclose(fp);
+    return buf;
+}
+
+void benchmark_lexer(const char *label, TM::SharedPtr<TM::String> code, size_t iterations) {
+    TM::SharedPtr<TM::String> file = new TM::String { label };
+    size_t token_count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        auto tokens = Lexer { code, file }.tokens();
+        token_count += tokens->size();
+    }
+    auto finish = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    double megabytes = (double)(code->length() * iterations) / (1024 * 1024);
+    printf("%-30s %10.2f MB/s %14.0f tokens/s\n", label, megabytes / seconds, token_count / seconds);
+}
+
+// Lexes with and without saving the state at every 100th line, then
+// times lexing the last line of the file again, resuming from the nearest
+// checkpoint, compared with lexing from the start.
+void benchmark_checkpoints(const char *label, TM::SharedPtr<TM::String> code, size_t iterations) {
+    TM::SharedPtr<TM::String> file = new TM::String { label };
+    TM::Vector<LexerState> checkpoints {};
+    auto lex = [&](bool save_checkpoints) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            checkpoints.clear();
+            auto lexer = Lexer { code, file };
+            size_t next_line = 0;
+            for (;;) {
+                auto token = lexer.next_significant_token();
+                if (token.is_eof() || !token.is_valid())
+                    break;
+                if (save_checkpoints && token.is_newline() && token.line() >= next_line) {
+                    checkpoints.push(lexer.state());
+                    next_line = token.line() + 100;
+                }
+            }
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    };
+    lex(false); // warm up
+    auto without = lex(false);
+    auto with = lex(true);
+
+    auto last_line = Lexer { code, file }.line_index()->line_count() - 1;
+    auto lex_last_line = [&](bool from_checkpoint) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            auto lexer = from_checkpoint && !checkpoints.is_empty() ? Lexer { code, file, checkpoints.last() } : Lexer { code, file };
+            for (;;) {
+                auto token = lexer.next_significant_token();
+                if (token.is_eof() || !token.is_valid() || token.line() >= last_line)
+                    break;
+            }
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    };
+    auto from_start = lex_last_line(false);
+    auto from_checkpoint = lex_last_line(true);
+
+    printf("%-30s %4zu checkpoints: lex %8.3f ms (%8.3f ms without), last line %8.3f ms (%8.3f ms from the start)\n",
+        label, checkpoints.size(), with, without, from_checkpoint, from_start);
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 20;
+    if (getenv("ITERATIONS"))
+        iterations = strtoul(getenv("ITERATIONS"), nullptr, 10);
+
+    benchmark_lexer("identifier-heavy (generated)", new TM::String { build_identifier_heavy_code(50000) }, iterations);
+    benchmark_lexer("string-heavy (generated)", new TM::String { build_string_heavy_code(5000) }, iterations);
+    benchmark_lexer("numeric-heavy (generated)", new TM::String { build_numeric_heavy_code(50000) }, iterations);
+
+    for (int i = 1; i < argc; i++)
+        benchmark_lexer(argv[i], new TM::String { read_file(argv[i]) }, iterations);
+
+    benchmark_checkpoints("identifier-heavy (generated)", new TM::String { build_identifier_heavy_code(50000) }, iterations);
+    for (int i = 1; i < argc; i++)
+        benchmark_checkpoints(argv[i], new TM::String { read_file(argv[i]) }, iterations);
+
+    return 0;
+}
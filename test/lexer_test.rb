@@ -58,6 +58,20 @@ describe 'NatalieParser' do
         { type: :'=' },
         { type: :fixnum, literal: 1 },
       ]
+      expect(tokenize('end? if! iffy __FILE__x')).must_equal [
+        { type: :name, literal: :end? },
+        { type: :name, literal: :if! },
+        { type: :name, literal: :iffy },
+        { type: :name, literal: :__FILE__x },
+      ]
+      expect(tokenize('defined?(x) defined?y')).must_equal [
+        { type: :defined? },
+        { type: :'(' },
+        { type: :name, literal: :x },
+        { type: :')' },
+        { type: :name, literal: :defined? },
+        { type: :name, literal: :y },
+      ]
     end
 
     it 'tokenizes line-continuation backslash' do
@@ -265,6 +279,12 @@ describe 'NatalieParser' do
       expect(tokenize('18446744073709551627')).must_equal [
         { type: :bignum, literal: '18446744073709551627' }
       ]
+      expect(tokenize('4611686018427387903 4611686018427387904 10_000_000_000_000_000_000 0777777777777777777777777')).must_equal [
+        { type: :fixnum, literal: 4611686018427387903 },
+        { type: :bignum, literal: '4611686018427387904' },
+        { type: :bignum, literal: '10000000000000000000' },
+        { type: :bignum, literal: '0o777777777777777777777777' },
+      ]
     end
 
     it 'tokenizes fixnums' do
@@ -351,6 +371,10 @@ describe 'NatalieParser' do
       expect(tokenize('2e+5')).must_equal [{ type: :float, literal: 200000.0 }]
       expect(tokenize('2.1E-5')).must_equal [{ type: :float, literal: 0.000021 }]
       expect(tokenize('1.0if')).must_equal [{ type: :float, literal: 1.0 }, { type: :if }]
+      expect(tokenize('1_0.5_5e1_0')).must_equal [{ type: :float, literal: 105500000000.0 }]
+      expect(tokenize('2.2250738585072014e-308')).must_equal [{ type: :float, literal: 2.2250738585072014e-308 }]
+      expect(tokenize('0.1234567890123456789012345678901234567890123456789012345678901234567890123')).must_equal [{ type: :float, literal: 0.12345678901234568 }]
+      expect(tokenize('1e400 1e-400')).must_equal [{ type: :float, literal: Float::INFINITY }, { type: :float, literal: 0.0 }]
       expect(-> { tokenize('0.1e') }).must_raise(SyntaxError, "1: syntax error, unexpected 'e'")
       expect(-> { tokenize('0.1e--') }).must_raise(SyntaxError, "1: syntax error, unexpected '-'")
     end
@@ -370,6 +394,23 @@ describe 'NatalieParser' do
       expect(tokenize('?\u{0066}')).must_equal [{ type: :string, literal: "f" }]
     end
 
+    it 'tokenizes long strings' do
+      code = "x = %(#{'a' * 20}(nested)#{'b' * 20}\n#{'c' * 17}\\t\#{y} #{'d' * 16})\nz"
+      expect(tokenize(code, true)).must_equal [
+        { type: :name, literal: :x, line: 0, column: 0 },
+        { type: :'=', line: 0, column: 2 },
+        { type: :dstr, line: 0, column: 4 },
+        { type: :string, literal: "#{'a' * 20}(nested)#{'b' * 20}\n#{'c' * 17}\t", line: 0, column: 6 },
+        { type: :evstr, line: 1, column: 21 },
+        { type: :name, literal: :y, line: 1, column: 21 },
+        { type: :evstrend, line: 1, column: 22 },
+        { type: :string, literal: " #{'d' * 16}", line: 1, column: 23 },
+        { type: :dstrend, line: 1, column: 41 },
+        { type: :"\n", line: 1, column: 41 },
+        { type: :name, literal: :z, line: 2, column: 0 },
+      ]
+    end
+
     it 'tokenizes strings' do
       # double quotes
       expect(tokenize('"foo"')).must_equal [{ type: :dstr }, { type: :string, literal: 'foo' }, { type: :dstrend }]
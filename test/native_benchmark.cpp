@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include <vector>
+
+#include "natalie_parser/arena.hpp"
+#include "natalie_parser/batch_parser.hpp"
+#include "natalie_parser/creator/debug_creator.hpp"
+#include "natalie_parser/parser.hpp"
+
+// Benchmarks lexing, parsing, DebugCreator transformation, and freeing the
+// tree separately over every .rb file in a corpus directory, without going
+// through Ruby. Also compares walking the tree through the Creator interface with
+// converting it to a FlatAst and walking that.
+// Then reads and parses the whole corpus with BatchParser on one thread and
+// on N threads (one per core by default), to show how well that scales.
+// Each phase also reports how many heap allocations it made per KB of input.
+//
+//     build/native_benchmark [--json] [--iterations N] [--threads N] [corpus_dir]
+
+using namespace NatalieParser;
+
+static std::atomic<size_t> allocation_count { 0 };
+
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc {};
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+// Nodes and their child vectors come from an Arena, which gets its chunks
+// from malloc directly.
+static size_t allocations() {
+    return allocation_count.load() + Arena::malloc_count();
+}
+
+static std::string json_string(const char *str) {
+    std::string result { "\"" };
+    for (; *str; str++) {
+        auto c = static_cast<unsigned char>(*str);
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+struct CorpusFile {
+    std::string path;
+    TM::SharedPtr<TM::String> code;
+    TM::SharedPtr<TM::String> file;
+};
+
+struct Phase {
+    const char *name;
+    size_t bytes { 0 };
+    size_t tokens { 0 };
+    size_t nodes { 0 };
+    size_t allocations { 0 };
+    double seconds { 0 };
+    std::vector<double> latencies {};
+
+    double percentile(double p) {
+        if (latencies.empty())
+            return 0;
+        std::sort(latencies.begin(), latencies.end());
+        auto index = (size_t)(p * (latencies.size() - 1) + 0.5);
+        return latencies[index];
+    }
+};
+
+// Counts the nodes a tree hands to its creator, without building anything.
+class CountingCreator : public Creator {
+public:
+    virtual void set_comments(const TM::String &) override { }
+    virtual void set_type(const char *) override { }
+    virtual void append(const Node &node) override {
+        m_count++;
+        if (node.type() != Node::Type::Nil)
+            node.transform(this);
+    }
+    virtual void append_array(const ArrayNode &array) override {
+        m_count++;
+        array.ArrayNode::transform(this);
+    }
+    virtual void append_false() override { }
+    virtual void append_bignum(TM::String &) override { }
+    virtual void append_fixnum(long long) override { }
+    virtual void append_float(double) override { }
+    virtual void append_nil() override { }
+    virtual void append_range(long long, long long, bool) override { }
+    virtual void append_regexp(TM::String &, int) override { }
+    virtual void append_sexp(std::function<void(Creator *)> fn) override { fn(this); }
+    virtual void append_string(TM::String &) override { }
+    virtual void append_symbol(TM::String &) override { }
+    virtual void append_true() override { }
+    virtual void make_complex_number() override { }
+    virtual void make_rational_number() override { }
+    virtual void wrap(const char *) override { }
+
+    size_t count() const { return m_count; }
+
+private:
+    size_t m_count { 1 };
+};
+
+// Visits every sexp of a flat tree and looks up its comments, which is
+// the work a Creator walking the node tree gets handed.
+size_t walk_flat(const FlatAst &ast, FlatAst::Index index, size_t &comment_count) {
+    size_t count = 1;
+    if (ast.comments(index))
+        comment_count++;
+    ast.each_child(index, [&](FlatAst::Index child) {
+        if (ast[child].kind == FlatAst::Kind::Sexp)
+            count += walk_flat(ast, child, comment_count);
+    });
+    return count;
+}
+
+TM::String read_file(const char *path) {
+    auto buf = TM::String();
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "could not open %s\n", path);
+        exit(1);
+    }
+    char cbuf[4096];
+    size_t bytes;
+    while ((bytes = fread(cbuf, 1, sizeof(cbuf), fp)) > 0)
+        buf.append(cbuf, bytes);
+    fclose(fp);
+    return buf;
+}
+
+std::vector<CorpusFile> load_corpus(const char *dir, size_t *skipped) {
+    std::vector<std::string> paths;
+    for (auto &entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".rb")
+            paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // only keep the files we can parse, so every phase sees the same input
+    std::vector<CorpusFile> corpus;
+    for (auto &path : paths) {
+        CorpusFile file { path, new TM::String { read_file(path.c_str()) }, new TM::String { path.c_str() } };
+        try {
+            Parser { file.code, file.file }.tree();
+            corpus.push_back(file);
+        } catch (Parser::SyntaxError &) {
+            (*skipped)++;
+        }
+    }
+    return corpus;
+}
+
+template <typename Fn>
+void measure(Phase &phase, CorpusFile &file, Fn fn) {
+    auto allocations_before = allocations();
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto finish = std::chrono::steady_clock::now();
+    phase.allocations += allocations() - allocations_before;
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    phase.seconds += seconds;
+    phase.latencies.push_back(seconds);
+    phase.bytes += file.code->length();
+}
+
+struct Batch {
+    size_t threads;
+    size_t files { 0 };
+    size_t bytes { 0 };
+    double seconds { 0 };
+};
+
+void measure_batch(Batch &batch, std::vector<CorpusFile> &corpus) {
+    TM::Vector<TM::String> paths {};
+    for (auto &file : corpus) {
+        paths.push(TM::String { file.path.c_str() });
+        batch.bytes += file.code->length();
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto results = BatchParser::parse_files(paths, batch.threads);
+    auto finish = std::chrono::steady_clock::now();
+    batch.seconds += std::chrono::duration<double>(finish - start).count();
+    batch.files += results.size();
+}
+
+long peak_rss_kilobytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    size_t iterations = 5;
+    size_t threads = std::thread::hardware_concurrency();
+    const char *corpus_dir = "test";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = strtoul(argv[++i], nullptr, 10);
+        else
+            corpus_dir = argv[i];
+    }
+
+    size_t skipped = 0;
+    auto corpus = load_corpus(corpus_dir, &skipped);
+    if (corpus.empty()) {
+        fprintf(stderr, "no parseable .rb files found in %s\n", corpus_dir);
+        return 1;
+    }
+
+    Phase lex { "lex" };
+    Phase parse { "parse" };
+    Phase transform { "transform" };
+    Phase walk { "walk" };
+    Phase flatten { "flatten" };
+    Phase flat_walk { "flat_walk" };
+    Phase teardown { "teardown" };
+    for (size_t i = 0; i < iterations; i++) {
+        for (auto &file : corpus) {
+            measure(lex, file, [&]() {
+                auto tokens = Lexer { file.code, file.file }.tokens();
+                lex.tokens += tokens->size();
+            });
+
+            Tree tree;
+            measure(parse, file, [&]() { tree = Parser { file.code, file.file }.tree(); });
+            CountingCreator counter;
+            tree->transform(&counter);
+            parse.nodes += counter.count();
+
+            measure(transform, file, [&]() {
+                DebugCreator creator;
+                tree->transform(&creator);
+            });
+            transform.nodes += counter.count();
+
+            measure(walk, file, [&]() {
+                CountingCreator creator;
+                tree->transform(&creator);
+            });
+            walk.nodes += counter.count();
+
+            TM::Optional<FlatAst> flat;
+            measure(flatten, file, [&]() { flat = FlatAst { *tree }; });
+            flatten.nodes += counter.count();
+
+            size_t comment_count = 0;
+            measure(flat_walk, file, [&]() { walk_flat(flat.value(), 0, comment_count); });
+            flat_walk.nodes += counter.count();
+
+            measure(teardown, file, [&]() { tree = {}; });
+            teardown.nodes += counter.count();
+        }
+    }
+
+    Batch batches[] = { { 1 }, { threads > 0 ? threads : 1 } };
+    for (size_t i = 0; i < iterations; i++) {
+        for (auto &batch : batches)
+            measure_batch(batch, corpus);
+    }
+
+    Phase *phases[] = { &lex, &parse, &transform, &walk, &flatten, &flat_walk, &teardown };
+    constexpr size_t phase_count = sizeof(phases) / sizeof(phases[0]);
+    auto rss = peak_rss_kilobytes();
+    if (json) {
+        printf("{\n  \"corpus\": %s,\n  \"files\": %zu,\n  \"skipped\": %zu,\n  \"iterations\": %zu,\n  \"peak_rss_kb\": %ld,\n  \"phases\": {\n", json_string(corpus_dir).c_str(), corpus.size(), skipped, iterations, rss);
+        for (size_t i = 0; i < phase_count; i++) {
+            auto phase = phases[i];
+            printf("    \"%s\": { \"seconds\": %.6f, \"mb_per_second\": %.3f, \"tokens_per_second\": %.1f, \"nodes_per_second\": %.1f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"allocations_per_kb\": %.1f }%s\n",
+                phase->name,
+                phase->seconds,
+                phase->bytes / phase->seconds / (1024 * 1024),
+                phase->tokens / phase->seconds,
+                phase->nodes / phase->seconds,
+                phase->percentile(0.5) * 1000,
+                phase->percentile(0.99) * 1000,
+                phase->allocations / (phase->bytes / 1024.0),
+                i + 1 < phase_count ? "," : "");
+        }
+        printf("  },\n  \"batch\": [\n");
+        for (size_t i = 0; i < 2; i++) {
+            auto &batch = batches[i];
+            printf("    { \"threads\": %zu, \"seconds\": %.6f, \"mb_per_second\": %.3f, \"files_per_second\": %.1f, \"speedup\": %.2f }%s\n",
+                batch.threads,
+                batch.seconds,
+                batch.bytes / batch.seconds / (1024 * 1024),
+                batch.files / batch.seconds,
+                batches[0].seconds / batch.seconds,
+                i < 1 ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else {
+        printf("%zu files from %s (%zu skipped with syntax errors), %zu iterations\n\n", corpus.size(), corpus_dir, skipped, iterations);
+        printf("%-10s %10s %14s %14s %10s %10s %10s\n", "phase", "MB/s", "tokens/s", "nodes/s", "p50 ms", "p99 ms", "allocs/KB");
+        for (auto phase : phases) {
+            printf("%-10s %10.2f %14.0f %14.0f %10.3f %10.3f %10.1f\n",
+                phase->name,
+                phase->bytes / phase->seconds / (1024 * 1024),
+                phase->tokens / phase->seconds,
+                phase->nodes / phase->seconds,
+                phase->percentile(0.5) * 1000,
+                phase->percentile(0.99) * 1000,
+                phase->allocations / (phase->bytes / 1024.0));
+        }
+        printf("\n%-10s %10s %14s %10s\n", "batch", "MB/s", "files/s", "speedup");
+        for (auto &batch : batches) {
+            printf("%-10s %10.2f %14.0f %9.2fx\n",
+                TM::String::format("{} thr", batch.threads).c_str(),
+                batch.bytes / batch.seconds / (1024 * 1024),
+                batch.files / batch.seconds,
+                batches[0].seconds / batch.seconds);
+        }
+        printf("\npeak RSS: %ld KB\n", rss);
+    }
+    return 0;
+}
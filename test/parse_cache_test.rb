@@ -0,0 +1,84 @@
+require_relative './test_helper'
+require 'fileutils'
+require 'tmpdir'
+
+describe 'NatalieParser' do
+  def entries
+    Dir[File.join(@dir, '*.npab')]
+  end
+
+  before do
+    @tmpdir = Dir.mktmpdir
+    @dir = File.join(@tmpdir, 'parse', 'cache')
+  end
+
+  after do
+    FileUtils.remove_entry(@tmpdir)
+  end
+
+  describe '.parse with cache:' do
+    it 'gives the same Sexp as parse, first and second time' do
+      support = File.expand_path('support/boardslam.rb', __dir__)
+      code = File.read(support)
+      expected = NatalieParser.parse(code, support)
+      expect_same_sexp(NatalieParser.parse(code, support, cache: @dir), expected)
+      expect(entries.size).must_equal 1
+      expect_same_sexp(NatalieParser.parse(code, support, cache: @dir), expected)
+      expect_same_sexp(NatalieParser.new(code, support).parse(cache: @dir), expected)
+      expect(entries.size).must_equal 1
+    end
+
+    it 'keeps the code, path, and options apart' do
+      code = "# the foo method\ndef foo\n  bar / 2\nend\n"
+      [
+        [code, 'foo.rb', {}],
+        [code, 'bar.rb', {}],
+        [code + "\n", 'foo.rb', {}],
+        [code, 'foo.rb', { locations: false }],
+        [code, 'foo.rb', { comments: false }],
+      ].each do |args|
+        2.times do
+          expect_same_sexp(NatalieParser.parse(args[0], args[1], cache: @dir, **args[2]), NatalieParser.parse(args[0], args[1], **args[2]))
+        end
+      end
+      expect(entries.size).must_equal 5
+      expect(NatalieParser.parse(code, 'foo.rb', locations: false, comments: false, cache: @dir).instance_variables).must_equal []
+    end
+
+    it 'parses again when an entry is damaged' do
+      code = 'foo(1, "two", :three)'
+      expected = NatalieParser.parse(code)
+      NatalieParser.parse(code, cache: @dir)
+      entry = entries.first
+      original = File.binread(entry)
+      original.bytesize.times do |index|
+        damaged = original.dup
+        damaged.setbyte(index, damaged.getbyte(index) ^ 0x55)
+        File.binwrite(entry, damaged)
+        expect_same_sexp(NatalieParser.parse(code, cache: @dir), expected)
+        expect(File.binread(entry)).must_equal original
+      end
+      File.binwrite(entry, original[0...-1])
+      expect_same_sexp(NatalieParser.parse(code, cache: @dir), expected)
+      expect(File.binread(entry)).must_equal original
+    end
+
+    it 'raises SyntaxError like parse, and caches nothing' do
+      expect(-> { NatalieParser.parse('def foo', cache: @dir) }).must_raise SyntaxError
+      expect(entries).must_equal []
+    end
+
+    it 'raises RegexpError like parse, from a new or a cached entry' do
+      expect(-> { NatalieParser.parse('/(/') }).must_raise RegexpError
+      2.times do
+        expect(-> { NatalieParser.parse('/(/', cache: @dir) }).must_raise RegexpError
+      end
+      expect(entries.size).must_equal 1
+    end
+
+    it 'parses without the cache when cache: is nil' do
+      expect(NatalieParser.parse('1', cache: nil)).must_equal NatalieParser.parse('1')
+      expect(Dir.exist?(@dir)).must_equal false
+    end
+  end
+end
@@ -0,0 +1,68 @@
+#include <chrono>
+
+#include "natalie_parser/parser.hpp"
+
+using namespace NatalieParser;
+
+// Deeply nested blocks with a handful of locals at every level, which is
+// what RSpec and Rails code tends to look like.
+TM::String build_nested_blocks_code(size_t depth, size_t repeat) {
+    TM::String code;
+    for (size_t r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < depth; i++) {
+            code.append(TM::String::format("context_{} = {}\n", i, i));
+            code.append(TM::String::format("helper_{} = context_{} + 1\n", i, i));
+            code.append(TM::String::format("describe(helper_{}) do |subject_{}|\n", i, i));
+        }
+        for (size_t i = 0; i < depth; i++) {
+            code.append(TM::String::format("expect(subject_{}).to eq(context_{} + helper_{})\n", i, i, i));
+            code.append("end\n");
+        }
+    }
+    return code;
+}
+
+TM::String read_file(const char *path) {
+    auto buf = TM::String();
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "could not open %s\n", path);
+        exit(1);
+    }
+    char cbuf[4096];
+    size_t bytes;
+    while ((bytes = fread(cbuf, 1, sizeof(cbuf), fp)) > 0)
+        buf.append(cbuf, bytes);
+    fclose(fp);
+    return buf;
+}
+
+template <typename Fn>
+void report(const char *label, const char *mode, TM::SharedPtr<TM::String> code, size_t iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        fn();
+    auto finish = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    double megabytes = (double)(code->length() * iterations) / (1024 * 1024);
+    printf("%-30s %-6s %10.2f MB/s %10.2f ms/file %10.1f files/s\n", label, mode, megabytes / seconds, seconds * 1000 / iterations, iterations / seconds);
+}
+
+void benchmark_parser(const char *label, TM::SharedPtr<TM::String> code, size_t iterations) {
+    TM::SharedPtr<TM::String> file = new TM::String { label };
+    report(label, "tree", code, iterations, [&]() { Parser { code, file }.tree(); });
+    report(label, "check", code, iterations, [&]() { Parser { code, file }.check(); });
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 20;
+    if (getenv("ITERATIONS"))
+        iterations = strtoul(getenv("ITERATIONS"), nullptr, 10);
+
+    benchmark_parser("nested blocks (generated)", new TM::String { build_nested_blocks_code(100, 20) }, iterations);
+
+    for (int i = 1; i < argc; i++)
+        benchmark_parser(argv[i], new TM::String { read_file(argv[i]) }, iterations);
+
+    return 0;
+}
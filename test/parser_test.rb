@@ -62,6 +62,8 @@ require_relative '../lib/natalie_parser/sexp'
       it 'parses bignums' do
         expect(parse('100000000000000000000')).must_equal s(:lit, 100000000000000000000)
         expect(parse('-100000000000000000000')).must_equal s(:lit, -100000000000000000000)
+        expect(parse('0777777777777777777777777')).must_equal s(:lit, 0777777777777777777777777)
+        expect(parse('0xFFFF_FFFF_FFFF_FFFF_FFFF')).must_equal s(:lit, 0xFFFF_FFFF_FFFF_FFFF_FFFF)
       end
 
       it 'parses fixnums' do
@@ -1856,6 +1858,9 @@ require_relative '../lib/natalie_parser/sexp'
         END
         expect(parse(doc9)).must_equal s(:array, s(:str, "  foo\n"), s(:lit, 1), s(:lit, 2))
 
+        # squiggly heredoc with only blank lines
+        expect(parse("<<~EOF\n  \n\nEOF\n")).must_equal s(:str, "\n\n")
+
         # FIXME: heredoc inside heredoc interpolation
         #doc10 = "[<<A,\n\#{<<B}\nb\nB\na\nA\n0]"
         #expect(parse(doc10)).must_equal s(:array, s(:str, "b\n\na\n"), s(:lit, 0))
@@ -1965,6 +1970,67 @@ require_relative '../lib/natalie_parser/sexp'
         expect(ast.file).must_be_same_as(two.file)
       end
 
+      if parser == 'NatalieParser'
+        it 'leaves out locations and comments when asked' do
+          code = "# the foo method\ndef foo\n  # not a doc\n  bar / 2\nend\n=begin\nbaz\n=end\n/regexp/\n"
+          expected = parse(code)
+          expect(expected[1].comments).must_equal "# the foo method\n"
+
+          ast = NatalieParser.parse(code, 'foo.rb', locations: false)
+          expect(ast).must_equal expected
+          expect([ast.file, ast.line, ast.column]).must_equal [nil, nil, nil]
+          expect([ast[1].file, ast[1].line, ast[1].column]).must_equal [nil, nil, nil]
+          expect(ast[1].comments).must_equal "# the foo method\n"
+
+          ast = NatalieParser.parse(code, comments: false)
+          expect(ast).must_equal expected
+          expect(ast[1].comments).must_be_nil
+          expect(ast[1].line).must_equal 2
+
+          ast = NatalieParser.new(code).parse(locations: false, comments: false)
+          expect(ast).must_equal expected
+          expect(ast[1].instance_variables).must_equal []
+
+          support = File.expand_path('support/boardslam.rb', __dir__)
+          expect(NatalieParser.parse(File.read(support), locations: false, comments: false)).must_equal parse(File.read(support))
+          expect(-> { NatalieParser.parse(code, lines: false) }).must_raise ArgumentError
+        end
+
+        it 'converts nodes only as they are looked at with parse_lazy' do
+          support = File.expand_path('support/boardslam.rb', __dir__)
+          code = File.read(support)
+          expected = NatalieParser.parse(code, support)
+          walk = lambda do |lazy, sexp|
+            expect(lazy).must_be_kind_of NatalieParser::LazyNode
+            expect(lazy.sexp_type).must_equal sexp.sexp_type
+            expect(lazy.size).must_equal sexp.size
+            expect([lazy.file, lazy.line, lazy.column, lazy.comments]).must_equal [sexp.file, sexp.line, sexp.column, sexp.comments]
+            lazy.each_with_index do |item, index|
+              if item.is_a?(NatalieParser::LazyNode)
+                walk.(item, sexp[index])
+              else
+                expect(item).must_equal sexp[index]
+              end
+            end
+          end
+          walk.(NatalieParser.parse_lazy(code, support), expected)
+          expect(NatalieParser.parse_lazy(code, support)).must_equal expected
+          expect(NatalieParser.parse_lazy(code, support).to_sexp).must_equal expected
+
+          ast = NatalieParser.parse_lazy("a, b = 1, 2\nc = [a, b]\n")
+          expect(ast[1].inspect).must_equal 's(:masgn, s(:array, s(:lasgn, :a), s(:lasgn, :b)), s(:array, s(:lit, 1), s(:lit, 2)))'
+          expect(ast[1][1]).must_equal s(:array, s(:lasgn, :a), s(:lasgn, :b))
+          expect(ast[2]).must_equal ast[2]
+          expect(ast.to_a.drop(1).map(&:sexp_type)).must_equal %i[masgn lasgn]
+          expect(NatalieParser.parse('->((x, y)) { }')).must_equal NatalieParser.parse_lazy('->((x, y)) { }').to_ary
+          expect(NatalieParser.parse_lazy('nil')).must_equal s(:nil)
+
+          ast = NatalieParser.parse_lazy("# foo\ndef foo; end", locations: false, comments: false)
+          expect([ast.line, ast.comments]).must_equal [nil, nil]
+          expect(-> { NatalieParser.parse_lazy('def foo') }).must_raise SyntaxError
+        end
+      end
+
       it 'does not panic on certain errors' do
         if parser == 'NatalieParser'
           expect_raise_with_message(-> { parse('foo sel$f: a') }, SyntaxError, "(string)#1: syntax error, unexpected ':' (expected: 'expression')")
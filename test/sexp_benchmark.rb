@@ -0,0 +1,62 @@
+# Splits the time NatalieParser.parse takes into parsing (the same work
+# NatalieParser.check does) and building the Sexp from the parsed nodes,
+# with and without locations and comments, and with NatalieParser.parse_lazy
+# when only the top-level expressions are looked at.
+#
+#     rake bench:sexp
+#     rake bench:sexp CORPUS=some/dir ITERATIONS=20
+
+require 'benchmark'
+
+$LOAD_PATH << File.expand_path('../lib', __dir__)
+$LOAD_PATH << File.expand_path('../ext', __dir__)
+
+require 'natalie_parser'
+
+corpus = ARGV.first || File.expand_path('support', __dir__)
+iterations = (ENV['ITERATIONS'] || 10).to_i
+
+paths = File.directory?(corpus) ? Dir[File.join(corpus, '**/*.rb')].sort : [corpus]
+sources = paths.map { |path| [path, File.read(path)] }.select { |_, code| NatalieParser.valid?(code) }
+
+count_nodes = lambda do |sexp|
+  sexp.sum { |item| item.is_a?(Sexp) ? count_nodes.(item) : 0 } + 1
+end
+nodes = sources.sum { |path, code| count_nodes.(NatalieParser.parse(code, path)) }
+
+modes = {
+  parse: ->(path, code) { NatalieParser.check(code, path) },
+  total: ->(path, code) { NatalieParser.parse(code, path) },
+  bare_total: ->(path, code) { NatalieParser.parse(code, path, locations: false, comments: false) },
+  lazy_top_level: lambda do |path, code|
+    ast = NatalieParser.parse_lazy(code, path)
+    ast.sexp_type == :block ? ast.drop(1).each { |node| node.respond_to?(:sexp_type) && node.sexp_type } : ast.sexp_type
+  end,
+}
+
+# Take turns, so that each mode sees the same conditions, and keep the
+# fastest run of each, starting with a clean heap, which is the least
+# disturbed by GC.
+times = Hash.new { |hash, key| hash[key] = [] }
+iterations.times do
+  modes.each do |name, fn|
+    GC.start
+    times[name] << Benchmark.realtime { sources.each { |path, code| fn.(path, code) } }
+  end
+end
+parse, total, bare_total, lazy_top_level = modes.keys.map { |name| times[name].min }
+build = total - parse
+bare_build = bare_total - parse
+
+bytes = sources.sum { |_, code| code.bytesize }
+puts "#{sources.size} files, #{bytes / 1024} KB, #{nodes} nodes, fastest of #{iterations} iterations"
+puts format('%-12s %10.2f ms', 'parse', parse * 1000)
+puts format('%-12s %10.2f ms (%.0f ns per node)', 'build Sexp', build * 1000, build * 1e9 / nodes)
+puts format('%-12s %10.2f ms', 'total', total * 1000)
+puts
+puts 'with locations: false, comments: false'
+puts format('%-12s %10.2f ms (%.0f ns per node)', 'build Sexp', bare_build * 1000, bare_build * 1e9 / nodes)
+puts format('%-12s %10.2f ms', 'total', bare_total * 1000)
+puts
+puts 'parse_lazy, looking at the top-level expressions only'
+puts format('%-12s %10.2f ms', 'total', lazy_top_level * 1000)
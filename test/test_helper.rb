@@ -6,3 +6,15 @@ $LOAD_PATH << File.expand_path('../lib', __dir__)
 $LOAD_PATH << File.expand_path('../ext', __dir__)
 
 require 'natalie_parser'
+
+class Minitest::Spec
+  # Like expect(actual).must_equal expected, but also compares the file,
+  # line, column and comments of every Sexp in the tree.
+  def expect_same_sexp(actual, expected)
+    expect(actual).must_equal expected
+    expect([actual.file, actual.line, actual.column, actual.comments]).must_equal [expected.file, expected.line, expected.column, expected.comments]
+    actual.each_with_index do |item, index|
+      expect_same_sexp(item, expected[index]) if item.is_a?(Sexp)
+    end
+  end
+end
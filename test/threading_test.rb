@@ -0,0 +1,122 @@
+require_relative './test_helper'
+require 'tmpdir'
+
+describe 'NatalieParser' do
+  describe 'on multiple threads' do
+    # big enough that the GVL is released while parsing
+    def build_code(count)
+      "def foo(a, b)\n  [a, b].map { |x| x * 2 + bar(x) }\nend\n" * count
+    end
+
+    it 'gives the same results as parsing on one thread' do
+      code = build_code(200)
+      expected_ast = NatalieParser.parse(code)
+      expected_tokens = NatalieParser.tokens(code)
+      threads = 4.times.map do
+        Thread.new { [NatalieParser.parse(code), NatalieParser.tokens(code), NatalieParser.check(code)] }
+      end
+      threads.each do |thread|
+        ast, tokens, checked = thread.value
+        expect(ast).must_equal expected_ast
+        expect(tokens).must_equal expected_tokens
+        expect(checked).must_equal true
+      end
+    end
+
+    it 'raises SyntaxError' do
+      code = build_code(200) + 'foo(1'
+      thread = Thread.new do
+        Thread.current.report_on_exception = false
+        NatalieParser.parse(code)
+      end
+      expect(-> { thread.join }).must_raise SyntaxError
+      expect(Thread.new { NatalieParser.valid?(code) }.value).must_equal false
+    end
+
+    it 'can be interrupted' do
+      code = build_code(20_000)
+      thread = Thread.new do
+        Thread.current.report_on_exception = false
+        NatalieParser.check(code)
+      end
+      sleep 0.01
+      thread.raise(RuntimeError, 'stop')
+      error = expect(-> { thread.join }).must_raise RuntimeError
+      expect(error.message).must_equal 'stop'
+    end
+  end
+
+  describe '.parse_files' do
+    it 'parses each file, in order' do
+      paths = [
+        File.expand_path('support/boardslam.rb', __dir__),
+        File.expand_path('../lib/natalie_parser/sexp.rb', __dir__),
+      ] * 5
+      expected = paths.map { |path| NatalieParser.parse(File.read(path), path) }
+      expect(NatalieParser.parse_files(paths)).must_equal expected
+      expect(NatalieParser.parse_files(paths, threads: 1)).must_equal expected
+      expect(NatalieParser.parse_files(paths, threads: 3)).must_equal expected
+      expect(NatalieParser.parse_files([])).must_equal []
+    end
+
+    it 'leaves out locations and comments when asked' do
+      paths = [File.expand_path('support/boardslam.rb', __dir__)] * 2
+      result = NatalieParser.parse_files(paths, threads: 2, locations: false, comments: false)
+      expect(result).must_equal paths.map { |path| NatalieParser.parse(File.read(path), path) }
+      expect(result.map(&:line)).must_equal [nil, nil]
+    end
+
+    it 'returns the errors for files that cannot be read or parsed' do
+      Dir.mktmpdir do |dir|
+        bad_path = File.join(dir, 'bad.rb')
+        File.write(bad_path, 'foo(1')
+        missing_path = File.join(dir, 'missing.rb')
+        good_path = File.join(dir, 'good.rb')
+        File.write(good_path, '1 + 2')
+        result = NatalieParser.parse_files([bad_path, missing_path, good_path], threads: 2)
+        expect(result[0]).must_be_kind_of SyntaxError
+        expect(result[0].message).must_match(/bad\.rb/)
+        expect(result[1]).must_be_kind_of Errno::ENOENT
+        expect(result[2]).must_equal NatalieParser.parse('1 + 2', good_path)
+      end
+    end
+
+    it 'returns the error for a file whose Sexp cannot be built, and goes on' do
+      Dir.mktmpdir do |dir|
+        paths = %w[a.rb b.rb c.rb].map { |name| File.join(dir, name) }
+        File.write(paths[0], 'foo(1)')
+        File.write(paths[1], '/(/')
+        File.write(paths[2], 'bar(2)')
+        paths << File.join(dir, 'nope.rb')
+        result = NatalieParser.parse_files(paths, threads: 2)
+        expect(result[0]).must_equal NatalieParser.parse('foo(1)', paths[0])
+        expect(result[1]).must_be_kind_of RegexpError
+        expect(result[2]).must_equal NatalieParser.parse('bar(2)', paths[2])
+        expect(result[3]).must_be_kind_of Errno::ENOENT
+        expect($!).must_be_nil
+      end
+    end
+
+    it 'keeps its results alive while the GC runs' do
+      Dir.mktmpdir do |dir|
+        paths = 4.times.map do |index|
+          path = File.join(dir, "#{index}.rb")
+          File.write(path, "def foo#{index}(a, b)\n  [a, :b, 'c#{index}']\nend\n")
+          path
+        end
+        expected = paths.map { |path| NatalieParser.parse(File.read(path), path) }
+        begin
+          GC.stress = true
+          result = NatalieParser.parse_files(paths, threads: 2)
+        ensure
+          GC.stress = false
+        end
+        expect(result).must_equal expected
+      end
+    end
+
+    it 'rejects a bad thread count' do
+      expect(-> { NatalieParser.parse_files([], threads: 0) }).must_raise ArgumentError
+    end
+  end
+end